@@ -50,12 +50,165 @@ export function setOnAutoModeUpdate(callback) {
     onAutoModeUpdate = callback;
 }
 
+// ===============================================
+// CẬP NHẬT MỘT GIÁ TRỊ SENSOR (UI + CHART + FIREBASE)
+// ===============================================
+function handleSensorValue(sensorName, value) {
+    // Update UI
+    if (sensorName === "temp") {
+        const el = document.getElementById("tempValue");
+        if (el) el.innerText = parseFloat(value).toFixed(1);
+    }
+    else if (sensorName === "humi") {
+        const el = document.getElementById("humiValue");
+        if (el) el.innerText = parseFloat(value).toFixed(1);
+    }
+    else if (sensorName === "co2") {
+        const el = document.getElementById("co2Value");
+        if (el) el.innerText = Math.round(value);
+    }
+
+    // Callback cho chart
+    if (onSensorUpdate) {
+        onSensorUpdate(sensorName, value);
+    }
+
+    // Lưu Firebase
+    const timestamp = Date.now();
+    const dbPath = `smarthome/${currentRoom}/sensors/${sensorName}/${timestamp}`;
+    update(ref(db, dbPath), { value: value }).catch(console.error);
+}
+
+// ===============================================
+// TELEMETRY NHỊ PHÂN: smarthome/{room}/telemetry[/replay]/bin
+// Layout v1 (little-endian) - khớp mqtt_payload.h trong firmware:
+//  0 version | 1 flags | 2 seq u32 | 6 ts u32 | 10 valid | 11 aq
+// 12 temp i16 /100 | 14 humi u16 /100 | 16 co2 u16 | 18 raw u16
+// 20 fan | 21 led | 22 buzzer (0 = OFF, n = ON level n-1)
+// replay: 23 boot u16 | 25 age_ms u32 (0xFFFFFFFF = boot trước)
+// ===============================================
+const TELEMETRY_BIN_VERSION = 1;
+const TELEMETRY_BIN_SIZE = 23;
+const TELEMETRY_BIN_REPLAY_SIZE = 29;
+const BIN_FLAG_AUTO = 0x01;
+const BIN_FLAG_ACTUATORS = 0x02;
+const BIN_FLAG_REPLAY = 0x04;
+
+function decodeActuator(code) {
+    return code === 0 ? { state: "OFF", level: 0 } : { state: "ON", level: code - 1 };
+}
+
+// Trả về object cùng dạng với telemetry JSON, hoặc null nếu không giải mã được
+function decodeTelemetryBin(bytes) {
+    if (!bytes || bytes.length < TELEMETRY_BIN_SIZE) {
+        console.error("❌ Binary telemetry too short:", bytes ? bytes.length : 0);
+        return null;
+    }
+    if (bytes[0] !== TELEMETRY_BIN_VERSION) {
+        console.warn("⚠️ Unsupported telemetry version:", bytes[0]);
+        return null;
+    }
+
+    const view = new DataView(bytes.buffer, bytes.byteOffset, bytes.byteLength);
+    const flags = view.getUint8(1);
+    const data = {
+        seq: view.getUint32(2, true),
+        ts: view.getUint32(6, true),
+        valid: view.getUint8(10),
+        aq: view.getUint8(11),
+        temp: view.getInt16(12, true) / 100,
+        humi: view.getUint16(14, true) / 100,
+        co2: view.getUint16(16, true),
+        raw: view.getUint16(18, true),
+        mode: (flags & BIN_FLAG_AUTO) ? "AUTO" : "MANUAL",
+    };
+
+    if (flags & BIN_FLAG_ACTUATORS) {
+        data.fan = decodeActuator(view.getUint8(20));
+        data.led = decodeActuator(view.getUint8(21));
+        data.buzzer = decodeActuator(view.getUint8(22));
+    }
+
+    if (flags & BIN_FLAG_REPLAY) {
+        if (bytes.length < TELEMETRY_BIN_REPLAY_SIZE) {
+            console.error("❌ Binary replay telemetry too short:", bytes.length);
+            return null;
+        }
+        const age = view.getUint32(25, true);
+        data.replay = true;
+        data.boot = view.getUint16(23, true);
+        data.age_ms = (age === 0xFFFFFFFF) ? null : age;
+    }
+    return data;
+}
+
+// Bit "valid" của frame (SENSOR_FRAME_*_VALID trong firmware)
+const VALID_SHT31 = 0x01;   // temp, humi
+const VALID_MQ135 = 0x02;   // raw, aq
+const VALID_PPM = 0x04;     // co2
+const SENSOR_VALID_BITS = { temp: VALID_SHT31, humi: VALID_SHT31, co2: VALID_PPM };
+
+// Cảm biến lỗi trong chu kỳ đó -> giá trị là 0/rác, không vẽ, không lưu.
+// Bản tin không có "valid" (firmware cũ) coi như hợp lệ.
+function sensorValid(data, sensorName) {
+    if (typeof data[sensorName] !== "number") return false;
+    if (typeof data.valid !== "number") return true;
+    return (data.valid & SENSOR_VALID_BITS[sensorName]) !== 0;
+}
+
+// Topic kết thúc bằng /bin -> nhị phân, còn lại JSON
+function parseTelemetry(message, isBinary) {
+    if (isBinary) {
+        return decodeTelemetryBin(message.payloadBytes);
+    }
+    try {
+        return JSON.parse(message.payloadString);
+    } catch (e) {
+        console.error("❌ Telemetry parse error:", e);
+        return null;
+    }
+}
+
+// ===============================================
+// REPLAY TỪ OFFLINE SPOOL: smarthome/{room}/telemetry/replay[/bin]
+// Dữ liệu lịch sử -> chỉ lưu Firebase theo thời điểm lấy mẫu, không cập nhật UI
+// ===============================================
+function handleTelemetryReplay(data) {
+    // age_ms = null: bản tin thuộc lần boot trước, không biết thời điểm chính xác
+    const timestamp = (typeof data.age_ms === "number") ? Date.now() - data.age_ms : Date.now();
+
+    ["temp", "humi", "co2"].forEach((sensorName) => {
+        if (sensorValid(data, sensorName)) {
+            const dbPath = `smarthome/${currentRoom}/sensors/${sensorName}/${timestamp}`;
+            update(ref(db, dbPath), { value: data[sensorName], replay: true }).catch(console.error);
+        }
+    });
+}
+
+// ===============================================
+// XỬ LÝ TELEMETRY GỘP: smarthome/{room}/telemetry[/bin]
+// {"seq","ts","valid","temp","humi","co2","raw","aq","mode","fan","led","buzzer"}
+// ===============================================
+function handleTelemetry(data) {
+    ["temp", "humi", "co2"].forEach((sensorName) => {
+        if (sensorValid(data, sensorName)) {
+            handleSensorValue(sensorName, data[sensorName]);
+        }
+    });
+
+    // Trạng thái actuator chỉ có khi ESP32 ở AUTO mode
+    ["fan", "led", "buzzer"].forEach((deviceName) => {
+        if (data[deviceName] && onActuatorUpdate) {
+            onActuatorUpdate(deviceName, data[deviceName]);
+        }
+    });
+}
+
 // ===============================================
 // XỬ LÝ TIN NHẮN MQTT
 // ===============================================
 function onMessageArrived(message) {
     const topic = message.destinationName;
-    const payload = message.payloadString;
 
     // Parse room từ topic: smarthome/{room}/sensors/temp
     const parts = topic.split("/");
@@ -66,7 +219,23 @@ function onMessageArrived(message) {
         return; // Bỏ qua message từ phòng khác
     }
 
-    // Xử lý sensor data
+    // Telemetry gộp (mặc định từ firmware). Không đọc payloadString trước:
+    // payload nhị phân không phải UTF-8 hợp lệ.
+    if (parts[2] === "telemetry") {
+        const data = parseTelemetry(message, parts[parts.length - 1] === "bin");
+        if (!data) return;
+
+        if (parts[3] === "replay") {
+            handleTelemetryReplay(data);
+        } else {
+            handleTelemetry(data);
+        }
+        return;
+    }
+
+    const payload = message.payloadString;
+
+    // Xử lý sensor data (topic cũ - firmware build với MQTT_PER_TOPIC_COMPAT=1)
     if (topic.includes("/sensors/")) {
         let data;
         try {
@@ -76,30 +245,7 @@ function onMessageArrived(message) {
         }
 
         const sensorName = parts[3]; // temp, humi, co2
-
-        // Update UI
-        if (sensorName === "temp") {
-            const el = document.getElementById("tempValue");
-            if (el) el.innerText = parseFloat(data.value).toFixed(1);
-        }
-        else if (sensorName === "humi") {
-            const el = document.getElementById("humiValue");
-            if (el) el.innerText = parseFloat(data.value).toFixed(1);
-        }
-        else if (sensorName === "co2") {
-            const el = document.getElementById("co2Value");
-            if (el) el.innerText = Math.round(data.value);
-        }
-
-        // Callback cho chart
-        if (onSensorUpdate) {
-            onSensorUpdate(sensorName, data.value);
-        }
-
-        // Lưu Firebase
-        const timestamp = Date.now();
-        const dbPath = `smarthome/${currentRoom}/sensors/${sensorName}/${timestamp}`;
-        update(ref(db, dbPath), { value: data.value }).catch(console.error);
+        handleSensorValue(sensorName, data.value);
     }
     // Xử lý actuator reported
     else if (topic.includes("/reported")) {
@@ -169,6 +315,7 @@ function onConnect() {
     console.log("✅ MQTT connected!");
 
     // Subscribe TẤT CẢ rooms (để nhận nếu user switch trang)
+    client.subscribe("smarthome/+/telemetry/#");  // JSON, /bin, /replay, /replay/bin
     client.subscribe("smarthome/+/sensors/#");
     client.subscribe("smarthome/+/actuators/#");
     client.subscribe("smarthome/+/actuators/+/reported");
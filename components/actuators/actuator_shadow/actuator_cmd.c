@@ -0,0 +1,99 @@
+#include "actuator_cmd.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "ACT_CMD";
+
+typedef struct {
+    bool pending;
+    bool on;
+    int level;
+    int64_t posted_us;
+} cmd_slot_t;
+
+static cmd_slot_t slots[ACTUATOR_COUNT];
+static actuator_cmd_stats_t stats;
+static portMUX_TYPE cmd_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static actuator_cmd_notify_t notify_fn = NULL;
+
+void actuator_cmd_set_notify(actuator_cmd_notify_t notify)
+{
+    notify_fn = notify;
+}
+
+void actuator_cmd_post(actuator_id_t id, bool on, int level)
+{
+    if (id >= ACTUATOR_COUNT) return;
+
+    int64_t now = esp_timer_get_time();
+
+    taskENTER_CRITICAL(&cmd_lock);
+    cmd_slot_t *slot = &slots[id];
+    if (slot->pending) {
+        stats.coalesced++;
+    } else {
+        slot->posted_us = now;  // Latency tính từ lệnh đầu tiên chưa được áp
+    }
+    slot->pending = true;
+    slot->on = on;
+    slot->level = level;
+    stats.received++;
+    taskEXIT_CRITICAL(&cmd_lock);
+
+    if (notify_fn != NULL) {
+        notify_fn();
+    }
+}
+
+int actuator_cmd_apply_pending(void)
+{
+    int applied = 0;
+
+    for (int i = 0; i < ACTUATOR_COUNT; i++) {
+        taskENTER_CRITICAL(&cmd_lock);
+        cmd_slot_t cmd = slots[i];
+        slots[i].pending = false;
+        taskEXIT_CRITICAL(&cmd_lock);
+
+        if (!cmd.pending) continue;
+
+        actuator_shadow_command((actuator_id_t)i, cmd.on, cmd.level);
+
+        uint32_t latency = (uint32_t)(esp_timer_get_time() - cmd.posted_us);
+        taskENTER_CRITICAL(&cmd_lock);
+        stats.applied++;
+        stats.last_latency_us = latency;
+        if (latency > stats.max_latency_us) stats.max_latency_us = latency;
+        stats.total_latency_us += latency;
+        taskEXIT_CRITICAL(&cmd_lock);
+
+        ESP_LOGD(TAG, "⏱️ %s command applied in %lu us", actuator_shadow_name((actuator_id_t)i),
+                 (unsigned long)latency);
+        applied++;
+    }
+    return applied;
+}
+
+void actuator_cmd_discard(void)
+{
+    taskENTER_CRITICAL(&cmd_lock);
+    for (int i = 0; i < ACTUATOR_COUNT; i++) {
+        if (slots[i].pending) {
+            slots[i].pending = false;
+            stats.discarded++;
+        }
+    }
+    taskEXIT_CRITICAL(&cmd_lock);
+}
+
+void actuator_cmd_get_stats(actuator_cmd_stats_t *out)
+{
+    if (out == NULL) return;
+
+    taskENTER_CRITICAL(&cmd_lock);
+    *out = stats;
+    taskEXIT_CRITICAL(&cmd_lock);
+}
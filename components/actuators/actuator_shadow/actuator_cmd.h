@@ -0,0 +1,48 @@
+#ifndef ACTUATOR_CMD_H
+#define ACTUATOR_CMD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "actuator_shadow.h"
+
+/*
+ * Lệnh MANUAL chờ áp dụng: một slot "lệnh mới nhất" cho mỗi actuator
+ *
+ * Task MQTT chỉ parse rồi actuator_cmd_post() (ghi đè slot, không chạm phần
+ * cứng), task điều khiển gọi actuator_cmd_apply_pending() khi được báo. Kéo
+ * slider trên dashboard sinh một loạt lệnh -> chỉ giá trị cuối được ghi ra
+ * LEDC/buzzer; các lệnh bị ghi đè đếm vào coalesced.
+ *
+ * Latency đo từ lúc post (bản tin vừa đến task MQTT) đến khi shadow áp xong.
+ */
+
+typedef struct {
+    uint32_t received;         // actuator_cmd_post()
+    uint32_t applied;          // Lệnh đã áp (sau khi gộp)
+    uint32_t coalesced;        // Bị lệnh mới hơn cùng thiết bị ghi đè
+    uint32_t discarded;        // Bỏ vì chuyển sang AUTO trước khi áp
+    uint32_t last_latency_us;
+    uint32_t max_latency_us;
+    uint64_t total_latency_us; // avg = total / applied
+} actuator_cmd_stats_t;
+
+/** @brief Hàm báo task điều khiển có lệnh mới (gọi từ task MQTT, phải không chặn) */
+typedef void (*actuator_cmd_notify_t)(void);
+
+void actuator_cmd_set_notify(actuator_cmd_notify_t notify);
+
+/** @brief Ghi lệnh mới nhất của thiết bị và báo task điều khiển - O(1), không chặn */
+void actuator_cmd_post(actuator_id_t id, bool on, int level);
+
+/**
+ * @brief Áp các lệnh đang chờ qua actuator_shadow (gọi từ task điều khiển)
+ * @return Số lệnh đã áp
+ */
+int actuator_cmd_apply_pending(void);
+
+/** @brief Bỏ các lệnh chưa áp (khi chuyển sang AUTO) */
+void actuator_cmd_discard(void);
+
+void actuator_cmd_get_stats(actuator_cmd_stats_t *out);
+
+#endif // ACTUATOR_CMD_H
@@ -0,0 +1,201 @@
+#include "actuator_shadow.h"
+#include "fan.h"
+#include "led.h"
+#include "buzzer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+
+static const char *TAG = "ACT_SHADOW";
+
+// Thời gian chuyển màu LED (LEDC fade phần cứng); fan ramp nằm trong fan.c
+#ifndef ACTUATOR_LED_FADE_MS
+#define ACTUATOR_LED_FADE_MS 400
+#endif
+
+static const char *const actuator_names[ACTUATOR_COUNT] = {
+    [ACTUATOR_FAN] = "fan",
+    [ACTUATOR_LED] = "led",
+    [ACTUATOR_BUZZER] = "buzzer",
+};
+
+static const uint8_t actuator_max_level[ACTUATOR_COUNT] = {
+    [ACTUATOR_FAN] = 2,
+    [ACTUATOR_LED] = 4,
+    [ACTUATOR_BUZZER] = 3,
+};
+
+// ========== FAN LEVEL ==========
+// Level 0: OFF, 1: 50%, 2: 100% (fan.c ramp bằng LEDC fade)
+static const uint8_t fan_speeds[] = { 0, 50, 100 };
+
+// ========== LED COLORS ==========
+// LED Colors by Air Quality Level (match AUTO mode):
+// Level 0: Green      (0, 1023, 0)     - Good
+// Level 1: Cyan       (0, 1023, 1023)  - Fair
+// Level 2: Yellow     (1023, 1023, 0)  - Moderate
+// Level 3: Red        (1023, 0, 0)     - Poor
+// Level 4: Purple     (1023, 0, 1023)  - Very Poor
+static const uint16_t led_colors[][3] = {
+    { 0,    1023, 0    },
+    { 0,    1023, 1023 },
+    { 1023, 1023, 0    },
+    { 1023, 0,    0    },
+    { 1023, 0,    1023 },
+};
+
+static actuator_state_t shadow[ACTUATOR_COUNT];
+static bool known[ACTUATOR_COUNT];   // false -> phần cứng chưa được ghi qua shadow
+static actuator_shadow_stats_t stats;
+
+static actuator_shadow_report_cb_t report_cb = NULL;
+static void *report_ctx = NULL;
+
+// Thứ tự khóa: hw_mutex[id] -> shadow_mutex, không bao giờ ngược lại.
+// shadow_mutex chỉ giữ trong lúc đọc/ghi RAM; ghi phần cứng + report chạy dưới
+// hw_mutex của riêng thiết bị đó, luôn áp trạng thái MỚI NHẤT (version) nên
+// phần cứng không bị trạng thái cũ ghi đè khi hai task set cùng lúc.
+static SemaphoreHandle_t shadow_mutex = NULL;
+static SemaphoreHandle_t hw_mutex[ACTUATOR_COUNT];
+static uint32_t version[ACTUATOR_COUNT];      // Tăng mỗi lần shadow đổi (shadow_mutex)
+static uint32_t hw_version[ACTUATOR_COUNT];   // Version đã ghi phần cứng (hw_mutex[id])
+
+static void apply_hw(actuator_id_t id, actuator_state_t st)
+{
+    switch (id) {
+        case ACTUATOR_FAN:
+            fan_set_speed(fan_speeds[st.level]);
+            break;
+        case ACTUATOR_LED:
+            if (st.on) {
+                led_fade_rgb(led_colors[st.level][0], led_colors[st.level][1], led_colors[st.level][2],
+                             ACTUATOR_LED_FADE_MS);
+            } else {
+                led_fade_rgb(0, 0, 0, ACTUATOR_LED_FADE_MS);
+            }
+            break;
+        case ACTUATOR_BUZZER:
+            buzzer_set_level(st.level);  // Chỉ hẹn esp_timer, O(1)
+            break;
+        default:
+            break;
+    }
+}
+
+// Fan/buzzer: ON chỉ khi level > 0. LED: ON/OFF độc lập với màu.
+static actuator_state_t normalize(actuator_id_t id, bool on, int level)
+{
+    if (level < 0) level = 0;
+    if (level > actuator_max_level[id]) level = actuator_max_level[id];
+    if (!on) level = 0;
+    if (id != ACTUATOR_LED) on = (level > 0);
+    return (actuator_state_t){ .on = on, .level = (uint8_t)level };
+}
+
+void actuator_shadow_init(void)
+{
+    if (shadow_mutex == NULL) {
+        shadow_mutex = xSemaphoreCreateMutex();
+        for (int i = 0; i < ACTUATOR_COUNT; i++) {
+            hw_mutex[i] = xSemaphoreCreateMutex();
+        }
+    }
+}
+
+void actuator_shadow_set_report_cb(actuator_shadow_report_cb_t cb, void *ctx)
+{
+    xSemaphoreTake(shadow_mutex, portMAX_DELAY);
+    report_cb = cb;
+    report_ctx = ctx;
+    xSemaphoreGive(shadow_mutex);
+}
+
+static bool shadow_set(actuator_id_t id, bool on, int level, bool always_report)
+{
+    if (id >= ACTUATOR_COUNT) return false;
+
+    actuator_state_t st = normalize(id, on, level);
+
+    // 1. Cập nhật shadow (chỉ RAM)
+    xSemaphoreTake(shadow_mutex, portMAX_DELAY);
+    actuator_state_t prev = shadow[id];
+    bool changed = !known[id] || prev.on != st.on || prev.level != st.level;
+    if (changed) {
+        shadow[id] = st;
+        known[id] = true;
+        version[id]++;
+        stats.writes++;
+    } else {
+        stats.unchanged++;
+    }
+    bool want_report = report_cb != NULL && (changed || always_report);
+    xSemaphoreGive(shadow_mutex);
+
+    if (!changed && !want_report) {
+        return false;
+    }
+    if (changed) {
+        ESP_LOGI(TAG, "[%s] %s/%u → %s/%u", actuator_names[id], prev.on ? "ON" : "OFF", prev.level,
+                 st.on ? "ON" : "OFF", st.level);
+    }
+
+    // 2. Ghi phần cứng theo trạng thái mới nhất, ngoài shadow_mutex
+    xSemaphoreTake(hw_mutex[id], portMAX_DELAY);
+    xSemaphoreTake(shadow_mutex, portMAX_DELAY);
+    actuator_state_t latest = shadow[id];
+    uint32_t ver = version[id];
+    actuator_shadow_report_cb_t cb = report_cb;
+    void *cb_ctx = report_ctx;
+    xSemaphoreGive(shadow_mutex);
+
+    // Task khác đã áp version này (gồm cả thay đổi của mình) -> không ghi/report lại
+    bool applied = (ver != hw_version[id]);
+    if (applied) {
+        apply_hw(id, latest);
+        hw_version[id] = ver;
+    }
+    if (cb != NULL && (applied || always_report)) {
+        cb(id, latest, cb_ctx);
+    }
+    xSemaphoreGive(hw_mutex[id]);
+    return changed;
+}
+
+bool actuator_shadow_set(actuator_id_t id, bool on, int level)
+{
+    return shadow_set(id, on, level, false);
+}
+
+bool actuator_shadow_command(actuator_id_t id, bool on, int level)
+{
+    return shadow_set(id, on, level, true);
+}
+
+actuator_state_t actuator_shadow_get(actuator_id_t id)
+{
+    if (id >= ACTUATOR_COUNT) return (actuator_state_t){ 0 };
+
+    xSemaphoreTake(shadow_mutex, portMAX_DELAY);
+    actuator_state_t st = shadow[id];
+    xSemaphoreGive(shadow_mutex);
+    return st;
+}
+
+const char *actuator_shadow_name(actuator_id_t id)
+{
+    return (id < ACTUATOR_COUNT) ? actuator_names[id] : "?";
+}
+
+uint8_t actuator_shadow_max_level(actuator_id_t id)
+{
+    return (id < ACTUATOR_COUNT) ? actuator_max_level[id] : 0;
+}
+
+void actuator_shadow_get_stats(actuator_shadow_stats_t *out)
+{
+    if (out == NULL) return;
+
+    xSemaphoreTake(shadow_mutex, portMAX_DELAY);
+    *out = stats;
+    xSemaphoreGive(shadow_mutex);
+}
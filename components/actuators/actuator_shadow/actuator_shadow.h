@@ -0,0 +1,77 @@
+#ifndef ACTUATOR_SHADOW_H
+#define ACTUATOR_SHADOW_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Bản sao trạng thái fan/LED/buzzer - lối vào duy nhất tới phần cứng cho cả
+ * AUTO (actuator_task) và MANUAL (lệnh MQTT)
+ *
+ * actuator_shadow_set() so với trạng thái đang giữ: giống hệt -> không chạm
+ * LEDC/GPIO, không gọi callback. Khác -> ghi phần cứng rồi gọi report
+ * callback (mqtt_handler publish trạng thái). Level được chuẩn hóa trước khi
+ * so sánh nên "ON level 0" của fan/buzzer trùng với OFF.
+ *
+ * Level (khớp MANUAL mode và bảng luật AUTO):
+ *   fan    0=OFF, 1=50%, 2=100%
+ *   led    0=Green, 1=Cyan, 2=Yellow, 3=Red, 4=Purple (OFF = tắt cả 3 kênh)
+ *   buzzer 0=OFF, 1=WARN, 2=ALERT, 3=CRITICAL (buzzer.h)
+ */
+
+typedef enum {
+    ACTUATOR_FAN = 0,
+    ACTUATOR_LED,
+    ACTUATOR_BUZZER,
+    ACTUATOR_COUNT
+} actuator_id_t;
+
+typedef struct {
+    bool on;
+    uint8_t level;
+} actuator_state_t;
+
+typedef struct {
+    uint32_t writes;           // Lần ghi phần cứng (trạng thái đổi)
+    uint32_t unchanged;        // Lần set bị bỏ qua vì trùng trạng thái
+} actuator_shadow_stats_t;
+
+/**
+ * @brief Gọi khi trạng thái một actuator thực sự đổi
+ *
+ * Chạy trong task gọi actuator_shadow_set(), ngoài khóa shadow nhưng còn giữ
+ * khóa phần cứng của thiết bị đó (report đúng thứ tự ghi phần cứng). @p state
+ * là trạng thái vừa ghi phần cứng. Đọc actuator_shadow_get() được; không gọi
+ * lại actuator_shadow_set/command cho cùng thiết bị.
+ */
+typedef void (*actuator_shadow_report_cb_t)(actuator_id_t id, actuator_state_t state, void *ctx);
+
+/** @brief Tạo khóa shadow (gọi sau fan_init/led_init/buzzer_init) */
+void actuator_shadow_init(void);
+
+void actuator_shadow_set_report_cb(actuator_shadow_report_cb_t cb, void *ctx);
+
+/**
+ * @brief Đặt trạng thái một actuator (level bị kẹp vào khoảng hợp lệ)
+ * @return true nếu trạng thái đổi và phần cứng đã được ghi
+ */
+bool actuator_shadow_set(actuator_id_t id, bool on, int level);
+
+/**
+ * @brief Như actuator_shadow_set() cho lệnh MANUAL: luôn gọi report callback
+ *
+ * Lệnh trùng trạng thái không ghi phần cứng nhưng vẫn được xác nhận, để web
+ * không chờ /reported.
+ */
+bool actuator_shadow_command(actuator_id_t id, bool on, int level);
+
+/** @brief Trạng thái đang áp dụng (chưa set lần nào -> OFF) */
+actuator_state_t actuator_shadow_get(actuator_id_t id);
+
+const char *actuator_shadow_name(actuator_id_t id);
+
+uint8_t actuator_shadow_max_level(actuator_id_t id);
+
+void actuator_shadow_get_stats(actuator_shadow_stats_t *out);
+
+#endif // ACTUATOR_SHADOW_H
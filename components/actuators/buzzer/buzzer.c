@@ -1,27 +1,36 @@
 /* Active buzzer controlled by GPIO (active LOW): LOW = ON, HIGH = OFF
  * Pin: PIN_BUZZER (see app_config.h)
  * 
- * Pattern-based control using FreeRTOS Task Notification for instant response
+ * Pattern engine: một esp_timer one-shot sống suốt chương trình chạy dãy
+ * ON/OFF mô tả bằng dữ liệu (buzzer_pattern_t). Không tạo/xóa task khi đổi level.
  */
 
 #include "buzzer.h"
+#include "buzzer_request.h"
 #include "app_config.h"
 #include "driver/gpio.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "esp_timer.h"
 #include "esp_log.h"
 
 static const char *TAG = "BUZZER";
 
 #define BUZZER_PIN PIN_BUZZER
-#define BEEP_DURATION_MS 100  // Thời gian tít (ms)
 
-// Task handle và level
-static TaskHandle_t buzzer_task_handle = NULL;
-static volatile int current_level = 0;
+static esp_timer_handle_t buzzer_timer = NULL;
 
-// Forward declaration
-static void buzzer_pattern_task(void *pvParameters);
+// Yêu cầu mới nhất (ghi từ mọi context, đọc trong callback của timer);
+// pattern theo level nằm trong buzzer_request.c
+static buzzer_request_t request = { 0 };
+static portMUX_TYPE request_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Trạng thái đang phát - chỉ callback của timer dùng
+static const buzzer_pattern_t *playing = NULL;
+static uint32_t playing_gen = 0;
+static uint16_t playing_step = 0;
+
+static void buzzer_timer_cb(void *arg);
 
 void buzzer_init(void) {
     gpio_config_t io_conf = {
@@ -34,6 +43,13 @@ void buzzer_init(void) {
     gpio_config(&io_conf);
     // Active LOW -> set HIGH to keep buzzer off
     gpio_set_level(BUZZER_PIN, 1);
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = buzzer_timer_cb,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "buzzer",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &buzzer_timer));
     
     ESP_LOGI(TAG, "Buzzer initialized on GPIO%d (active LOW: 0=ON, 1=OFF)", BUZZER_PIN);
 }
@@ -55,93 +71,66 @@ void buzzer_beep(int count) {
     }
 }
 
-// ========== PATTERN TASK với Task Notification ==========
-static void buzzer_pattern_task(void *pvParameters)
+// ========== PATTERN ENGINE (callback esp_timer) ==========
+// Mỗi lần gọi: áp bước hiện tại của pattern rồi hẹn giờ cho bước kế tiếp.
+// Bước chẵn = ON, bước lẻ = OFF.
+static void buzzer_timer_cb(void *arg)
 {
-    int level = current_level;
-    uint32_t wait_ms = 0;
-    uint32_t notify_value = 0;
-    
-    ESP_LOGI(TAG, "Pattern task started, level=%d", level);
-    
-    while (1) {
-        // Kiểm tra level, nếu 0 thì thoát
-        level = current_level;
-        if (level == 0) {
-            break;
-        }
-        
-        // Xác định thời gian nghỉ theo level
-        switch (level) {
-            case 1: wait_ms = 5000; break;  // 5 giây
-            case 2: wait_ms = 3000; break;  // 3 giây
-            case 3: wait_ms = 1000; break;  // 1 giây
-            default: wait_ms = 1000; break;
-        }
-        
-        // === BEEP ===
-        buzzer_on();
-        
-        // Chờ với notification - có thể bị interrupt ngay lập tức
-        if (xTaskNotifyWait(0, ULONG_MAX, &notify_value, pdMS_TO_TICKS(BEEP_DURATION_MS)) == pdTRUE) {
-            // Nhận được notification -> level thay đổi, xử lý ngay
-            buzzer_off();
-            ESP_LOGI(TAG, "Level changed during beep -> %d", current_level);
-            continue;  // Quay lại đầu loop để check level mới
-        }
-        
-        buzzer_off();
-        
-        // === WAIT (nghỉ) ===
-        // Chờ với notification - có thể bị interrupt ngay lập tức  
-        if (xTaskNotifyWait(0, ULONG_MAX, &notify_value, pdMS_TO_TICKS(wait_ms)) == pdTRUE) {
-            // Nhận được notification -> level thay đổi
-            ESP_LOGI(TAG, "Level changed during wait -> %d", current_level);
-            continue;  // Quay lại đầu loop để check level mới
-        }
+    (void) arg;
+
+    portENTER_CRITICAL_SAFE(&request_lock);
+    if (request.gen != playing_gen) {
+        playing_gen = request.gen;
+        playing = request.requested;
+        playing_step = 0;
     }
-    
-    buzzer_off();
-    ESP_LOGI(TAG, "Pattern task stopped");
-    buzzer_task_handle = NULL;
-    vTaskDelete(NULL);
-}
+    portEXIT_CRITICAL_SAFE(&request_lock);
 
-void buzzer_set_level(int level) {
-    ESP_LOGI(TAG, "Set level: %d -> %d", current_level, level);
-    
-    // Cập nhật level
-    int old_level = current_level;
-    current_level = level;
-    
-    if (level <= 0) {
-        // Tắt buzzer
-        current_level = 0;
-        buzzer_off();
-        
-        // Notify task để nó thoát ngay
-        if (buzzer_task_handle != NULL) {
-            xTaskNotifyGive(buzzer_task_handle);
-        }
+    if (playing != NULL && playing_step >= playing->count && playing->repeat) {
+        playing_step = 0;
+    }
+    if (playing == NULL || playing->count == 0 || playing_step >= playing->count) {
+        buzzer_off();  // Tắt hoặc pattern một lần đã phát xong
+        portENTER_CRITICAL_SAFE(&request_lock);
+        buzzer_request_finish(&request, playing_gen);
+        portEXIT_CRITICAL_SAFE(&request_lock);
+        playing = NULL;
         return;
     }
-    
-    // Level > 0: Cần chạy pattern
-    if (buzzer_task_handle == NULL) {
-        // Tạo task mới
-        xTaskCreate(buzzer_pattern_task, "buzzer_pattern", 2048, NULL, 6, &buzzer_task_handle);
-        ESP_LOGI(TAG, "Created pattern task for level %d", level);
-    } else if (old_level != level) {
-        // Task đang chạy, notify để cập nhật level ngay
-        xTaskNotifyGive(buzzer_task_handle);
-        ESP_LOGI(TAG, "Notified task: level changed to %d", level);
+
+    gpio_set_level(BUZZER_PIN, (playing_step % 2 == 0) ? 0 : 1);
+    uint32_t ms = playing->steps[playing_step++];
+    esp_timer_start_once(buzzer_timer, (uint64_t)ms * 1000);
+}
+
+// Chạy callback ngay để áp yêu cầu mới; nếu callback đã kịp hẹn giờ lại thì
+// nó cũng đã thấy yêu cầu mới (start_once khi đó trả về INVALID_STATE)
+static void buzzer_kick(void) {
+    esp_timer_stop(buzzer_timer);
+    esp_timer_start_once(buzzer_timer, 0);
+}
+
+void buzzer_play(const buzzer_pattern_t *pattern) {
+    portENTER_CRITICAL_SAFE(&request_lock);
+    buzzer_request_play(&request, pattern);
+    portEXIT_CRITICAL_SAFE(&request_lock);
+    buzzer_kick();
+}
+
+void buzzer_set_level(int level) {
+    portENTER_CRITICAL_SAFE(&request_lock);
+    bool changed = buzzer_request_set_level(&request, level);
+    portEXIT_CRITICAL_SAFE(&request_lock);
+
+    if (changed) {
+        buzzer_kick();
     }
 }
 
 int buzzer_get_level(void) {
-    return current_level;
+    return request.level;
 }
 
 bool buzzer_is_running(void) {
-    return (buzzer_task_handle != NULL && current_level > 0);
-}
\ No newline at end of file
+    return request.requested != NULL;
+}
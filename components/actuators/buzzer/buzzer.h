@@ -1,21 +1,36 @@
 #ifndef BUZZER_H
 #define BUZZER_H
 
+#include <stdint.h>
 #include <stdbool.h>
 
-// Basic buzzer control
+// Basic buzzer control (ghi GPIO trực tiếp, không qua pattern engine)
 void buzzer_init(void);
 void buzzer_on(void);
 void buzzer_off(void);
 void buzzer_beep(int count);
 
-// Pattern-based buzzer control (non-blocking, uses FreeRTOS task)
+// Pattern: dãy thời gian (ms) xen kẽ ON, OFF, ON, OFF... bắt đầu bằng ON.
+// repeat = false -> phát một lần rồi tắt. Dữ liệu phải tồn tại suốt lúc phát (const/static).
+typedef struct {
+    const uint16_t *steps;
+    uint16_t count;
+    bool repeat;
+} buzzer_pattern_t;
+
+// Pattern-based buzzer control (non-blocking, một esp_timer dùng chung)
 // Level 0: OFF
 // Level 1: Tít ngắn, nghỉ 5 giây
 // Level 2: Tít ngắn, nghỉ 3 giây  
 // Level 3: Tít ngắn, nghỉ 1 giây
+// O(1), gọi được từ mọi task và từ ISR (chỉ ghi yêu cầu + hẹn esp_timer).
+// Level 0 luôn dừng được pattern đang phát, kể cả pattern của buzzer_play().
 void buzzer_set_level(int level);
+// Trả về -1 (BUZZER_LEVEL_CUSTOM) khi đang phát pattern từ buzzer_play()
 int buzzer_get_level(void);
 bool buzzer_is_running(void);
 
+// Phát pattern bất kỳ (NULL = tắt); thay ngay pattern đang phát. Gọi được từ ISR.
+void buzzer_play(const buzzer_pattern_t *pattern);
+
 #endif
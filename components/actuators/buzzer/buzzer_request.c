@@ -0,0 +1,51 @@
+#include "buzzer_request.h"
+#include <stddef.h>
+
+#define BEEP_DURATION_MS 100  // Thời gian tít (ms)
+
+// ========== PATTERN THEO LEVEL ==========
+// Level 1: tít ngắn, nghỉ 5 giây
+// Level 2: tít ngắn, nghỉ 3 giây
+// Level 3: tít ngắn, nghỉ 1 giây
+static const uint16_t warn_steps[] = { BEEP_DURATION_MS, 5000 };
+static const uint16_t alert_steps[] = { BEEP_DURATION_MS, 3000 };
+static const uint16_t critical_steps[] = { BEEP_DURATION_MS, 1000 };
+
+static const buzzer_pattern_t level_patterns[BUZZER_LEVEL_MAX + 1] = {
+    [1] = { warn_steps, 2, true },
+    [2] = { alert_steps, 2, true },
+    [3] = { critical_steps, 2, true },
+};
+
+void buzzer_request_play(buzzer_request_t *r, const buzzer_pattern_t *pattern)
+{
+    r->requested = pattern;
+    r->gen++;
+    // Pattern tùy ý không phải một level -> set_level(0) sau đó vẫn là thay đổi
+    r->level = (pattern != NULL) ? BUZZER_LEVEL_CUSTOM : 0;
+}
+
+bool buzzer_request_set_level(buzzer_request_t *r, int level)
+{
+    if (level < 0) level = 0;
+    if (level > BUZZER_LEVEL_MAX) level = BUZZER_LEVEL_MAX;
+
+    if (level == r->level) {
+        return false;
+    }
+    r->level = level;
+    r->requested = (level > 0) ? &level_patterns[level] : NULL;
+    r->gen++;
+    return true;
+}
+
+void buzzer_request_finish(buzzer_request_t *r, uint32_t gen)
+{
+    if (r->gen != gen) {
+        return;  // Đã có yêu cầu mới hơn
+    }
+    r->requested = NULL;
+    if (r->level == BUZZER_LEVEL_CUSTOM) {
+        r->level = 0;  // Pattern một lần đã xong -> buzzer tắt
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef BUZZER_REQUEST_H
+#define BUZZER_REQUEST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "buzzer.h"
+
+/*
+ * Yêu cầu mới nhất cho pattern engine của buzzer: pattern, generation, level.
+ * buzzer.c giữ một bản duy nhất dưới request_lock; callback esp_timer so gen
+ * để biết có yêu cầu mới.
+ *
+ * Không phụ thuộc ESP-IDF (kiểm tra được trong host_bench/).
+ */
+
+// Level báo cáo khi đang phát pattern tùy ý (buzzer_play) - không trùng level 0..3
+#define BUZZER_LEVEL_CUSTOM (-1)
+#define BUZZER_LEVEL_MAX 3
+
+typedef struct {
+    const buzzer_pattern_t *requested;   // NULL = tắt
+    uint32_t gen;                        // Tăng mỗi lần đổi yêu cầu
+    int level;                           // 0..BUZZER_LEVEL_MAX hoặc BUZZER_LEVEL_CUSTOM
+} buzzer_request_t;
+
+/** @brief Thay bằng pattern bất kỳ (NULL = tắt), luôn tạo yêu cầu mới */
+void buzzer_request_play(buzzer_request_t *r, const buzzer_pattern_t *pattern);
+
+/**
+ * @brief Chuyển sang pattern của level (giới hạn 0..BUZZER_LEVEL_MAX)
+ * @return true nếu yêu cầu đổi -> caller phải kick timer. Sau buzzer_request_play,
+ *         mọi level (kể cả 0) đều là thay đổi.
+ */
+bool buzzer_request_set_level(buzzer_request_t *r, int level);
+
+/** @brief Pattern phát xong: xóa yêu cầu nếu vẫn là generation @p gen */
+void buzzer_request_finish(buzzer_request_t *r, uint32_t gen);
+
+#endif
@@ -1,20 +1,23 @@
 /*
- * Fan driver adapted for simple ON/OFF control via GPIO (MOSFET gate).
- * Hardware: Fan controlled through MOSFET on GPIO18. Fan does not support PWM.
- * GPIO18 HIGH -> fan ON (MOSFET gate driven), LOW -> fan OFF.
- * fan_set_speed() treats any non-zero speed as ON.
- */
-
-/*
- * Fan driver with 3 discrete PWM levels using LEDC.
+ * Fan driver: LEDC PWM 10-bit, tốc độ 0-100% ánh xạ tuyến tính sang duty 0-1023.
  * Hardware: Fan controlled through MOSFET on configured PIN_FAN (see app_config.h).
- * Levels: 0 (OFF), 50 (medium), 100 (max) - matching main.c fan control.
+ * Đổi tốc độ bằng bộ fade phần cứng của LEDC (soft-start, giảm dòng khởi động
+ * của quạt 12V); ramp chạy không cần CPU.
+ *
+ * fan_set_duty() chỉ ghi yêu cầu và hẹn esp_timer; mọi lệnh LEDC chạy trong
+ * callback của timer. Chip không dừng được fade (!SOC_LEDC_SUPPORT_FADE_STOP):
+ * callback hẹn lại đến lúc fade cũ kết thúc thay vì chờ semaphore của driver.
  */
 
 #include "fan.h"
 #include "app_config.h"
 #include "driver/ledc.h"
 #include "driver/gpio.h"
+#include "esp_attr.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "soc/soc_caps.h"
 
 #define FAN_LEDC_TIMER      LEDC_TIMER_1
 #define FAN_LEDC_MODE       LEDC_LOW_SPEED_MODE
@@ -22,13 +25,38 @@
 #define FAN_LEDC_FREQ_HZ    1000  // Lower frequency for IRF520 module
 #define FAN_LEDC_CHANNEL    LEDC_CHANNEL_3
 #define FAN_PIN             PIN_FAN
+#define FAN_DUTY_MAX        1023
 
 // Set to 1 if IRF520 module has inverted logic (HIGH=OFF, LOW=ON)
 #define FAN_INVERT_OUTPUT   0
 
-// Discrete duty levels for 10-bit resolution (0-1023)
-// 3 levels: 0 (OFF), 50 (medium), 100 (max) - matching main.c
-static const uint32_t fan_duties[3] = {0, 512, 1023};  // 0%, 50%, 100%
+// Thời gian ramp cho toàn dải 0 -> 100% (đoạn ngắn hơn tỉ lệ theo)
+#ifndef FAN_RAMP_UP_MS
+#define FAN_RAMP_UP_MS      1500
+#endif
+#ifndef FAN_RAMP_DOWN_MS
+#define FAN_RAMP_DOWN_MS    600
+#endif
+
+static volatile bool fan_ramping = false;
+static int64_t fan_fade_end_us = 0;   // Chỉ callback timer ghi
+
+// Yêu cầu mới nhất (ghi đè yêu cầu chưa áp)
+static portMUX_TYPE fan_req_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool fan_req_pending = false;
+static uint16_t fan_req_duty = 0;
+static uint32_t fan_req_ramp_ms = 0;
+
+static esp_timer_handle_t fan_timer = NULL;
+
+// Fade xong (ISR của LEDC)
+static IRAM_ATTR bool fan_fade_done_cb(const ledc_cb_param_t *param, void *user_arg)
+{
+    if (param->event == LEDC_FADE_END_EVT) {
+        fan_ramping = false;
+    }
+    return false;
+}
 
 static void fan_ledc_init(void)
 {
@@ -51,6 +79,49 @@ static void fan_ledc_init(void)
         .flags.output_invert = FAN_INVERT_OUTPUT,
     };
     ledc_channel_config(&ledc_channel);
+
+    // Dịch vụ fade dùng chung với LED: driver nào khởi tạo trước cũng được
+    esp_err_t err = ledc_fade_func_install(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        ESP_ERROR_CHECK(err);
+    }
+    ledc_cbs_t cbs = { .fade_cb = fan_fade_done_cb };
+    ledc_cb_register(FAN_LEDC_MODE, FAN_LEDC_CHANNEL, &cbs, NULL);
+}
+
+// Callback esp_timer: task duy nhất gọi LEDC cho kênh quạt
+static void fan_apply_cb(void *arg)
+{
+    if (fan_ramping) {
+#if SOC_LEDC_SUPPORT_FADE_STOP
+        // Ramp mới thay ramp đang chạy thay vì chờ nó kết thúc
+        ledc_fade_stop(FAN_LEDC_MODE, FAN_LEDC_CHANNEL);
+        fan_ramping = false;
+#else
+        // Hẹn lại lúc fade cũ xong (fade-end ISR xóa fan_ramping)
+        int64_t wait_us = fan_fade_end_us - esp_timer_get_time();
+        esp_timer_start_once(fan_timer, (wait_us > 1000) ? (uint64_t)wait_us : 1000);
+        return;
+#endif
+    }
+
+    portENTER_CRITICAL(&fan_req_lock);
+    bool pending = fan_req_pending;
+    uint16_t duty = fan_req_duty;
+    uint32_t ramp_ms = fan_req_ramp_ms;
+    fan_req_pending = false;
+    portEXIT_CRITICAL(&fan_req_lock);
+    if (!pending) return;
+
+    uint32_t current = ledc_get_duty(FAN_LEDC_MODE, FAN_LEDC_CHANNEL);
+    if (ramp_ms == 0 || current == duty) {
+        ledc_set_duty_and_update(FAN_LEDC_MODE, FAN_LEDC_CHANNEL, duty, 0);
+        return;
+    }
+
+    fan_ramping = true;
+    fan_fade_end_us = esp_timer_get_time() + (int64_t)ramp_ms * 1000;
+    ledc_set_fade_time_and_start(FAN_LEDC_MODE, FAN_LEDC_CHANNEL, duty, ramp_ms, LEDC_FADE_NO_WAIT);
 }
 
 void fan_init(void) {
@@ -61,49 +132,52 @@ void fan_init(void) {
     gpio_set_pull_mode(FAN_PIN, GPIO_PULLDOWN_ONLY);  // Enable internal pull-down
     gpio_set_level(FAN_PIN, 0);  // Ensure LOW (MOSFET OFF)
     
-    // Now configure LEDC
+    // Now configure LEDC (duty 0 = output LOW liên tục, MOSFET OFF)
     fan_ledc_init();
-    
-    // Ensure fan off
-    ledc_set_duty(FAN_LEDC_MODE, FAN_LEDC_CHANNEL, 0);
-    ledc_update_duty(FAN_LEDC_MODE, FAN_LEDC_CHANNEL);
-    ledc_stop(FAN_LEDC_MODE, FAN_LEDC_CHANNEL, 0);
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = fan_apply_cb,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "fan",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &fan_timer));
+}
+
+void fan_set_duty(uint16_t duty, uint32_t ramp_ms) {
+    if (duty > FAN_DUTY_MAX) duty = FAN_DUTY_MAX;
+    if (fan_timer == NULL) return;
+
+    portENTER_CRITICAL(&fan_req_lock);
+    fan_req_pending = true;
+    fan_req_duty = duty;
+    fan_req_ramp_ms = ramp_ms;
+    portEXIT_CRITICAL(&fan_req_lock);
+
+    // Chạy callback ngay; nếu nó đang chờ fade cũ thì sẽ tự hẹn lại
+    esp_timer_stop(fan_timer);
+    esp_timer_start_once(fan_timer, 0);
+}
+
+void fan_set_speed(uint8_t speed) {
+    if (speed > 100) speed = 100;
+
+    uint16_t target = (uint16_t)((speed * FAN_DUTY_MAX + 50) / 100);
+    uint32_t current = ledc_get_duty(FAN_LEDC_MODE, FAN_LEDC_CHANNEL);
+    uint32_t delta = (target > current) ? target - current : current - target;
+
+    // Thời gian ramp tỉ lệ với quãng duty cần đổi
+    uint32_t full_ms = (target > current) ? FAN_RAMP_UP_MS : FAN_RAMP_DOWN_MS;
+    fan_set_duty(target, full_ms * delta / FAN_DUTY_MAX);
 }
 
 void fan_on(void) {
-    // Restart PWM in case it was stopped by fan_off()
-    ledc_timer_resume(FAN_LEDC_MODE, FAN_LEDC_TIMER);
-    
-    // Set to max duty (index 2 = 100%)
-    ledc_set_duty(FAN_LEDC_MODE, FAN_LEDC_CHANNEL, fan_duties[2]);
-    ledc_update_duty(FAN_LEDC_MODE, FAN_LEDC_CHANNEL);
+    fan_set_speed(100);
 }
 
 void fan_off(void) {
-    // Set duty to 0 first
-    ledc_set_duty(FAN_LEDC_MODE, FAN_LEDC_CHANNEL, 0);
-    ledc_update_duty(FAN_LEDC_MODE, FAN_LEDC_CHANNEL);
-    
-    // Force stop PWM and set GPIO to LOW (idle_level = 0)
-    ledc_stop(FAN_LEDC_MODE, FAN_LEDC_CHANNEL, 0);
-    
-    // Explicitly set GPIO to LOW to ensure MOSFET gate is fully discharged
-    gpio_set_level(FAN_PIN, 0);
+    fan_set_speed(0);
 }
 
-void fan_set_speed(uint8_t speed) {
-    // speed: 0, 50, 100 -> map to 3 levels (matching main.c)
-    if (speed == 0) {
-        fan_off();
-        return;
-    }
-    
-    // Restart PWM in case it was stopped
-    ledc_timer_resume(FAN_LEDC_MODE, FAN_LEDC_TIMER);
-    
-    // Determine level: 50 -> medium (index 1), 100 -> max (index 2)
-    uint8_t level = (speed >= 75) ? 2 : 1;  // 0-74 -> 50%, 75-100 -> 100%
-
-    ledc_set_duty(FAN_LEDC_MODE, FAN_LEDC_CHANNEL, fan_duties[level]);
-    ledc_update_duty(FAN_LEDC_MODE, FAN_LEDC_CHANNEL);
-}
\ No newline at end of file
+bool fan_is_ramping(void) {
+    return fan_ramping;
+}
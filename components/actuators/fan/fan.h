@@ -2,10 +2,20 @@
 #define FAN_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
 void fan_init(void);
 void fan_on(void);
 void fan_off(void);
-void fan_set_speed(uint8_t speed); // speed 0-100 -> maps to 4 discrete levels
 
-#endif
\ No newline at end of file
+// speed 0-100 -> duty 0-1023 (10-bit), ramp bằng LEDC fade (FAN_RAMP_UP_MS / FAN_RAMP_DOWN_MS)
+void fan_set_speed(uint8_t speed);
+
+// Duty 0-1023 trực tiếp, ramp_ms = 0 -> đổi ngay. Không chặn: chỉ ghi yêu cầu,
+// esp_timer áp ngay (hoặc sau khi fade cũ xong nếu chip không dừng được fade).
+void fan_set_duty(uint16_t duty, uint32_t ramp_ms);
+
+// true khi ramp phần cứng đang chạy (xóa trong callback fade-end)
+bool fan_is_ramping(void);
+
+#endif
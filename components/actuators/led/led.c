@@ -5,12 +5,21 @@
  *  - Green: GPIO26 (LEDC_CHANNEL_1)
  *  - Blue:  GPIO27 (LEDC_CHANNEL_2)
  * PWM: 5 kHz, 10-bit resolution
+ * Chuyển màu bằng bộ fade phần cứng của LEDC (led_fade_rgb), không tốn CPU
+ *
+ * led_fade_rgb() chỉ ghi màu đích và hẹn esp_timer; lệnh LEDC chạy trong callback
+ * của timer. Chip không dừng được fade (!SOC_LEDC_SUPPORT_FADE_STOP): callback
+ * hẹn lại đến lúc fade cũ kết thúc thay vì chờ semaphore của driver.
  */
 
 #include "led.h"
 #include "driver/ledc.h"
+#include "esp_attr.h"
+#include "esp_err.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "soc/soc_caps.h"
 
 #define LEDC_TIMER          LEDC_TIMER_0
 #define LEDC_MODE           LEDC_LOW_SPEED_MODE
@@ -27,6 +36,32 @@
 
 static uint8_t led_state = 0; // 0 = off, 1 = on
 
+static const ledc_channel_t led_channels[3] = { LEDC_CH_RED, LEDC_CH_GREEN, LEDC_CH_BLUE };
+
+// Bit i = kênh i đang fade (fade-end ISR xóa)
+static volatile uint32_t led_fading_mask = 0;
+static portMUX_TYPE led_fade_lock = portMUX_INITIALIZER_UNLOCKED;
+static int64_t led_fade_end_us = 0;   // Chỉ callback timer ghi
+
+// Màu đích mới nhất (ghi đè yêu cầu chưa áp)
+static portMUX_TYPE led_req_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool led_req_pending = false;
+static uint16_t led_req_rgb[3];
+static uint32_t led_req_fade_ms = 0;
+
+static esp_timer_handle_t led_timer = NULL;
+
+// Fade một kênh xong (ISR của LEDC)
+static IRAM_ATTR bool led_fade_done_cb(const ledc_cb_param_t *param, void *user_arg)
+{
+    if (param->event == LEDC_FADE_END_EVT) {
+        portENTER_CRITICAL_ISR(&led_fade_lock);
+        led_fading_mask &= ~(1u << (uint32_t)(uintptr_t)user_arg);
+        portEXIT_CRITICAL_ISR(&led_fade_lock);
+    }
+    return false;
+}
+
 static void ledc_init_channels(void) {
     ledc_timer_config_t ledc_timer = {
         .speed_mode = LEDC_MODE,
@@ -57,23 +92,92 @@ static void ledc_init_channels(void) {
     blue_cfg.gpio_num = LED_BLUE_GPIO;
     blue_cfg.channel = LEDC_CH_BLUE;
     ledc_channel_config(&blue_cfg);
+
+    // Dịch vụ fade dùng chung với fan: driver nào khởi tạo trước cũng được
+    esp_err_t err = ledc_fade_func_install(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        ESP_ERROR_CHECK(err);
+    }
+    for (int i = 0; i < 3; i++) {
+        ledc_cbs_t cbs = { .fade_cb = led_fade_done_cb };
+        ledc_cb_register(LEDC_MODE, led_channels[i], &cbs, (void *)(uintptr_t)i);
+    }
+}
+
+// Callback esp_timer: task duy nhất gọi LEDC cho 3 kênh RGB
+static void led_apply_cb(void *arg)
+{
+    if (led_fading_mask != 0) {
+#if SOC_LEDC_SUPPORT_FADE_STOP
+        // Màu mới thay fade đang chạy thay vì chờ nó kết thúc
+        for (int i = 0; i < 3; i++) {
+            ledc_fade_stop(LEDC_MODE, led_channels[i]);
+        }
+        portENTER_CRITICAL(&led_fade_lock);
+        led_fading_mask = 0;
+        portEXIT_CRITICAL(&led_fade_lock);
+#else
+        // Hẹn lại lúc fade cũ xong (fade-end ISR xóa bit của từng kênh)
+        int64_t wait_us = led_fade_end_us - esp_timer_get_time();
+        esp_timer_start_once(led_timer, (wait_us > 1000) ? (uint64_t)wait_us : 1000);
+        return;
+#endif
+    }
+
+    portENTER_CRITICAL(&led_req_lock);
+    bool pending = led_req_pending;
+    uint16_t target[3] = { led_req_rgb[0], led_req_rgb[1], led_req_rgb[2] };
+    uint32_t fade_ms = led_req_fade_ms;
+    led_req_pending = false;
+    portEXIT_CRITICAL(&led_req_lock);
+    if (!pending) return;
+
+    led_fade_end_us = esp_timer_get_time() + (int64_t)fade_ms * 1000;
+    for (int i = 0; i < 3; i++) {
+        uint32_t duty = target[i];
+        if (fade_ms == 0 || ledc_get_duty(LEDC_MODE, led_channels[i]) == duty) {
+            ledc_set_duty_and_update(LEDC_MODE, led_channels[i], duty, 0);
+        } else {
+            portENTER_CRITICAL(&led_fade_lock);
+            led_fading_mask |= 1u << i;
+            portEXIT_CRITICAL(&led_fade_lock);
+            ledc_set_fade_time_and_start(LEDC_MODE, led_channels[i], duty, fade_ms, LEDC_FADE_NO_WAIT);
+        }
+    }
 }
 
 void led_init(void) {
     ledc_init_channels();
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = led_apply_cb,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "led",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &led_timer));
+
     led_off();
 }
 
-void led_set_rgb(uint16_t r, uint16_t g, uint16_t b) {
-    // r,g,b expected 0-1023 (10-bit)
-    ledc_set_duty(LEDC_MODE, LEDC_CH_RED, r);
-    ledc_update_duty(LEDC_MODE, LEDC_CH_RED);
+void led_fade_rgb(uint16_t r, uint16_t g, uint16_t b, uint32_t fade_ms) {
+    if (led_timer == NULL) return;
 
-    ledc_set_duty(LEDC_MODE, LEDC_CH_GREEN, g);
-    ledc_update_duty(LEDC_MODE, LEDC_CH_GREEN);
+    // r,g,b expected 0-1023 (10-bit)
+    portENTER_CRITICAL(&led_req_lock);
+    led_req_pending = true;
+    led_req_rgb[0] = r > 1023 ? 1023 : r;
+    led_req_rgb[1] = g > 1023 ? 1023 : g;
+    led_req_rgb[2] = b > 1023 ? 1023 : b;
+    led_req_fade_ms = fade_ms;
+    portEXIT_CRITICAL(&led_req_lock);
+
+    // Chạy callback ngay; nếu nó đang chờ fade cũ thì sẽ tự hẹn lại
+    esp_timer_stop(led_timer);
+    esp_timer_start_once(led_timer, 0);
+}
 
-    ledc_set_duty(LEDC_MODE, LEDC_CH_BLUE, b);
-    ledc_update_duty(LEDC_MODE, LEDC_CH_BLUE);
+void led_set_rgb(uint16_t r, uint16_t g, uint16_t b) {
+    led_fade_rgb(r, g, b, 0);
 }
 
 void led_on(void) {
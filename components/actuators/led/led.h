@@ -12,4 +12,8 @@ void led_blink(uint16_t interval_ms);
 // Set RGB PWM duty (0-1023)
 void led_set_rgb(uint16_t r, uint16_t g, uint16_t b);
 
+// Chuyển sang màu mới trong fade_ms bằng LEDC fade phần cứng (0 -> đổi ngay). Không chặn:
+// chỉ ghi màu đích, esp_timer áp ngay (hoặc sau khi fade cũ xong nếu chip không dừng được fade).
+void led_fade_rgb(uint16_t r, uint16_t g, uint16_t b, uint32_t fade_ms);
+
 #endif
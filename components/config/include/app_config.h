@@ -21,4 +21,12 @@
 #define SENSOR_READ_INTERVAL_MS 5000
 #define MQTT_PUBLISH_INTERVAL_MS 5000
 
+// MQTT publish
+// 0 = một bản tin gộp smarthome/{room}/telemetry mỗi chu kỳ (mặc định)
+// 1 = gửi thêm các topic cũ sensors/{temp,humi,co2} và actuators/{fan,led,buzzer}
+//     cho dashboard/client chưa cập nhật
+#ifndef MQTT_PER_TOPIC_COMPAT
+#define MQTT_PER_TOPIC_COMPAT 0
+#endif
+
 #endif // APP_CONFIG_H
@@ -0,0 +1,44 @@
+// Sensor frame shared between sensor_task and its consumers
+#ifndef SENSOR_FRAME_H
+#define SENSOR_FRAME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Validity flags (bit mask in sensor_frame_t.flags)
+#define SENSOR_FRAME_SHT31_VALID  (1u << 0)  // temperature/humidity đọc được trong chu kỳ này
+#define SENSOR_FRAME_MQ135_VALID  (1u << 1)  // mq_raw hợp lệ (100-3800), air_level đã cập nhật
+#define SENSOR_FRAME_PPM_VALID    (1u << 2)  // mq_ppm được tính từ cùng mẫu với mq_raw
+
+/**
+ * @brief Một khung dữ liệu cảm biến, được tạo ra MỘT lần mỗi chu kỳ
+ *
+ * sensor_task là nơi duy nhất lấy mẫu; actuator, MQTT và LCD đều đọc
+ * cùng một frame nên không còn lấy mẫu lại hay lệch dữ liệu giữa các task.
+ * Khi một cảm biến lỗi, các trường của nó giữ giá trị hợp lệ gần nhất và
+ * bit tương ứng trong flags bị xóa.
+ */
+typedef struct {
+    uint32_t seq;            // Số thứ tự frame (tăng mỗi chu kỳ)
+    int64_t timestamp_us;    // esp_timer_get_time() lúc lấy mẫu
+    uint8_t flags;           // SENSOR_FRAME_*_VALID
+
+    // SHT31 (đã lọc moving average)
+    float temperature;       // °C
+    float humidity;          // %
+
+    // MQ135 - tất cả từ cùng một lần lấy mẫu
+    uint16_t mq_raw;         // ADC raw (0-4095)
+    float mq_vout;           // V
+    float mq_rs;             // kOhm
+    float mq_ratio;          // Rs/Ro
+    float mq_ppm;            // ppm (CO2 tương đương)
+    int air_level;           // 0=Good .. 4=Very Poor (đã lọc)
+} sensor_frame_t;
+
+static inline bool sensor_frame_has(const sensor_frame_t *frame, uint8_t flag)
+{
+    return (frame->flags & flag) != 0;
+}
+
+#endif // SENSOR_FRAME_H
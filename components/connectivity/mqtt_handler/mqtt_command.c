@@ -0,0 +1,251 @@
+#include "mqtt_payload.h"
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <stdint.h>
+
+// ========== PARSE (tokenizer tại chỗ) ==========
+// Đọc trực tiếp event->data theo độ dài: không cấp phát heap, không copy
+// payload, mọi lần đọc đều kiểm tra biên. Chỉ giữ "state" và "level"; các
+// khóa khác (kể cả object/array lồng nhau) được kiểm tra cú pháp rồi bỏ qua.
+
+#define CMD_MAX_DEPTH  8     // Độ sâu lồng tối đa của giá trị bị bỏ qua
+#define CMD_NUMBER_MAX 32    // Số dài hơn -> không hợp lệ
+#define CMD_KEY_MAX    16    // Khóa dài hơn bị cắt (không trùng "state"/"level")
+
+typedef struct {
+    const char *p;
+    const char *end;
+} cmd_cursor_t;
+
+static void skip_ws(cmd_cursor_t *c)
+{
+    while (c->p < c->end && (*c->p == ' ' || *c->p == '\t' || *c->p == '\n' || *c->p == '\r')) {
+        c->p++;
+    }
+}
+
+static bool peek_is(cmd_cursor_t *c, char ch)
+{
+    skip_ws(c);
+    return c->p < c->end && *c->p == ch;
+}
+
+static bool consume(cmd_cursor_t *c, char ch)
+{
+    if (!peek_is(c, ch)) return false;
+    c->p++;
+    return true;
+}
+
+static bool consume_literal(cmd_cursor_t *c, const char *lit)
+{
+    size_t n = strlen(lit);
+    if ((size_t)(c->end - c->p) < n || memcmp(c->p, lit, n) != 0) return false;
+    c->p += n;
+    return true;
+}
+
+static bool is_digit(char ch)
+{
+    return ch >= '0' && ch <= '9';
+}
+
+static int hex_value(char ch)
+{
+    if (is_digit(ch)) return ch - '0';
+    if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+    return -1;
+}
+
+// Chuỗi JSON: bỏ escape và copy vào out (cắt theo out_size); out = NULL -> chỉ bỏ qua
+static bool parse_string(cmd_cursor_t *c, char *out, size_t out_size)
+{
+    if (!consume(c, '"')) return false;
+
+    size_t n = 0;
+    while (c->p < c->end) {
+        char ch = *c->p++;
+        if (ch == '"') {
+            if (out != NULL && out_size > 0) out[n] = '\0';
+            return true;
+        }
+        if ((unsigned char)ch < 0x20) return false;  // Ký tự điều khiển phải được escape
+
+        if (ch == '\\') {
+            if (c->p >= c->end) return false;
+            char esc = *c->p++;
+            switch (esc) {
+                case '"': case '\\': case '/': ch = esc; break;
+                case 'b': ch = '\b'; break;
+                case 'f': ch = '\f'; break;
+                case 'n': ch = '\n'; break;
+                case 'r': ch = '\r'; break;
+                case 't': ch = '\t'; break;
+                case 'u': {
+                    // \uXXXX: giữ ký tự ASCII, còn lại thay bằng '?' (state chỉ dùng ASCII)
+                    if (c->end - c->p < 4) return false;
+                    int code = 0;
+                    for (int i = 0; i < 4; i++) {
+                        int h = hex_value(c->p[i]);
+                        if (h < 0) return false;
+                        code = (code << 4) | h;
+                    }
+                    c->p += 4;
+                    ch = (code > 0 && code < 0x80) ? (char)code : '?';
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+
+        if (out != NULL && n + 1 < out_size) out[n++] = ch;
+    }
+    return false;  // Thiếu dấu " đóng
+}
+
+// Số JSON: kiểm tra đúng ngữ pháp rồi strtod trên bản copy ngắn trong stack
+static bool parse_number(cmd_cursor_t *c, double *out)
+{
+    skip_ws(c);
+    const char *p = c->p;
+    bool is_int = true;
+
+    if (p < c->end && *p == '-') p++;
+    if (p >= c->end || !is_digit(*p)) return false;
+    if (*p == '0') {
+        p++;
+    } else {
+        while (p < c->end && is_digit(*p)) p++;
+    }
+    if (p < c->end && *p == '.') {
+        is_int = false;
+        p++;
+        if (p >= c->end || !is_digit(*p)) return false;
+        while (p < c->end && is_digit(*p)) p++;
+    }
+    if (p < c->end && (*p == 'e' || *p == 'E')) {
+        is_int = false;
+        p++;
+        if (p < c->end && (*p == '+' || *p == '-')) p++;
+        if (p >= c->end || !is_digit(*p)) return false;
+        while (p < c->end && is_digit(*p)) p++;
+    }
+
+    size_t len = (size_t)(p - c->p);
+    if (len >= CMD_NUMBER_MAX) return false;
+
+    // Đường nhanh cho số nguyên ngắn (level 0-4): không cần strtod
+    if (is_int && len <= 10) {
+        const char *q = c->p;
+        bool neg = (*q == '-');
+        int64_t v = 0;
+        for (q += neg ? 1 : 0; q < p; q++) v = v * 10 + (*q - '0');
+        *out = (double)(neg ? -v : v);
+        c->p = p;
+        return true;
+    }
+
+    char tmp[CMD_NUMBER_MAX];
+    memcpy(tmp, c->p, len);
+    tmp[len] = '\0';
+    *out = strtod(tmp, NULL);
+    c->p = p;
+    return true;
+}
+
+static bool skip_value(cmd_cursor_t *c, int depth)
+{
+    skip_ws(c);
+    if (c->p >= c->end) return false;
+
+    switch (*c->p) {
+        case '"':
+            return parse_string(c, NULL, 0);
+        case 't':
+            return consume_literal(c, "true");
+        case 'f':
+            return consume_literal(c, "false");
+        case 'n':
+            return consume_literal(c, "null");
+        case '{':
+        case '[': {
+            if (depth >= CMD_MAX_DEPTH) return false;
+            bool is_object = (*c->p == '{');
+            char close = is_object ? '}' : ']';
+            c->p++;
+            if (consume(c, close)) return true;
+            do {
+                if (is_object && (!parse_string(c, NULL, 0) || !consume(c, ':'))) return false;
+                if (!skip_value(c, depth + 1)) return false;
+            } while (consume(c, ','));
+            return consume(c, close);
+        }
+        default: {
+            double ignored;
+            return parse_number(c, &ignored);
+        }
+    }
+}
+
+// Giống cJSON valueint: bão hòa ở INT_MIN/INT_MAX, phần thập phân bị cắt
+static int number_to_int(double v)
+{
+    if (v >= (double)INT_MAX) return INT_MAX;
+    if (v <= (double)INT_MIN) return INT_MIN;
+    return (int)v;
+}
+
+bool mqtt_command_parse(const char *data, size_t len, mqtt_command_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (data == NULL) {
+        return false;
+    }
+
+    mqtt_command_t cmd;
+    memset(&cmd, 0, sizeof(cmd));
+    cmd_cursor_t c = { .p = data, .end = data + len };
+
+    if (!consume(&c, '{')) {
+        return false;
+    }
+    if (!consume(&c, '}')) {
+        do {
+            char key[CMD_KEY_MAX];
+            if (!parse_string(&c, key, sizeof(key)) || !consume(&c, ':')) {
+                return false;
+            }
+
+            // Như cJSON_GetObjectItem: so khóa không phân biệt hoa/thường, khóa trùng giữ giá trị đầu
+            if (!cmd.has_state && strcasecmp(key, "state") == 0 && peek_is(&c, '"')) {
+                if (!parse_string(&c, cmd.state, sizeof(cmd.state))) return false;
+                cmd.has_state = true;
+            } else if (!cmd.has_level && strcasecmp(key, "level") == 0 &&
+                       (peek_is(&c, '-') || (c.p < c.end && is_digit(*c.p)))) {
+                double level;
+                if (!parse_number(&c, &level)) return false;
+                cmd.level = number_to_int(level);
+                cmd.has_level = true;
+            } else if (!skip_value(&c, 1)) {
+                return false;
+            }
+        } while (consume(&c, ','));
+
+        if (!consume(&c, '}')) {
+            return false;
+        }
+    }
+
+    // Sau object chỉ cho phép khoảng trắng hoặc '\0' (payload từ C string)
+    skip_ws(&c);
+    if (c.p < c.end && *c.p != '\0') {
+        return false;
+    }
+
+    *out = cmd;
+    return true;
+}
@@ -1,23 +1,31 @@
 #include "mqtt_handler.h"
+#include "app_config.h"
+#include "mqtt_payload.h"
+#include "mqtt_policy.h"
+#include "mqtt_spool.h"
+#include "mqtt_router.h"
+#include "mqtt_reassembly.h"
+#include "mqtt_outbox.h"
+#include "mqtt_tls.h"
+#include "mqtt_v5.h"
 #include "mqtt_client.h"
 #include "esp_log.h"
 #include "esp_timer.h"
-#include "cJSON.h"
 #include <string.h>
 #include <stdio.h>
 #include "esp_event.h" 
 #include "stdint.h"
 
-// Import actuator control functions
-#include "fan.h"
-#include "led.h"
-#include "buzzer.h"
+// Fan/LED/buzzer chỉ được điều khiển qua shadow (dùng chung với AUTO mode)
+#include "actuator_shadow.h"
+#include "actuator_cmd.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
 static const char *TAG = "MQTT";
 
 static esp_mqtt_client_handle_t client = NULL;
+static esp_mqtt_client_config_t mqtt_cfg;   // Giữ lại để hạ xuống MQTT 3.1.1 nếu broker từ chối v5
 static bool is_connected = false;
 
 // ===============================================
@@ -34,39 +42,122 @@ static char topic_fan[128];
 static char topic_led[128];
 static char topic_buzzer[128];
 static char topic_auto[64];
+static char topic_telemetry[80];
+static char topic_replay[96];
+
+// Định dạng telemetry: 1 = nhị phân trên .../telemetry/bin (xem mqtt_payload.h),
+// 0 = JSON trên .../telemetry. Dashboard giải mã được cả hai.
+#ifndef MQTT_TELEMETRY_BINARY
+#define MQTT_TELEMETRY_BINARY 1
+#endif
+#if MQTT_TELEMETRY_BINARY
+#define TELEMETRY_TOPIC_SUFFIX "/bin"
+#else
+#define TELEMETRY_TOPIC_SUFFIX ""
+#endif
 
-static const char *hivemq_ca_cert = 
-"-----BEGIN CERTIFICATE-----\n"
-"MIIFazCCA1OgAwIBAgIRAIIQz7DSQONZRGPgu2OCiwAwDQYJKoZIhvcNAQELBQAw\n"
-"TzELMAkGA1UEBhMCVVMxKTAnBgNVBAoTIEludGVybmV0IFNlY3VyaXR5IFJlc2Vh\n"
-"cmNoIEdyb3VwMRUwEwYDVQQDEwxJU1JHIFJvb3QgWDEwHhcNMTUwNjA0MTEwNDM4\n"
-"WhcNMzUwNjA0MTEwNDM4WjBPMQswCQYDVQQGEwJVUzEpMCcGA1UEChMgSW50ZXJu\n"
-"ZXQgU2VjdXJpdHkgUmVzZWFyY2ggR3JvdXAxFTATBgNVBAMTDElTUkcgUm9vdCBY\n"
-"MTCCAiIwDQYJKoZIhvcNAQEBBQADggIPADCCAgoCggIBAK3oJHP0FDfzm54rVygc\n"
-"h77ct984kIxuPOZXoHj3dcKi/vVqbvYATyjb3miGbESTtrFj/RQSa78f0uoxmyF+\n"
-"0TM8ukj13Xnfs7j/EvEhmkvBioZxaUpmZmyPfjxwv60pIgbz5MDmgK7iS4+3mX6U\n"
-"A5/TR5d8mUgjU+g4rk8Kb4Mu0UlXjIB0ttov0DiNewNwIRt18jA8+o+u3dpjq+sW\n"
-"T8KOEUt+zwvo/7V3LvSye0rgTBIlDHCNAymg4VMk7BPZ7hm/ELNKjD+Jo2FR3qyH\n"
-"B5T0Y3HsLuJvW5iB4YlcNHlsdu87kGJ55tukmi8mxdAQ4Q7e2RCOFvu396j3x+UC\n"
-"B5iPNgiV5+I3lg02dZ77DnKxHZu8A/lJBdiB3QW0KtZB6awBdpUKD9jf1b0SHzUv\n"
-"KBds0pjBqAlkd25HN7rOrFleaJ1/ctaJxQZBKT5ZPt0m9STJEadao0xAH0ahmbWn\n"
-"OlFuhjuefXKnEgV4We0+UXgVCwOPjdAvBbI+e0ocS3MFEvzG6uBQE3xDk3SzynTn\n"
-"jh8BCNAw1FtxNrQHusEwMFxIt4I7mKZ9YIqioymCzLq9gwQbooMDQaHWBfEbwrbw\n"
-"qHyGO0aoSCqI3Haadr8faqU9GY/rOPNk3sgrDQoo//fb4hVC1CLQJ13hef4Y53CI\n"
-"rU7m2Ys6xt0nUW7/vGT1M0NPAgMBAAGjQjBAMA4GA1UdDwEB/wQEAwIBBjAPBgNV\n"
-"HRMBAf8EBTADAQH/MB0GA1UdDgQWBBR5tFnme7bl5AFzgAiIyBpY9umbbjANBgkq\n"
-"hkiG9w0BAQsFAAOCAgEAVR9YqbyyqFDQDLHYGmkgJykIrGF1XIpu+ILlaS/V9lZL\n"
-"ubhzEFnTIZd+50xx+7LSYK05qAvqFyFWhfFQDlnrzuBZ6brJFe+GnY+EgPbk6ZGQ\n"
-"3BebYhtF8GaV0nxvwuo77x/Py9auJ/GpsMiu/X1+mvoiBOv/2X/qkSsisRcOj/KK\n"
-"NFtY2PwByVS5uCbMiogziUwthDyC3+6WVwW6LLv3xLfHTjuCvjHIInNzktHCgKQ5\n"
-"ORAzI4JMPJ+GslWYHb4phowim57iaztXOoJwTdwJx4nLCgdNbOhdjsnvzqvHu7Ur\n"
-"TkXWStAmzOVyyghqpZXjFaH3pO3JLF+l+/+sKAIuvtd7u+Nxe5AW0wdeRlN8NwdC\n"
-"jNPElpzVmbUq4JUagEiuTDkHzsxHpFKVK7q4+63SM1N95R1NbdWhscdCb+ZAJzVc\n"
-"oyi3B43njTOQ5yOf+1CceWxG1bQVs5ZufpsMljq4Ui0/1lvh+wjChP4kqKOJ2qxq\n"
-"4RgqsahDYVvTH9w7jXbyLeiNdd8XM2w9U/t7y0Ff/9yi0GE44Za4rF2LN9d11TPA\n"
-"mRGunUHBcnWEvgJBQl9nJEiU0Zsnvgc/ubhPgXRR4Xq37Z0j4r7g1SgEEzwxA57d\n"
-"emyPxgcYxn/eR44/KJ4EBs+lVDR3veyJm+kXQ99b21/+jh5Xos1AnX5iItreGCc=\n"
-"-----END CERTIFICATE-----\n";
+// ===============================================
+// REPORT-BY-EXCEPTION: DEADBAND + HEARTBEAT (mqtt_policy.h)
+// ===============================================
+#ifndef MQTT_HEARTBEAT_MS
+#define MQTT_HEARTBEAT_MS 60000       // Gửi lại ít nhất mỗi phút dù không đổi
+#endif
+#define MQTT_DEADBAND_TEMP     0.1f   // °C
+#define MQTT_DEADBAND_HUMI     0.5f   // %
+#define MQTT_DEADBAND_CO2_ABS  10.0f  // ppm
+#define MQTT_DEADBAND_CO2_REL  0.02f  // 2%
+#define MQTT_POLICY_MAX_TOPICS 8      // Số topic cũ (compat) được theo dõi
+
+static const mqtt_policy_cfg_t policy_temp = { .abs_deadband = MQTT_DEADBAND_TEMP, .heartbeat_ms = MQTT_HEARTBEAT_MS };
+static const mqtt_policy_cfg_t policy_humi = { .abs_deadband = MQTT_DEADBAND_HUMI, .heartbeat_ms = MQTT_HEARTBEAT_MS };
+static const mqtt_policy_cfg_t policy_co2 = {
+    .abs_deadband = MQTT_DEADBAND_CO2_ABS, .rel_deadband = MQTT_DEADBAND_CO2_REL, .heartbeat_ms = MQTT_HEARTBEAT_MS,
+};
+// Trạng thái rời rạc (mức AQ, mode, actuator): gửi khi có bất kỳ thay đổi nào
+static const mqtt_policy_cfg_t policy_discrete = { .heartbeat_ms = MQTT_HEARTBEAT_MS };
+
+// Các kênh của telemetry gộp
+enum {
+    TLM_CH_TEMP = 0,
+    TLM_CH_HUMI,
+    TLM_CH_CO2,
+    TLM_CH_AQ,
+    TLM_CH_VALID,
+    TLM_CH_MODE,
+    TLM_CH_FAN,
+    TLM_CH_LED,
+    TLM_CH_BUZZER,
+    TLM_CH_COUNT
+};
+
+static mqtt_policy_stream_t telemetry_streams[TLM_CH_COUNT];
+static mqtt_policy_stats_t telemetry_stats;
+
+// Topic cũ (MQTT_PER_TOPIC_COMPAT): một stream cho mỗi topic
+typedef struct {
+    char topic[128];
+    mqtt_policy_stream_t stream;
+} topic_policy_t;
+
+static topic_policy_t topic_policies[MQTT_POLICY_MAX_TOPICS];
+static int topic_policy_count = 0;
+static portMUX_TYPE policy_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// ===============================================
+// OFFLINE SPOOL REPLAY (mqtt_spool.h)
+// ===============================================
+// Sau reconnect: mỗi MQTT_SPOOL_REPLAY_INTERVAL_MS gửi tối đa
+// MQTT_SPOOL_REPLAY_BATCH record cũ nhất. Task ưu tiên thấp hơn mqtt_task và
+// bỏ qua đợt khi ring publish + outbox còn nhiều -> bản tin live không phải
+// xếp hàng sau lịch sử.
+#ifndef MQTT_SPOOL_REPLAY_BATCH
+#define MQTT_SPOOL_REPLAY_BATCH 10
+#endif
+#ifndef MQTT_SPOOL_REPLAY_INTERVAL_MS
+#define MQTT_SPOOL_REPLAY_INTERVAL_MS 500
+#endif
+#define MQTT_SPOOL_OUTBOX_LIMIT 2048   // byte chờ gửi (mqtt_outbox_backlog())
+
+static TaskHandle_t spool_task_handle = NULL;
+
+// ===============================================
+// ĐỊNH TUYẾN BẢN TIN ĐẾN (mqtt_router.h)
+// ===============================================
+#define MQTT_EXTRA_ROUTES_MAX 4
+
+typedef struct {
+    char topic[MQTT_ROUTER_TOPIC_MAX];
+    mqtt_route_handler_t handler;
+    void *ctx;
+} extra_route_t;
+
+static mqtt_router_t router;
+static extra_route_t extra_routes[MQTT_EXTRA_ROUTES_MAX];
+static int extra_route_count = 0;
+
+// Payload lớn hơn buffer nhận của esp-mqtt đến thành nhiều MQTT_EVENT_DATA:
+// ghép trong buffer tĩnh (không tăng stack task MQTT / CONFIG_MQTT_BUFFER_SIZE).
+// Bản tin lớn hơn MQTT_RX_REASSEMBLY_MAX bị bỏ và đếm lại.
+#ifndef MQTT_RX_REASSEMBLY_MAX
+#define MQTT_RX_REASSEMBLY_MAX 2048
+#endif
+
+static char rx_buffer[MQTT_RX_REASSEMBLY_MAX];
+static mqtt_reasm_t rx_reasm;
+static const mqtt_route_t *rx_route = NULL;   // Route của bản tin đang nhận
+
+// ===============================================
+// BROKER (ghi đè khi build: idf.py -DMQTT_BROKER_URI=... , xem README)
+// ===============================================
+#ifndef MQTT_BROKER_URI
+#define MQTT_BROKER_URI "mqtts://19059388a61f4c8286066fda62e74315.s1.eu.hivemq.cloud:8883"
+#endif
+#ifndef MQTT_BROKER_USERNAME
+#define MQTT_BROKER_USERNAME "trinity"
+#endif
+#ifndef MQTT_BROKER_PASSWORD
+#define MQTT_BROKER_PASSWORD "Hung123456789"
+#endif
 
 // ===============================================
 // 🆕 HÀM SUBSCRIBE/UNSUBSCRIBE ACTUATOR TOPICS
@@ -94,101 +185,118 @@ static void unsubscribe_actuator_topics(void)
 }
 
 // ===============================================
-// 🆕 HÀM REPORT TRẠNG THÁI THỰC TẾ (FIX VẤN ĐỀ 2)
+// PUBLISH BY EXCEPTION (DEADBAND + HEARTBEAT)
 // ===============================================
-static void mqtt_report_actuator_state(const char *device, const char *state, int level, bool success)
+static void telemetry_policy_init(void)
 {
-    if (!is_connected || client == NULL) return;
-
-    char topic[128];
-    char payload[128];
-    
-    // Topic: smarthome/{room}/actuators/{device}/reported
-    snprintf(topic, sizeof(topic), "smarthome/%s/actuators/%s/reported", current_room_id, device);
-    
-    // Payload: {"state":"ON", "level":70, "success":true}
-    snprintf(payload, sizeof(payload), 
-             "{\"state\":\"%s\",\"level\":%d,\"success\":%s}", 
-             state, level, success ? "true" : "false");
+    const mqtt_policy_cfg_t *cfgs[TLM_CH_COUNT] = {
+        [TLM_CH_TEMP] = &policy_temp,
+        [TLM_CH_HUMI] = &policy_humi,
+        [TLM_CH_CO2] = &policy_co2,
+        [TLM_CH_AQ] = &policy_discrete,
+        [TLM_CH_VALID] = &policy_discrete,
+        [TLM_CH_MODE] = &policy_discrete,
+        [TLM_CH_FAN] = &policy_discrete,
+        [TLM_CH_LED] = &policy_discrete,
+        [TLM_CH_BUZZER] = &policy_discrete,
+    };
+    for (int i = 0; i < TLM_CH_COUNT; i++) {
+        mqtt_policy_init(&telemetry_streams[i], cfgs[i]);
+    }
+}
 
-    esp_mqtt_client_publish(client, topic, payload, 0, 1, 0);
-    ESP_LOGI(TAG, "📡 Reported %s state: %s", device, payload);
+// Sau reconnect: gửi lại mọi thứ ở chu kỳ kế tiếp để client có trạng thái mới
+static void publish_policy_reset_all(void)
+{
+    taskENTER_CRITICAL(&policy_lock);
+    for (int i = 0; i < TLM_CH_COUNT; i++) {
+        mqtt_policy_reset(&telemetry_streams[i]);
+    }
+    for (int i = 0; i < topic_policy_count; i++) {
+        mqtt_policy_reset(&topic_policies[i].stream);
+    }
+    taskEXIT_CRITICAL(&policy_lock);
 }
-// ===============================================
-// set level cho fan (0=OFF,1=50%,2=100%)
-// 
-// ===============================================
-static void fan_set_level(int level)
+
+// Quyết định cho topic cũ; topic mới được đăng ký với cấu hình theo hậu tố
+static bool topic_policy_should_send(const char *topic, float value)
 {
-    const char* level_names[] = {"OFF", "50", "100"};
-    
-    if (level < 0) level = 0;
-    if (level > 2) level = 2;
-    
-    ESP_LOGI(TAG, "🌀 FAN Level %d: %s", level, level_names[level]);
-    
-    switch (level) {
-        case 0: // OFF - Good air quality
-            fan_off();
-            break;
-        case 1: // 50% - Moderate air quality
-            fan_set_speed(50);
-            break;
-        case 2: // 100% - Poor air quality
-            fan_on(); // Full speed
-            break;
-        default:
-            fan_off();
+    int64_t now_ms = esp_timer_get_time() / 1000;
+    bool send = true;
+
+    taskENTER_CRITICAL(&policy_lock);
+    topic_policy_t *slot = NULL;
+    for (int i = 0; i < topic_policy_count; i++) {
+        if (strcmp(topic_policies[i].topic, topic) == 0) {
+            slot = &topic_policies[i];
             break;
+        }
+    }
+    if (slot == NULL && topic_policy_count < MQTT_POLICY_MAX_TOPICS) {
+        slot = &topic_policies[topic_policy_count++];
+        strncpy(slot->topic, topic, sizeof(slot->topic) - 1);
+        const char *suffix = strrchr(topic, '/');
+        const mqtt_policy_cfg_t *cfg = &policy_discrete;
+        if (suffix && strcmp(suffix, "/temp") == 0) cfg = &policy_temp;
+        else if (suffix && strcmp(suffix, "/humi") == 0) cfg = &policy_humi;
+        else if (suffix && strcmp(suffix, "/co2") == 0) cfg = &policy_co2;
+        mqtt_policy_init(&slot->stream, cfg);
     }
+    if (slot != NULL) {
+        send = mqtt_policy_should_send(&slot->stream, value, now_ms);
+    }
+    taskEXIT_CRITICAL(&policy_lock);
+
+    return send;  // Hết slot -> luôn gửi như trước
+}
+
+void mqtt_get_publish_stats(mqtt_policy_stats_t *out)
+{
+    if (out == NULL) return;
+
+    taskENTER_CRITICAL(&policy_lock);
+    *out = telemetry_stats;
+    for (int i = 0; i < topic_policy_count; i++) {
+        out->sent += topic_policies[i].stream.stats.sent;
+        out->suppressed += topic_policies[i].stream.stats.suppressed;
+    }
+    taskEXIT_CRITICAL(&policy_lock);
 }
 
 // ===============================================
-// 🆕 HÀM SET LED THEO LEVEL (NON-BLOCKING)
-// LED Colors by Air Quality Level:
-// Level 0: Green      (0, 1023, 0)     - Good
-// Level 1: Cyan       (0, 1023, 1023)  - Fair
-// Level 2: Yellow     (1023, 1023, 0)  - Moderate
-// Level 3: Red        (1023, 0, 0)     - Poor
-// Level 4: Purple     (1023, 0, 1023)  - Very Poor
+// 🆕 HÀM REPORT TRẠNG THÁI THỰC TẾ (FIX VẤN ĐỀ 2)
 // ===============================================
-static void led_set_level(int level)
+static void mqtt_report_actuator_state(const char *device, const char *state, int level, bool success)
 {
-    const char* level_names[] = {"Green (Good)", "Cyan (Fair)", "Yellow (Moderate)", 
-                                  "Red (Poor)", "Purple (Very Poor)"};
-    
-    if (level < 0) level = 0;
-    if (level > 4) level = 4;
+    if (!is_connected || client == NULL) return;
+
+    char topic[128];
+    char payload[MQTT_PAYLOAD_MAX];
     
-    ESP_LOGI(TAG, "💡 LED Level %d: %s", level, level_names[level]);
+    // Topic: smarthome/{room}/actuators/{device}/reported
+    snprintf(topic, sizeof(topic), "smarthome/%s/actuators/%s/reported", current_room_id, device);
     
-    switch (level) {
-        case 0: // Green - Good
-            led_set_rgb(0, 1023, 0);
-            break;
-        case 1: // Cyan - Fair
-            led_set_rgb(0, 1023, 1023);
-            break;
-        case 2: // Yellow - Moderate
-            led_set_rgb(1023, 1023, 0);
-            break;
-        case 3: // Red - Poor
-            led_set_rgb(1023, 0, 0);
-            break;
-        case 4: // Purple - Very Poor
-            led_set_rgb(1023, 0, 1023);
-            break;
-        default:
-            led_set_rgb(0, 0, 0);
-            break;
+    // Payload: {"state":"ON", "level":70, "success":true}
+    mqtt_payload_reported(payload, sizeof(payload), state, level, success);
+
+    if (mqtt_outbox_publish(MQTT_STREAM_REPORT, topic, payload, strlen(payload)) != ESP_OK) {
+        ESP_LOGW(TAG, "⚠️ Publish queue full, %s report dropped", device);
+        return;
     }
+    ESP_LOGI(TAG, "📡 Reported %s state: %s", device, payload);
 }
 
 // ===============================================
 // 🆕 HÀM XỬ LÝ LỆNH ĐIỀU KHIỂN TỪ WEB
 // ===============================================
-static void handle_actuator_command(const char *topic, const char *payload)
+static void handle_actuator_command(actuator_id_t device, const char *payload, size_t payload_len)
 {
+    // ✅ CHỈ XỬ LÝ LỆNH ĐIỀU KHIỂN KHI Ở MANUAL MODE
+    if (is_auto_mode) {
+        ESP_LOGW(TAG, "⚠️ Ignored actuator command (AUTO mode active)");
+        return;
+    }
+
     // ✅ FIX VẤN ĐỀ 1: Kiểm tra initialized
     if (!auto_mode_initialized) {
         ESP_LOGW(TAG, "⚠️ Auto mode not initialized, waiting for smarthome/auto");
@@ -196,87 +304,207 @@ static void handle_actuator_command(const char *topic, const char *payload)
     }
 
     // Parse JSON: {"state":"ON", "level":70}
-    cJSON *root = cJSON_Parse(payload);
-    if (root == NULL) {
-        ESP_LOGE(TAG, "Failed to parse JSON: %s", payload);
+    mqtt_command_t cmd;
+    if (!mqtt_command_parse(payload, payload_len, &cmd)) {
+        ESP_LOGE(TAG, "Failed to parse JSON: %.*s", (int)payload_len, payload);
         return;
     }
 
-    const char *state = NULL;
-    int level = 0;
-    bool success = true;
+    const char *state = cmd.has_state ? cmd.state : NULL;
+    const char *device_name = actuator_shadow_name(device);
+    ESP_LOGD(TAG, "📥 Command: %s → state=%s, level=%d", device_name, state ? state : "NULL", cmd.level);
+
+    // Fan 0-2, LED 0-4 (Green..Purple, match AUTO mode), buzzer 0-3: shadow kẹp level.
+    // Chỉ ghi slot lệnh mới nhất; actuator_task áp và report (on_actuator_changed)
+    bool on = (state != NULL && strcmp(state, "ON") == 0);
+    actuator_cmd_post(device, on, cmd.level);
+}
 
-    cJSON *state_item = cJSON_GetObjectItem(root, "state");
-    if (state_item && cJSON_IsString(state_item)) {
-        state = state_item->valuestring;
+// ===============================================
+// ✅ XỬ LÝ CHUYỂN ĐỔI AUTO/MANUAL (smarthome/auto)
+// ===============================================
+static void handle_auto_mode(const char *data, size_t data_len, void *ctx)
+{
+    (void) ctx;
+    mqtt_command_t cmd;
+    if (!mqtt_command_parse(data, data_len, &cmd) || !cmd.has_state) {
+        return;
     }
 
-    cJSON *level_item = cJSON_GetObjectItem(root, "level");
-    if (level_item && cJSON_IsNumber(level_item)) {
-        level = level_item->valueint;
+    bool new_mode = mqtt_command_is_on(&cmd);
+
+    // ✅ FIX VẤN ĐỀ 1: Đánh dấu đã initialized
+    if (!auto_mode_initialized) {
+        auto_mode_initialized = true;
+        ESP_LOGI(TAG, "✅ Auto mode initialized from web");
     }
 
-    ESP_LOGI(TAG, "📥 Command: %s → state=%s, level=%d", topic, state ? state : "NULL", level);
+    // ✅ FIX VẤN ĐỀ 3: Subscribe/Unsubscribe theo mode
+    if (new_mode != is_auto_mode) {
+        is_auto_mode = new_mode;
 
-    // Xác định thiết bị từ topic
-    const char *device_name = NULL;
-    
-    // ========== FAN CONTROL - FIXED VERSION ==========
-    
-    if (strstr(topic, "/fan") != NULL) {
-        device_name = "fan";
-        
-        if (state && strcmp(state, "ON") == 0) {
-            // ✅ FIX: Sử dụng level trực tiếp từ web (0, 1, 2)
-            int fan_level = level;
-            
-            // Đảm bảo level trong khoảng hợp lệ
-            if (fan_level < 0) fan_level = 0;
-            if (fan_level > 2) fan_level = 2;
-            
-            fan_set_level(fan_level);
-            level = fan_level; // Report level đã sử dụng
-            
-            const char* level_desc[] = {"OFF", "50%", "100%"};
-            ESP_LOGI(TAG, "✅ FAN set to level %d (%s)", fan_level, level_desc[fan_level]);
+        if (is_auto_mode) {
+            ESP_LOGI(TAG, "🤖 Switched to AUTO mode");
+            unsubscribe_actuator_topics();
+
+            // ✅ Reset buzzer từ MANUAL mode (instant with Task Notification)
+            actuator_shadow_set(ACTUATOR_BUZZER, false, 0);
+
+            // ✅ TRIGGER ACTUATOR UPDATE NGAY LẬP TỨC
+            // Để fan/LED/buzzer cập nhật theo sensor hiện tại
+            trigger_actuator_update();
+            ESP_LOGI(TAG, "🔄 Actuators will update to current sensor values");
         } else {
-            fan_set_level(0); // OFF
-            level = 0;
-            ESP_LOGI(TAG, "✅ FAN OFF");
+            ESP_LOGI(TAG, "👤 Switched to MANUAL mode");
+            subscribe_actuator_topics();
         }
     }
-    // ========== LED CONTROL ==========
-    // Level: 0=Green, 1=Cyan, 2=Yellow, 3=Red, 4=Purple (match AUTO mode)
-    else if (strstr(topic, "/led") != NULL) {
-        device_name = "led";
-        
-        if (state && strcmp(state, "ON") == 0) {
-            led_set_level(level);
-        } else {
-            led_set_rgb(0, 0, 0);
-            level = 0;
-            ESP_LOGI(TAG, "✅ LED OFF");
+}
+
+static void route_actuator_command(const char *data, size_t data_len, void *ctx)
+{
+    handle_actuator_command((actuator_id_t)(intptr_t)ctx, data, data_len);
+}
+
+// ===============================================
+// BẢNG ĐỊNH TUYẾN TOPIC (dựng lại mỗi lần CONNECTED)
+// ===============================================
+static void build_routes(void)
+{
+    mqtt_router_init(&router);
+    mqtt_router_add(&router, topic_auto, handle_auto_mode, NULL);
+    mqtt_router_add(&router, topic_fan, route_actuator_command, (void *)(intptr_t)ACTUATOR_FAN);
+    mqtt_router_add(&router, topic_led, route_actuator_command, (void *)(intptr_t)ACTUATOR_LED);
+    mqtt_router_add(&router, topic_buzzer, route_actuator_command, (void *)(intptr_t)ACTUATOR_BUZZER);
+
+    // Topic đăng ký thêm qua mqtt_register_command_handler(): luôn subscribe
+    for (int i = 0; i < extra_route_count; i++) {
+        if (!mqtt_router_add(&router, extra_routes[i].topic, extra_routes[i].handler, extra_routes[i].ctx)) {
+            ESP_LOGE(TAG, "❌ Route table full, dropped %s", extra_routes[i].topic);
+            continue;
         }
+        esp_mqtt_client_subscribe(client, extra_routes[i].topic, 1);
+        ESP_LOGI(TAG, "📩 Subscribed to: %s", extra_routes[i].topic);
     }
-    // ========== BUZZER CONTROL ==========
-    // Level: 0=OFF, 1-3=pattern (using buzzer_set_level API with Task Notification)
-    else if (strstr(topic, "/buzzer") != NULL) {
-        device_name = "buzzer";
-        
-        if (state && strcmp(state, "ON") == 0) {
-            buzzer_set_level(level);  // Instant response with Task Notification!
-        } else {
-            buzzer_set_level(0);  // Stop immediately
-            level = 0;
+}
+
+// ===============================================
+// REPLAY TELEMETRY TỪ OFFLINE SPOOL
+// ===============================================
+// Mã hóa theo MQTT_TELEMETRY_BINARY; trả về số byte, -1 nếu không vừa buffer
+static int telemetry_encode(char *buf, size_t size, const mqtt_telemetry_t *t)
+{
+#if MQTT_TELEMETRY_BINARY
+    return mqtt_payload_telemetry_bin((uint8_t *)buf, size, t);
+#else
+    int len = mqtt_payload_telemetry(buf, size, t);
+    return (len < 0 || len >= (int)size) ? -1 : len;
+#endif
+}
+
+static void spool_replay_batch(void)
+{
+    if (mqtt_outbox_backlog() > MQTT_SPOOL_OUTBOX_LIMIT) {
+        return;  // Broker chưa ACK kịp, nhường cho bản tin live
+    }
+
+    for (int i = 0; i < MQTT_SPOOL_REPLAY_BATCH && is_connected; i++) {
+        mqtt_telemetry_t telemetry;
+        uint32_t token;
+        if (mqtt_spool_peek(&telemetry, &token) != ESP_OK) {
+            break;
+        }
+
+        char payload[MQTT_TELEMETRY_MAX];
+        int len = telemetry_encode(payload, sizeof(payload), &telemetry);
+        if (len < 0) {
+            ESP_LOGE(TAG, "❌ Replay payload too large, dropping seq=%lu", (unsigned long)telemetry.seq);
+            mqtt_spool_pop(token);
+            continue;
         }
+
+        const mqtt_outbox_meta_t meta = { .seq = telemetry.seq, .ts_ms = (uint32_t)telemetry.uptime_ms };
+        if (mqtt_outbox_publish_meta(MQTT_STREAM_REPLAY, topic_replay, payload, len, &meta) != ESP_OK) {
+            break;  // Ring đã chạm phần dành cho live: giữ record, thử lại ở đợt sau
+        }
+        mqtt_spool_pop(token);
+        ESP_LOGD(TAG, "📼 Replayed seq=%lu (%d bytes)", (unsigned long)telemetry.seq, len);
     }
+}
+
+static void spool_replay_task(void *pvParameters)
+{
+    (void) pvParameters;
+    bool draining = false;
+
+    while (1) {
+        // CONNECTED đánh thức ngay; offline thì ngủ đến lần kết nối sau
+        ulTaskNotifyTake(pdTRUE, is_connected ? pdMS_TO_TICKS(MQTT_SPOOL_REPLAY_INTERVAL_MS)
+                                              : portMAX_DELAY);
+        if (!is_connected || client == NULL) {
+            continue;
+        }
 
-    // ✅ FIX VẤN ĐỀ 2: Report trạng thái thực tế phần cứng
-    if (device_name != NULL) {
-        mqtt_report_actuator_state(device_name, state ? state : "OFF", level, success);
+        uint32_t pending = mqtt_spool_pending();
+        if (pending == 0) {
+            if (draining) {
+                mqtt_spool_stats_t st;
+                mqtt_spool_get_stats(&st);
+                ESP_LOGI(TAG, "📼 Spool drained (replayed=%lu dropped=%lu corrupt=%lu)",
+                         (unsigned long)st.replayed, (unsigned long)st.dropped, (unsigned long)st.corrupt);
+                draining = false;
+            }
+            continue;
+        }
+        if (!draining) {
+            ESP_LOGI(TAG, "📼 Replaying %lu spooled telemetry records", (unsigned long)pending);
+            draining = true;
+        }
+        spool_replay_batch();
     }
+}
 
-    cJSON_Delete(root);
+// ===============================================
+// NHẬN BẢN TIN: ĐỊNH TUYẾN + GHÉP FRAGMENT
+// ===============================================
+static void handle_data_event(esp_mqtt_event_handle_t event)
+{
+    // Fragment đầu mang topic: tìm route trước, bản tin không ai nhận thì khỏi ghép
+    if (event->current_data_offset == 0) {
+        ESP_LOGI(TAG, "📩 MQTT RX: %.*s (%d bytes)",
+                 event->topic_len, event->topic, event->total_data_len);
+
+        // Topic không kết thúc bằng '\0' -> tra bảng theo (topic, topic_len)
+        rx_route = mqtt_router_find(&router, event->topic, event->topic_len);
+        if (rx_route == NULL) {
+            ESP_LOGD(TAG, "No route for %.*s", event->topic_len, event->topic);
+        }
+    }
+    if (rx_route == NULL) {
+        return;
+    }
+
+    const char *payload;
+    size_t payload_len;
+    switch (mqtt_reasm_feed(&rx_reasm, event->data, event->data_len, event->current_data_offset,
+                            event->total_data_len, &payload, &payload_len)) {
+        case MQTT_REASM_COMPLETE:
+            ESP_LOGD(TAG, "📩 Payload: %.*s", (int)payload_len, payload);
+            rx_route->handler(payload, payload_len, rx_route->ctx);
+            break;
+        case MQTT_REASM_OVERFLOW:
+            ESP_LOGW(TAG, "⚠️ Dropping %d-byte message on %s (limit %d)",
+                     event->total_data_len, rx_route->topic, MQTT_RX_REASSEMBLY_MAX);
+            break;
+        case MQTT_REASM_ERROR:
+            ESP_LOGW(TAG, "⚠️ Out-of-order fragment at offset %d, message dropped",
+                     event->current_data_offset);
+            rx_route = NULL;
+            break;
+        case MQTT_REASM_PENDING:
+        default:
+            break;
+    }
 }
 
 // ===============================================
@@ -293,12 +521,18 @@ static void mqtt_event_handler(void *handler_args,
         case MQTT_EVENT_CONNECTED:
             ESP_LOGI(TAG, "✅ MQTT connected");
             is_connected = true;
+            mqtt_tls_on_connected();
+            mqtt_v5_on_connected(event->protocol_ver);
+            publish_policy_reset_all();
+            if (spool_task_handle != NULL) {
+                xTaskNotifyGive(spool_task_handle);  // Bắt đầu replay telemetry offline
+            }
 
             // Tạo topics
-            snprintf(topic_fan, sizeof(topic_fan), "smarthome/%s/actuators/fan", current_room_id);
-            snprintf(topic_led, sizeof(topic_led), "smarthome/%s/actuators/led", current_room_id);
-            snprintf(topic_buzzer, sizeof(topic_buzzer), "smarthome/%s/actuators/buzzer", current_room_id);
             snprintf(topic_auto, sizeof(topic_auto), "smarthome/auto");
+            rx_route = NULL;
+            mqtt_reasm_reset(&rx_reasm);
+            build_routes();
 
             // ✅ LUÔN subscribe topic auto mode
             esp_mqtt_client_subscribe(client, topic_auto, 1);
@@ -315,74 +549,28 @@ static void mqtt_event_handler(void *handler_args,
         case MQTT_EVENT_DISCONNECTED:
             ESP_LOGW(TAG, "❌ MQTT disconnected");
             is_connected = false;
+            mqtt_tls_on_disconnected();
+            mqtt_v5_on_disconnected();
+            rx_route = NULL;
+            mqtt_reasm_reset(&rx_reasm);  // Phần còn lại của bản tin dở sẽ không đến
+            break;
+
+        case MQTT_EVENT_BEFORE_CONNECT:
+            mqtt_tls_on_before_connect();
             break;
 
         case MQTT_EVENT_DATA:
-            ESP_LOGI(TAG, "📩 MQTT RX: %.*s → %.*s", 
-                     event->topic_len, event->topic,
-                     event->data_len, event->data);
-
-            // ✅ XỬ LÝ CHUYỂN ĐỔI AUTO/MANUAL
-            if (strstr(event->topic, "smarthome/auto") != NULL) {
-                cJSON *root = cJSON_Parse(event->data);
-                if (root) {
-                    cJSON *state = cJSON_GetObjectItem(root, "state");
-                    if (state && cJSON_IsString(state)) {
-                        bool new_mode = (strcmp(state->valuestring, "ON") == 0);
-                        
-                        // ✅ FIX VẤN ĐỀ 1: Đánh dấu đã initialized
-                        if (!auto_mode_initialized) {
-                            auto_mode_initialized = true;
-                            ESP_LOGI(TAG, "✅ Auto mode initialized from web");
-                        }
-                        
-                        // ✅ FIX VẤN ĐỀ 3: Subscribe/Unsubscribe theo mode
-                        if (new_mode != is_auto_mode) {
-                            is_auto_mode = new_mode;
-                            
-                            if (is_auto_mode) {
-                                ESP_LOGI(TAG, "🤖 Switched to AUTO mode");
-                                unsubscribe_actuator_topics();
-                                
-                                // ✅ Reset buzzer từ MANUAL mode (instant with Task Notification)
-                                buzzer_set_level(0);
-                                
-                                // ✅ TRIGGER ACTUATOR UPDATE NGAY LẬP TỨC
-                                // Để fan/LED/buzzer cập nhật theo sensor hiện tại
-                                trigger_actuator_update();
-                                ESP_LOGI(TAG, "🔄 Actuators will update to current sensor values");
-                            } else {
-                                ESP_LOGI(TAG, "👤 Switched to MANUAL mode");
-                                subscribe_actuator_topics();
-                            }
-                        }
-                    }
-                    cJSON_Delete(root);
-                }
-            }
-            // ✅ CHỈ XỬ LÝ LỆNH ĐIỀU KHIỂN KHI Ở MANUAL MODE
-            else if (!is_auto_mode && strstr(event->topic, "/actuators/") != NULL && 
-                     strstr(event->topic, "/reported") == NULL) {  // Không xử lý topic reported
-                
-                // Copy topic và data vì event->data không kết thúc bằng \0
-                char topic_str[256] = {0};
-                char data_str[512] = {0};
-                
-                int topic_len = (event->topic_len < 255) ? event->topic_len : 255;
-                int data_len = (event->data_len < 511) ? event->data_len : 511;
-                
-                strncpy(topic_str, event->topic, topic_len);
-                strncpy(data_str, event->data, data_len);
-                
-                handle_actuator_command(topic_str, data_str);
-            }
-            else if (is_auto_mode && strstr(event->topic, "/actuators/") != NULL) {
-                ESP_LOGW(TAG, "⚠️ Ignored actuator command (AUTO mode active)");
-            }
+            handle_data_event(event);
             break;
 
         case MQTT_EVENT_ERROR:
             ESP_LOGE(TAG, "❌ MQTT error");
+            // Broker chỉ hỗ trợ 3.1.1: lần reconnect sau dùng 3.1.1
+            if (mqtt_cfg.session.protocol_ver == MQTT_PROTOCOL_V_5 && mqtt_v5_is_protocol_refused(event)) {
+                ESP_LOGW(TAG, "⚠️ Broker refused MQTT 5, falling back to 3.1.1");
+                mqtt_cfg.session.protocol_ver = MQTT_PROTOCOL_V_3_1_1;
+                esp_mqtt_set_config(client, &mqtt_cfg);
+            }
             break;
 
         default:
@@ -400,17 +588,91 @@ void mqtt_send_data(const char* topic, float value)
         return;
     }
 
-    char payload[128];
-    snprintf(payload, sizeof(payload), "{\"value\":%.2f}", value);
+    if (!topic_policy_should_send(topic, value)) {
+        ESP_LOGD(TAG, "⏭️ Suppressed %s (within deadband)", topic);
+        return;
+    }
+
+    char payload[MQTT_PAYLOAD_MAX];
+    mqtt_payload_value(payload, sizeof(payload), value);
 
-    int msg_id = esp_mqtt_client_publish(client, topic, payload, 0, 1, 0);
-    if (msg_id >= 0) {
+    if (mqtt_outbox_publish(MQTT_STREAM_TELEMETRY, topic, payload, strlen(payload)) == ESP_OK) {
         ESP_LOGI(TAG, "📤 Published sensor: %s → %s", topic, payload);
     } else {
-        ESP_LOGE(TAG, "❌ Failed to publish to %s", topic);
+        ESP_LOGW(TAG, "⚠️ Publish queue full, dropped %s", topic);
     }
 }
 
+// ===============================================
+// HÀM PUBLISH TELEMETRY GỘP (1 BẢN TIN / CHU KỲ)
+// ===============================================
+void mqtt_send_telemetry(const mqtt_telemetry_t *telemetry)
+{
+    if (client == NULL || telemetry == NULL) {
+        ESP_LOGW(TAG, "MQTT not started, cannot send telemetry");
+        return;
+    }
+
+    // Actuator: OFF = 0, ON = level + 1, không có (MANUAL) = -1
+    const mqtt_telemetry_t *t = telemetry;
+    float values[TLM_CH_COUNT] = {
+        [TLM_CH_TEMP] = t->temperature,
+        [TLM_CH_HUMI] = t->humidity,
+        [TLM_CH_CO2] = t->ppm,
+        [TLM_CH_AQ] = (float)t->air_level,
+        [TLM_CH_VALID] = (float)t->valid,
+        [TLM_CH_MODE] = t->auto_mode ? 1.0f : 0.0f,
+        [TLM_CH_FAN] = !t->has_actuators ? -1.0f : (t->fan.on ? (float)(t->fan.level + 1) : 0.0f),
+        [TLM_CH_LED] = !t->has_actuators ? -1.0f : (t->led.on ? (float)(t->led.level + 1) : 0.0f),
+        [TLM_CH_BUZZER] = !t->has_actuators ? -1.0f : (t->buzzer.on ? (float)(t->buzzer.level + 1) : 0.0f),
+    };
+
+    taskENTER_CRITICAL(&policy_lock);
+    bool send = mqtt_policy_group_should_send(telemetry_streams, values, TLM_CH_COUNT,
+                                              esp_timer_get_time() / 1000, &telemetry_stats);
+    taskEXIT_CRITICAL(&policy_lock);
+    if (!send) {
+        ESP_LOGD(TAG, "⏭️ Telemetry suppressed (no change, heartbeat not due)");
+        return;
+    }
+
+    // Offline: lưu vào spool, replay theo thứ tự sau khi reconnect
+    if (!is_connected) {
+        if (mqtt_spool_push(telemetry) == ESP_OK) {
+            ESP_LOGI(TAG, "💾 Spooled telemetry seq=%lu (pending=%lu)",
+                     (unsigned long)telemetry->seq, (unsigned long)mqtt_spool_pending());
+        } else {
+            ESP_LOGW(TAG, "MQTT not connected, telemetry seq=%lu lost", (unsigned long)telemetry->seq);
+        }
+        return;
+    }
+
+    char payload[MQTT_TELEMETRY_MAX];
+    int len = telemetry_encode(payload, sizeof(payload), telemetry);
+    if (len < 0) {
+        ESP_LOGE(TAG, "❌ Telemetry payload too large");
+        return;
+    }
+
+    // QoS0, không chờ: ring đầy thì bỏ mẫu này và buộc gửi lại ở chu kỳ sau
+    const mqtt_outbox_meta_t meta = { .seq = telemetry->seq, .ts_ms = (uint32_t)telemetry->uptime_ms };
+    if (mqtt_outbox_publish_meta(MQTT_STREAM_TELEMETRY, topic_telemetry, payload, len, &meta) != ESP_OK) {
+        ESP_LOGW(TAG, "⚠️ Publish queue full, telemetry seq=%lu dropped", (unsigned long)telemetry->seq);
+        taskENTER_CRITICAL(&policy_lock);
+        for (int i = 0; i < TLM_CH_COUNT; i++) {
+            mqtt_policy_reset(&telemetry_streams[i]);
+        }
+        taskEXIT_CRITICAL(&policy_lock);
+        return;
+    }
+#if MQTT_TELEMETRY_BINARY
+    ESP_LOGI(TAG, "📤 Published telemetry: %s → seq=%lu (%d bytes)",
+             topic_telemetry, (unsigned long)telemetry->seq, len);
+#else
+    ESP_LOGI(TAG, "📤 Published telemetry: %s → %s", topic_telemetry, payload);
+#endif
+}
+
 // ===============================================
 // HÀM PUBLISH ACTUATOR STATUS (CHỈ TRONG AUTO MODE)
 // ===============================================
@@ -430,13 +692,66 @@ void mqtt_publish_actuator(const char *topic, const char *state, int level)
         return;
     }
 
-    char payload[128];
-    snprintf(payload, sizeof(payload), "{\"state\":\"%s\",\"level\":%d}", state, level);
+    // Mã hóa trạng thái thành một số: OFF = 0, ON = level + 1
+    bool on = (strcmp(state, "ON") == 0);
+    if (!topic_policy_should_send(topic, on ? (float)(level + 1) : 0.0f)) {
+        ESP_LOGD(TAG, "⏭️ Suppressed %s (unchanged)", topic);
+        return;
+    }
+
+    char payload[MQTT_PAYLOAD_MAX];
+    mqtt_payload_actuator(payload, sizeof(payload), state, level);
 
-    esp_mqtt_client_publish(client, topic, payload, 0, 1, 0);
+    // Gọi từ actuator_task: chỉ chép vào ring, không bao giờ chờ broker
+    if (mqtt_outbox_publish(MQTT_STREAM_REPORT, topic, payload, strlen(payload)) != ESP_OK) {
+        ESP_LOGW(TAG, "⚠️ Publish queue full, dropped %s", topic);
+        return;
+    }
     ESP_LOGI(TAG, "📤 Published actuator: %s → %s", topic, payload);
 }
 
+// ===============================================
+// REPORT KHI SHADOW ĐỔI TRẠNG THÁI (fan/LED/buzzer)
+// ===============================================
+// MANUAL: xác nhận lên actuators/{device}/reported. AUTO: trạng thái đã nằm
+// trong telemetry gộp, topic cũ chỉ khi MQTT_PER_TOPIC_COMPAT.
+static void on_actuator_changed(actuator_id_t id, actuator_state_t state, void *ctx)
+{
+    (void) ctx;
+    const char *state_str = state.on ? "ON" : "OFF";
+
+    if (!is_auto_mode) {
+        mqtt_report_actuator_state(actuator_shadow_name(id), state_str, state.level, true);
+        return;
+    }
+#if MQTT_PER_TOPIC_COMPAT
+    static char *const topics[ACTUATOR_COUNT] = { topic_fan, topic_led, topic_buzzer };
+    mqtt_publish_actuator(topics[id], state_str, state.level);
+#endif
+}
+
+// ===============================================
+// ĐĂNG KÝ TOPIC LỆNH MỚI (ví dụ smarthome/{room}/config/...)
+// ===============================================
+esp_err_t mqtt_register_command_handler(const char *topic, mqtt_route_handler_t handler, void *ctx)
+{
+    if (topic == NULL || handler == NULL || strlen(topic) >= MQTT_ROUTER_TOPIC_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (client != NULL) {
+        return ESP_ERR_INVALID_STATE;  // Bảng chỉ được dựng trong task sự kiện MQTT
+    }
+    if (extra_route_count >= MQTT_EXTRA_ROUTES_MAX) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    extra_route_t *route = &extra_routes[extra_route_count++];
+    strncpy(route->topic, topic, sizeof(route->topic) - 1);
+    route->handler = handler;
+    route->ctx = ctx;
+    return ESP_OK;
+}
+
 // ===============================================
 // KHỞI TẠO MQTT
 // ===============================================
@@ -445,20 +760,45 @@ void mqtt_app_start(const char *custom_room_id)
     if (custom_room_id != NULL) {
         strncpy(current_room_id, custom_room_id, sizeof(current_room_id) - 1);
     }
+    snprintf(topic_telemetry, sizeof(topic_telemetry), "smarthome/%s/telemetry" TELEMETRY_TOPIC_SUFFIX,
+             current_room_id);
+    snprintf(topic_replay, sizeof(topic_replay), "smarthome/%s/telemetry/replay" TELEMETRY_TOPIC_SUFFIX,
+             current_room_id);
+    snprintf(topic_fan, sizeof(topic_fan), "smarthome/%s/actuators/fan", current_room_id);
+    snprintf(topic_led, sizeof(topic_led), "smarthome/%s/actuators/led", current_room_id);
+    snprintf(topic_buzzer, sizeof(topic_buzzer), "smarthome/%s/actuators/buzzer", current_room_id);
+    actuator_shadow_set_report_cb(on_actuator_changed, NULL);
+    telemetry_policy_init();
+    mqtt_reasm_init(&rx_reasm, rx_buffer, sizeof(rx_buffer));
+
+    if (mqtt_spool_init() == ESP_OK && spool_task_handle == NULL) {
+        xTaskCreate(spool_replay_task, "spool_replay", 4096, NULL, 2, &spool_task_handle);
+    }
+
+    // CA dạng DER; transport riêng để giữ TLS session giữa các lần reconnect
+    size_t ca_len = 0;
+    const uint8_t *ca_der = mqtt_tls_ca_der(&ca_len);
 
-    esp_mqtt_client_config_t mqtt_cfg = {
-        .broker.address.uri = "mqtts://19059388a61f4c8286066fda62e74315.s1.eu.hivemq.cloud:8883",
-        .credentials.username = "trinity",
-        .credentials.authentication.password = "Hung123456789",
-        .broker.verification.certificate = hivemq_ca_cert,
+    mqtt_cfg = (esp_mqtt_client_config_t) {
+        .broker.address.uri = MQTT_BROKER_URI,
+        .credentials.username = MQTT_BROKER_USERNAME,
+        .credentials.authentication.password = MQTT_BROKER_PASSWORD,
+        .broker.verification.certificate = (const char *)ca_der,
+        .broker.verification.certificate_len = ca_len,
         .broker.verification.use_global_ca_store = false,
+        .network.transport = (strncmp(MQTT_BROKER_URI, "mqtts://", 8) == 0) ? mqtt_tls_transport_create() : NULL,
+        .outbox.limit = MQTT_OUTBOX_LIMIT,   // Broker treo: enqueue trả về -2 thay vì ăn hết heap
+        .session.protocol_ver = MQTT_USE_V5 ? MQTT_PROTOCOL_V_5 : MQTT_PROTOCOL_V_3_1_1,
     };
     
     client = esp_mqtt_client_init(&mqtt_cfg);
+    if (mqtt_outbox_init(client) != ESP_OK) {
+        ESP_LOGE(TAG, "❌ Failed to start publish queue");
+    }
     esp_mqtt_client_register_event(client, ESP_EVENT_ANY_ID, mqtt_event_handler, NULL);
     esp_mqtt_client_start(client);
     
-    ESP_LOGI(TAG, "🚀 MQTT started for room: %s", current_room_id);
+    ESP_LOGI(TAG, "🚀 MQTT started for room: %s (%s)", current_room_id, MQTT_BROKER_URI);
     ESP_LOGI(TAG, "⏳ Waiting for auto mode initialization from web...");
 }
 
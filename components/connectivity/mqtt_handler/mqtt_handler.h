@@ -3,12 +3,58 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "esp_err.h"
 #include "esp_event.h"
+#include "mqtt_payload.h"
+#include "mqtt_policy.h"
+#include "mqtt_spool.h"
+#include "mqtt_router.h"
+#include "mqtt_outbox.h"
 
 void mqtt_app_start(const char *custom_room_id);
+
+/**
+ * @brief Đăng ký handler cho một topic lệnh mới (so khớp chính xác, không wildcard)
+ *
+ * Bản tin đến được định tuyến qua bảng hash dựng lại ở mỗi MQTT_EVENT_CONNECTED
+ * (smarthome/auto, actuators/{fan,led,buzzer} và các topic đăng ký ở đây). Topic
+ * đăng ký được subscribe QoS1 sau mỗi lần kết nối. Handler chạy trong task MQTT.
+ * Phải gọi trước mqtt_app_start().
+ * @return ESP_ERR_INVALID_STATE nếu MQTT đã khởi động, ESP_ERR_NO_MEM nếu hết slot
+ */
+esp_err_t mqtt_register_command_handler(const char *topic, mqtt_route_handler_t handler, void *ctx);
+
+/*
+ * Mọi hàm publish bên dưới không chặn: bản tin được chép vào ring publish
+ * (mqtt_outbox.h) và task mqtt_pub chuyển sang esp-mqtt. Telemetry đi QoS0,
+ * report trạng thái actuator QoS1; ring/outbox đầy thì bỏ theo chính sách của
+ * stream và đếm trong mqtt_outbox_get_stats().
+ */
 void mqtt_send_data(const char* topic, float value);
 void mqtt_publish_actuator(const char *topic, const char *state, int level);
 
+/**
+ * @brief Publish telemetry gộp lên smarthome/{room}/telemetry[/bin] (QoS0)
+ *
+ * MQTT_TELEMETRY_BINARY = 1 (mặc định): frame nhị phân 23 byte trên .../telemetry/bin,
+ * 0: JSON trên .../telemetry.
+ * Một bản tin mỗi chu kỳ thay cho mqtt_send_data() x3 + mqtt_publish_actuator() x3.
+ * Khi mất kết nối, bản tin được lưu vào offline spool và replay (cũ -> mới) lên
+ * smarthome/{room}/telemetry/replay sau khi reconnect.
+ */
+void mqtt_send_telemetry(const mqtt_telemetry_t *telemetry);
+
+/*
+ * Report-by-exception: mqtt_send_telemetry(), mqtt_send_data() và
+ * mqtt_publish_actuator() chỉ publish khi giá trị vượt deadband của kênh
+ * hoặc đã im lặng quá MQTT_HEARTBEAT_MS. Reconnect buộc gửi lại tất cả.
+ */
+
+/**
+ * @brief Tổng số bản tin đã gửi / bị bỏ qua bởi publish policy
+ */
+void mqtt_get_publish_stats(mqtt_policy_stats_t *out);
+
 bool mqtt_is_auto_mode(void);
 bool mqtt_is_connected(void);
 bool mqtt_is_auto_mode_initialized(void);
@@ -0,0 +1,212 @@
+#include "mqtt_outbox.h"
+#include "mqtt_v5.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/ringbuf.h"
+#include <string.h>
+
+static const char *TAG = "MQTT_PUB";
+
+// Outbox esp-mqtt đầy (enqueue trả về -2): QoS1 thử lại tối đa
+// MQTT_PUB_RETRY_MAX lần, cách nhau MQTT_PUB_RETRY_MS, rồi mới bỏ
+#ifndef MQTT_PUB_RETRY_MAX
+#define MQTT_PUB_RETRY_MAX 20
+#endif
+#ifndef MQTT_PUB_RETRY_MS
+#define MQTT_PUB_RETRY_MS 100
+#endif
+#define MQTT_PUB_TOPIC_MAX 128    // Kể cả '\0'
+
+typedef struct {
+    int qos;
+    size_t reserve;               // Byte ring phải còn trống SAU khi ghi bản tin
+} stream_policy_t;
+
+static const stream_policy_t stream_policies[MQTT_STREAM_COUNT] = {
+    [MQTT_STREAM_TELEMETRY] = { .qos = 0, .reserve = MQTT_PUB_RING_SIZE / 4 },
+    [MQTT_STREAM_REPORT]    = { .qos = 1, .reserve = 0 },
+    [MQTT_STREAM_REPLAY]    = { .qos = 1, .reserve = MQTT_PUB_RING_SIZE / 2 },
+};
+
+// Header của một item trong ring, theo sau là topic (có '\0') và payload
+typedef struct {
+    uint8_t stream;
+    uint8_t topic_len;
+    uint16_t data_len;
+    uint8_t has_meta;
+    mqtt_outbox_meta_t meta;
+} pub_item_t;
+
+static uint8_t ring_storage[MQTT_PUB_RING_SIZE] __attribute__((aligned(4)));
+static StaticRingbuffer_t ring_struct;
+static RingbufHandle_t ring = NULL;
+static esp_mqtt_client_handle_t pub_client = NULL;
+
+static mqtt_outbox_stats_t stats;
+static volatile int outbox_bytes = 0;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+#define STAT_INC(stream, field) do {          \
+        taskENTER_CRITICAL(&stats_lock);        \
+        stats.streams[stream].field++;          \
+        taskEXIT_CRITICAL(&stats_lock);         \
+    } while (0)
+
+int mqtt_outbox_stream_qos(mqtt_stream_t stream)
+{
+    return (stream < MQTT_STREAM_COUNT) ? stream_policies[stream].qos : 1;
+}
+
+esp_err_t mqtt_outbox_publish(mqtt_stream_t stream, const char *topic, const void *data, size_t len)
+{
+    return mqtt_outbox_publish_meta(stream, topic, data, len, NULL);
+}
+
+esp_err_t mqtt_outbox_publish_meta(mqtt_stream_t stream, const char *topic, const void *data, size_t len,
+                                   const mqtt_outbox_meta_t *meta)
+{
+    if (stream >= MQTT_STREAM_COUNT || topic == NULL || (data == NULL && len > 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (ring == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    size_t topic_len = strlen(topic);
+    if (topic_len == 0 || topic_len >= MQTT_PUB_TOPIC_MAX || len > UINT16_MAX) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    size_t item_size = sizeof(pub_item_t) + topic_len + 1 + len;
+    if (xRingbufferGetCurFreeSize(ring) < item_size + stream_policies[stream].reserve) {
+        STAT_INC(stream, dropped_ring);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Timeout 0: producer khác vừa lấy mất chỗ -> bỏ, không chờ
+    void *slot = NULL;
+    if (xRingbufferSendAcquire(ring, &slot, item_size, 0) != pdTRUE || slot == NULL) {
+        STAT_INC(stream, dropped_ring);
+        return ESP_ERR_NO_MEM;
+    }
+
+    pub_item_t *item = slot;
+    item->stream = (uint8_t)stream;
+    item->topic_len = (uint8_t)topic_len;
+    item->data_len = (uint16_t)len;
+    item->has_meta = (meta != NULL);
+    if (meta != NULL) {
+        item->meta = *meta;
+    }
+    char *p = (char *)(item + 1);
+    memcpy(p, topic, topic_len + 1);
+    if (len > 0) {
+        memcpy(p + topic_len + 1, data, len);
+    }
+    xRingbufferSendComplete(ring, slot);
+
+    STAT_INC(stream, queued);
+    return ESP_OK;
+}
+
+// ===============================================
+// TASK mqtt_pub: ring -> outbox esp-mqtt
+// ===============================================
+static void publish_item(const pub_item_t *item)
+{
+    mqtt_stream_t stream = (mqtt_stream_t)item->stream;
+    int qos = stream_policies[stream].qos;
+    const char *topic = (const char *)(item + 1);
+    const char *data = topic + item->topic_len + 1;
+
+    const mqtt_outbox_meta_t *meta = item->has_meta ? &item->meta : NULL;
+
+    for (int attempt = 0; ; attempt++) {
+        int msg_id;
+        if (mqtt_v5_active()) {
+            msg_id = mqtt_v5_publish(pub_client, stream, topic, data, item->data_len, qos, meta);
+        } else {
+            // store = true: QoS0 cũng đi qua outbox, task esp-mqtt gửi đi
+            msg_id = esp_mqtt_client_enqueue(pub_client, topic, data, item->data_len, qos, 0, true);
+        }
+        outbox_bytes = esp_mqtt_client_get_outbox_size(pub_client);
+
+        if (msg_id >= 0) {
+            STAT_INC(stream, sent);
+            return;
+        }
+        if (msg_id == -2 && qos > 0 && attempt < MQTT_PUB_RETRY_MAX) {
+            vTaskDelay(pdMS_TO_TICKS(MQTT_PUB_RETRY_MS));  // Chờ broker ACK bớt
+            continue;
+        }
+
+        STAT_INC(stream, dropped_outbox);
+        ESP_LOGW(TAG, "⚠️ Dropped %s (%s, outbox %d bytes)", topic,
+                 msg_id == -2 ? "outbox full" : "enqueue failed", outbox_bytes);
+        return;
+    }
+}
+
+static void mqtt_pub_task(void *pvParameters)
+{
+    (void) pvParameters;
+
+    while (1) {
+        size_t size = 0;
+        pub_item_t *item = xRingbufferReceive(ring, &size, portMAX_DELAY);
+        if (item == NULL) {
+            continue;
+        }
+        if (size >= sizeof(pub_item_t) && item->stream < MQTT_STREAM_COUNT) {
+            publish_item(item);
+        }
+        vRingbufferReturnItem(ring, item);
+    }
+}
+
+esp_err_t mqtt_outbox_init(esp_mqtt_client_handle_t client)
+{
+    if (client == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (ring != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    pub_client = client;
+    ring = xRingbufferCreateStatic(sizeof(ring_storage), RINGBUF_TYPE_NOSPLIT, ring_storage, &ring_struct);
+    if (ring == NULL) {
+        return ESP_FAIL;
+    }
+    // Cùng mức ưu tiên với mqtt_task: thấp hơn sensor/actuator
+    if (xTaskCreate(mqtt_pub_task, "mqtt_pub", 3072, NULL, 4, NULL) != pdPASS) {
+        vRingbufferDelete(ring);
+        ring = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "✅ Publish ring %d bytes, esp-mqtt outbox limit %d bytes",
+             MQTT_PUB_RING_SIZE, MQTT_OUTBOX_LIMIT);
+    return ESP_OK;
+}
+
+size_t mqtt_outbox_backlog(void)
+{
+    if (ring == NULL) {
+        return 0;
+    }
+    size_t used = MQTT_PUB_RING_SIZE - xRingbufferGetCurFreeSize(ring);
+    return used + (size_t)(outbox_bytes > 0 ? outbox_bytes : 0);
+}
+
+void mqtt_outbox_get_stats(mqtt_outbox_stats_t *out)
+{
+    if (out == NULL) return;
+
+    taskENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    taskEXIT_CRITICAL(&stats_lock);
+    out->ring_free = (ring != NULL) ? (uint32_t)xRingbufferGetCurFreeSize(ring) : 0;
+    out->outbox_bytes = outbox_bytes;
+}
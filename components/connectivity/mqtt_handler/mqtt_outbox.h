@@ -0,0 +1,84 @@
+#ifndef MQTT_OUTBOX_H
+#define MQTT_OUTBOX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "mqtt_client.h"
+
+/*
+ * Đường publish không chặn: producer → ring buffer tĩnh → task mqtt_pub →
+ * esp_mqtt_client_enqueue() (MQTT v5: mqtt_v5_publish(), QoS0 gửi thẳng)
+ *
+ * esp_mqtt_client_publish()/enqueue() giữ khóa của client, vốn bị task
+ * esp-mqtt giữ suốt lúc ghi TLS. Producer (mqtt_task, actuator_task, event
+ * handler) chỉ chép bản tin vào ring (xRingbufferSendAcquire, timeout 0) nên
+ * không bao giờ chờ broker. Bộ nhớ cố định:
+ *   - ring MQTT_PUB_RING_SIZE byte (static, không malloc)
+ *   - outbox esp-mqtt giới hạn MQTT_OUTBOX_LIMIT byte (outbox.limit)
+ *
+ * Chính sách bỏ bản tin theo stream khi đầy:
+ *   TELEMETRY (QoS0)  - bỏ bản tin MỚI khi ring còn < 25% trống; mẫu sau thay thế
+ *   REPORT    (QoS1)  - được dùng toàn bộ ring; outbox đầy thì thử lại rồi mới bỏ
+ *   REPLAY    (QoS1)  - bỏ khi ring còn < 50% trống (spool giữ record, gửi lại sau)
+ */
+
+#ifndef MQTT_PUB_RING_SIZE
+#define MQTT_PUB_RING_SIZE 4096
+#endif
+#ifndef MQTT_OUTBOX_LIMIT
+#define MQTT_OUTBOX_LIMIT 8192     // byte, giới hạn heap cho outbox của esp-mqtt
+#endif
+
+typedef enum {
+    MQTT_STREAM_TELEMETRY = 0,
+    MQTT_STREAM_REPORT,
+    MQTT_STREAM_REPLAY,
+    MQTT_STREAM_COUNT
+} mqtt_stream_t;
+
+// Thông tin mẫu đi kèm bản tin (MQTT v5: user property "seq"/"ts", xem mqtt_v5.h)
+typedef struct {
+    uint32_t seq;
+    uint32_t ts_ms;
+} mqtt_outbox_meta_t;
+
+typedef struct {
+    uint32_t queued;           // Đã vào ring
+    uint32_t sent;             // Đã chuyển sang outbox esp-mqtt
+    uint32_t dropped_ring;     // Bỏ vì ring không đủ chỗ (theo reserve của stream)
+    uint32_t dropped_outbox;   // Bỏ vì outbox esp-mqtt đầy / lỗi
+} mqtt_outbox_stream_stats_t;
+
+typedef struct {
+    mqtt_outbox_stream_stats_t streams[MQTT_STREAM_COUNT];
+    uint32_t ring_free;        // Byte trống trong ring lúc lấy thống kê
+    int outbox_bytes;          // Byte đang nằm trong outbox esp-mqtt
+} mqtt_outbox_stats_t;
+
+/** @brief Tạo ring và task mqtt_pub cho client (gọi một lần sau esp_mqtt_client_init) */
+esp_err_t mqtt_outbox_init(esp_mqtt_client_handle_t client);
+
+/**
+ * @brief Xếp một bản tin để publish - không bao giờ chặn
+ * @return ESP_ERR_NO_MEM nếu bị bỏ theo chính sách của stream
+ */
+esp_err_t mqtt_outbox_publish(mqtt_stream_t stream, const char *topic, const void *data, size_t len);
+
+/** @brief Như mqtt_outbox_publish(), kèm seq/timestamp của mẫu (NULL = không có) */
+esp_err_t mqtt_outbox_publish_meta(mqtt_stream_t stream, const char *topic, const void *data, size_t len,
+                                   const mqtt_outbox_meta_t *meta);
+
+/** @brief QoS của stream (0 hoặc 1) */
+int mqtt_outbox_stream_qos(mqtt_stream_t stream);
+
+/**
+ * @brief Byte đang chờ gửi: phần đã dùng của ring + outbox esp-mqtt (lần đo gần nhất)
+ *
+ * Không gọi vào esp-mqtt nên không bao giờ chờ khóa client.
+ */
+size_t mqtt_outbox_backlog(void);
+
+void mqtt_outbox_get_stats(mqtt_outbox_stats_t *out);
+
+#endif // MQTT_OUTBOX_H
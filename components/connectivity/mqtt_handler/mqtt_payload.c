@@ -0,0 +1,142 @@
+#include "mqtt_payload.h"
+#include <stdio.h>
+#include <math.h>
+
+// ========== FORMAT ==========
+int mqtt_payload_value(char *buf, size_t size, float value)
+{
+    return snprintf(buf, size, "{\"value\":%.2f}", value);
+}
+
+int mqtt_payload_actuator(char *buf, size_t size, const char *state, int level)
+{
+    return snprintf(buf, size, "{\"state\":\"%s\",\"level\":%d}", state, level);
+}
+
+int mqtt_payload_reported(char *buf, size_t size, const char *state, int level, bool success)
+{
+    return snprintf(buf, size, "{\"state\":\"%s\",\"level\":%d,\"success\":%s}",
+                    state, level, success ? "true" : "false");
+}
+
+int mqtt_payload_telemetry(char *buf, size_t size, const mqtt_telemetry_t *t)
+{
+    int n = snprintf(buf, size,
+                     "{\"seq\":%lu,\"ts\":%lld,\"valid\":%u,"
+                     "\"temp\":%.2f,\"humi\":%.2f,\"co2\":%.2f,\"raw\":%u,\"aq\":%d,"
+                     "\"mode\":\"%s\"",
+                     (unsigned long)t->seq, (long long)t->uptime_ms, (unsigned)t->valid,
+                     t->temperature, t->humidity, t->ppm, (unsigned)t->mq_raw, t->air_level,
+                     t->auto_mode ? "AUTO" : "MANUAL");
+    if (n < 0 || (size_t)n >= size) {
+        return n;
+    }
+
+    if (t->has_actuators) {
+        int m = snprintf(buf + n, size - (size_t)n,
+                         ",\"fan\":{\"state\":\"%s\",\"level\":%d}"
+                         ",\"led\":{\"state\":\"%s\",\"level\":%d}"
+                         ",\"buzzer\":{\"state\":\"%s\",\"level\":%d}",
+                         t->fan.on ? "ON" : "OFF", t->fan.level,
+                         t->led.on ? "ON" : "OFF", t->led.level,
+                         t->buzzer.on ? "ON" : "OFF", t->buzzer.level);
+        if (m < 0) {
+            return m;
+        }
+        n += m;
+        if ((size_t)n >= size) {
+            return n;
+        }
+    }
+
+    if (t->replay) {
+        int m;
+        if (t->age_ms >= 0) {
+            m = snprintf(buf + n, size - (size_t)n, ",\"replay\":true,\"boot\":%u,\"age_ms\":%lld",
+                         (unsigned)t->boot, (long long)t->age_ms);
+        } else {
+            m = snprintf(buf + n, size - (size_t)n, ",\"replay\":true,\"boot\":%u,\"age_ms\":null",
+                         (unsigned)t->boot);
+        }
+        if (m < 0) {
+            return m;
+        }
+        n += m;
+        if ((size_t)n >= size) {
+            return n;
+        }
+    }
+
+    if ((size_t)n + 1 >= size) {
+        return n + 1;  // Không đủ chỗ cho '}'
+    }
+    buf[n++] = '}';
+    buf[n] = '\0';
+    return n;
+}
+
+// ========== BINARY TELEMETRY ==========
+static uint8_t *put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    return p + 2;
+}
+
+static uint8_t *put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+    return p + 4;
+}
+
+static int32_t scale_clamp(float v, float scale, int32_t lo, int32_t hi)
+{
+    if (isnan(v)) return 0;
+    float r = roundf(v * scale);
+    if (r < (float)lo) return lo;
+    if (r > (float)hi) return hi;
+    return (int32_t)r;
+}
+
+static uint8_t actuator_code(const mqtt_actuator_state_t *a)
+{
+    if (!a->on) return 0;
+    return (uint8_t)((a->level < 0) ? 1 : (a->level > 254) ? 255 : a->level + 1);
+}
+
+int mqtt_payload_telemetry_bin(uint8_t *buf, size_t size, const mqtt_telemetry_t *t)
+{
+    size_t need = t->replay ? MQTT_TELEMETRY_BIN_MAX : MQTT_TELEMETRY_BIN_SIZE;
+    if (size < need) {
+        return -1;
+    }
+
+    uint8_t flags = (t->auto_mode ? MQTT_TELEMETRY_BIN_AUTO : 0) |
+                    (t->has_actuators ? MQTT_TELEMETRY_BIN_ACTUATORS : 0) |
+                    (t->replay ? MQTT_TELEMETRY_BIN_REPLAY : 0);
+
+    uint8_t *p = buf;
+    *p++ = MQTT_TELEMETRY_BIN_VERSION;
+    *p++ = flags;
+    p = put_u32(p, t->seq);
+    p = put_u32(p, (uint32_t)t->uptime_ms);
+    *p++ = t->valid;
+    *p++ = (uint8_t)((t->air_level < 0) ? 0 : (t->air_level > 255) ? 255 : t->air_level);
+    p = put_u16(p, (uint16_t)(int16_t)scale_clamp(t->temperature, 100.0f, INT16_MIN, INT16_MAX));
+    p = put_u16(p, (uint16_t)scale_clamp(t->humidity, 100.0f, 0, UINT16_MAX));
+    p = put_u16(p, (uint16_t)scale_clamp(t->ppm, 1.0f, 0, UINT16_MAX));
+    p = put_u16(p, t->mq_raw);
+    *p++ = t->has_actuators ? actuator_code(&t->fan) : 0;
+    *p++ = t->has_actuators ? actuator_code(&t->led) : 0;
+    *p++ = t->has_actuators ? actuator_code(&t->buzzer) : 0;
+
+    if (t->replay) {
+        p = put_u16(p, t->boot);
+        p = put_u32(p, (t->age_ms < 0 || t->age_ms > (int64_t)UINT32_MAX - 1) ? UINT32_MAX
+                                                                               : (uint32_t)t->age_ms);
+    }
+    return (int)(p - buf);
+}
@@ -0,0 +1,125 @@
+#ifndef MQTT_PAYLOAD_H
+#define MQTT_PAYLOAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Định dạng / phân tích payload MQTT (không phụ thuộc esp-mqtt)
+ *
+ * Các hàm format trả về độ dài chuỗi như snprintf (>= size nghĩa là bị cắt).
+ */
+
+#define MQTT_PAYLOAD_MAX 128
+#define MQTT_TELEMETRY_MAX 384
+
+// Trạng thái một actuator trong telemetry
+typedef struct {
+    bool on;
+    int level;
+} mqtt_actuator_state_t;
+
+/**
+ * @brief Một bản tin telemetry gộp cho mỗi chu kỳ (smarthome/{room}/telemetry)
+ *
+ * Thay cho 3 publish sensor + 3 publish actuator riêng lẻ.
+ */
+typedef struct {
+    uint32_t seq;            // Số thứ tự frame cảm biến
+    int64_t uptime_ms;       // Thời điểm lấy mẫu (ms kể từ khi boot)
+    uint8_t valid;           // SENSOR_FRAME_*_VALID của frame
+    float temperature;       // °C
+    float humidity;          // %
+    float ppm;               // CO2 tương đương
+    uint16_t mq_raw;         // ADC raw MQ135
+    int air_level;           // 0-4
+    bool auto_mode;
+    bool has_actuators;      // false -> không có khóa fan/led/buzzer (MANUAL mode)
+    mqtt_actuator_state_t fan;
+    mqtt_actuator_state_t led;
+    mqtt_actuator_state_t buzzer;
+    bool replay;             // true -> lấy từ offline spool (smarthome/{room}/telemetry/replay)
+    uint16_t boot;           // Lần boot lúc lấy mẫu (chỉ khi replay)
+    int64_t age_ms;          // Tuổi bản tin lúc replay, -1 nếu thuộc lần boot trước
+} mqtt_telemetry_t;
+
+// ========== FORMAT ==========
+/** @brief Sensor: {"value":23.45} */
+int mqtt_payload_value(char *buf, size_t size, float value);
+
+/** @brief Actuator (AUTO): {"state":"ON","level":1} */
+int mqtt_payload_actuator(char *buf, size_t size, const char *state, int level);
+
+/** @brief Actuator reported: {"state":"ON","level":1,"success":true} */
+int mqtt_payload_reported(char *buf, size_t size, const char *state, int level, bool success);
+
+/**
+ * @brief Telemetry gộp:
+ * {"seq":1,"ts":5000,"valid":7,"temp":23.45,"humi":55.10,"co2":612.00,"raw":850,
+ *  "aq":1,"mode":"AUTO","fan":{"state":"ON","level":1},"led":{...},"buzzer":{...}}
+ * Bản tin replay thêm: "replay":true,"boot":3,"age_ms":125000 (null nếu khác boot)
+ */
+int mqtt_payload_telemetry(char *buf, size_t size, const mqtt_telemetry_t *t);
+
+// ========== BINARY TELEMETRY (topic .../bin) ==========
+// Byte đầu là version = content-type; decoder bỏ qua version không biết.
+// Little-endian, số nguyên đã scale (không printf, không float khi encode):
+//
+//  off size  field
+//   0   1    version (MQTT_TELEMETRY_BIN_VERSION)
+//   1   1    flags: bit0 AUTO, bit1 có actuator, bit2 replay
+//   2   4    seq (u32)
+//   6   4    ts, ms kể từ boot (u32)
+//  10   1    valid (SENSOR_FRAME_*_VALID)
+//  11   1    aq (0-4)
+//  12   2    temp, °C x 100 (i16)
+//  14   2    humi, % x 100 (u16)
+//  16   2    co2, ppm (u16)
+//  18   2    raw ADC (u16)
+//  20   3    fan, led, buzzer: OFF = 0, ON = level + 1 (chỉ có nghĩa khi bit1)
+//  --- chỉ khi bit2 (replay) ---
+//  23   2    boot (u16)
+//  25   4    age_ms (u32, 0xFFFFFFFF = thuộc lần boot trước)
+#define MQTT_TELEMETRY_BIN_VERSION   1
+#define MQTT_TELEMETRY_BIN_SIZE      23
+#define MQTT_TELEMETRY_BIN_MAX       29
+
+#define MQTT_TELEMETRY_BIN_AUTO      0x01
+#define MQTT_TELEMETRY_BIN_ACTUATORS 0x02
+#define MQTT_TELEMETRY_BIN_REPLAY    0x04
+
+/**
+ * @brief Telemetry nhị phân (~10x nhỏ hơn JSON)
+ * @return Số byte đã ghi, -1 nếu size < kích thước cần
+ */
+int mqtt_payload_telemetry_bin(uint8_t *buf, size_t size, const mqtt_telemetry_t *t);
+
+// ========== PARSE ==========
+/**
+ * @brief Lệnh từ web: {"state":"ON","level":1}
+ *
+ * Dùng cho cả smarthome/auto ({"state":"ON"}) và lệnh actuator.
+ */
+typedef struct {
+    bool has_state;
+    char state[16];   // Chuỗi state gốc (bị cắt nếu dài hơn)
+    bool has_level;
+    int level;
+} mqtt_command_t;
+
+/**
+ * @brief Phân tích payload JSON (không cần kết thúc bằng '\0')
+ *
+ * Tokenizer tại chỗ trên data/len: không malloc, không copy payload.
+ * @return false nếu JSON không hợp lệ
+ */
+bool mqtt_command_parse(const char *data, size_t len, mqtt_command_t *out);
+
+/** @brief state == "ON" */
+static inline bool mqtt_command_is_on(const mqtt_command_t *cmd)
+{
+    return cmd->has_state && cmd->state[0] == 'O' && cmd->state[1] == 'N' && cmd->state[2] == '\0';
+}
+
+#endif // MQTT_PAYLOAD_H
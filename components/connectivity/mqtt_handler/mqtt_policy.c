@@ -0,0 +1,88 @@
+#include "mqtt_policy.h"
+#include <math.h>
+#include <string.h>
+
+void mqtt_policy_init(mqtt_policy_stream_t *s, const mqtt_policy_cfg_t *cfg)
+{
+    memset(s, 0, sizeof(*s));
+    if (cfg) {
+        s->cfg = *cfg;
+    }
+}
+
+void mqtt_policy_reset(mqtt_policy_stream_t *s)
+{
+    s->has_last = false;
+}
+
+bool mqtt_policy_changed(const mqtt_policy_stream_t *s, float value)
+{
+    if (!s->has_last) {
+        return true;
+    }
+
+    // NaN = kênh không hợp lệ: chuyển hợp lệ <-> không hợp lệ luôn là thay đổi
+    bool value_nan = isnan(value);
+    bool last_nan = isnan(s->last);
+    if (value_nan || last_nan) {
+        return value_nan != last_nan;
+    }
+
+    float delta = fabsf(value - s->last);
+
+    // Không cấu hình deadband -> mọi thay đổi đều gửi (trạng thái rời rạc)
+    if (s->cfg.abs_deadband <= 0.0f && s->cfg.rel_deadband <= 0.0f) {
+        return delta > 0.0f;
+    }
+    if (s->cfg.abs_deadband > 0.0f && delta >= s->cfg.abs_deadband) {
+        return true;
+    }
+    if (s->cfg.rel_deadband > 0.0f && delta >= s->cfg.rel_deadband * fabsf(s->last)) {
+        return true;
+    }
+    return false;
+}
+
+bool mqtt_policy_heartbeat_due(const mqtt_policy_stream_t *s, int64_t now_ms)
+{
+    return s->cfg.heartbeat_ms > 0 && (now_ms - s->last_sent_ms) >= (int64_t)s->cfg.heartbeat_ms;
+}
+
+void mqtt_policy_commit(mqtt_policy_stream_t *s, float value, int64_t now_ms)
+{
+    s->last = value;
+    s->has_last = true;
+    s->last_sent_ms = now_ms;
+}
+
+bool mqtt_policy_should_send(mqtt_policy_stream_t *s, float value, int64_t now_ms)
+{
+    if (mqtt_policy_changed(s, value) || mqtt_policy_heartbeat_due(s, now_ms)) {
+        mqtt_policy_commit(s, value, now_ms);
+        s->stats.sent++;
+        return true;
+    }
+    s->stats.suppressed++;
+    return false;
+}
+
+bool mqtt_policy_group_should_send(mqtt_policy_stream_t *streams, const float *values, size_t n,
+                                   int64_t now_ms, mqtt_policy_stats_t *stats)
+{
+    bool send = false;
+    for (size_t i = 0; i < n && !send; i++) {
+        send = mqtt_policy_changed(&streams[i], values[i]) ||
+               mqtt_policy_heartbeat_due(&streams[i], now_ms);
+    }
+
+    if (!send) {
+        if (stats) stats->suppressed++;
+        return false;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        mqtt_policy_commit(&streams[i], values[i], now_ms);
+    }
+    if (stats) stats->sent++;
+    return true;
+}
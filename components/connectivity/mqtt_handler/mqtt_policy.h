@@ -0,0 +1,63 @@
+#ifndef MQTT_POLICY_H
+#define MQTT_POLICY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Report-by-exception: chỉ publish khi giá trị thay đổi đáng kể
+ * (deadband tuyệt đối / tương đối) hoặc khi đã im lặng quá heartbeat_ms.
+ *
+ * Không phụ thuộc ESP-IDF (đo được trong host_bench/).
+ */
+
+typedef struct {
+    float abs_deadband;      // Gửi khi |x - last| >= abs_deadband (0 = tắt)
+    float rel_deadband;      // Gửi khi |x - last| >= rel_deadband * |last| (0 = tắt)
+    uint32_t heartbeat_ms;   // Gửi bắt buộc sau khoảng im lặng này (0 = không heartbeat)
+} mqtt_policy_cfg_t;
+
+// Bộ đếm để đo lượng bản tin tiết kiệm được
+typedef struct {
+    uint32_t sent;
+    uint32_t suppressed;
+} mqtt_policy_stats_t;
+
+typedef struct {
+    mqtt_policy_cfg_t cfg;
+    bool has_last;           // false -> lần kiểm tra tiếp theo luôn gửi
+    float last;              // Giá trị đã gửi gần nhất
+    int64_t last_sent_ms;
+    mqtt_policy_stats_t stats;
+} mqtt_policy_stream_t;
+
+void mqtt_policy_init(mqtt_policy_stream_t *s, const mqtt_policy_cfg_t *cfg);
+
+/** @brief Buộc lần kiểm tra tiếp theo gửi (ví dụ sau khi reconnect) */
+void mqtt_policy_reset(mqtt_policy_stream_t *s);
+
+/** @brief Giá trị vượt deadband so với lần gửi trước, hoặc đổi giữa NaN và số (không đổi trạng thái) */
+bool mqtt_policy_changed(const mqtt_policy_stream_t *s, float value);
+
+/** @brief Heartbeat đã hết hạn (không đổi trạng thái) */
+bool mqtt_policy_heartbeat_due(const mqtt_policy_stream_t *s, int64_t now_ms);
+
+/** @brief Ghi nhận value là giá trị vừa gửi */
+void mqtt_policy_commit(mqtt_policy_stream_t *s, float value, int64_t now_ms);
+
+/**
+ * @brief Quyết định cho một stream: true -> gửi (đã commit), false -> bỏ qua (đã đếm)
+ */
+bool mqtt_policy_should_send(mqtt_policy_stream_t *s, float value, int64_t now_ms);
+
+/**
+ * @brief Quyết định cho một bản tin gồm nhiều kênh (telemetry gộp)
+ *
+ * Gửi nếu BẤT KỲ kênh nào vượt deadband hoặc hết heartbeat; khi gửi, mọi kênh
+ * được commit cùng lúc. Bộ đếm được cộng vào `stats` (mức bản tin).
+ */
+bool mqtt_policy_group_should_send(mqtt_policy_stream_t *streams, const float *values, size_t n,
+                                   int64_t now_ms, mqtt_policy_stats_t *stats);
+
+#endif // MQTT_POLICY_H
@@ -0,0 +1,83 @@
+#include "mqtt_reassembly.h"
+#include <string.h>
+
+void mqtt_reasm_init(mqtt_reasm_t *r, char *storage, size_t cap)
+{
+    memset(r, 0, sizeof(*r));
+    r->buf = storage;
+    r->cap = (storage != NULL) ? cap : 0;
+}
+
+void mqtt_reasm_reset(mqtt_reasm_t *r)
+{
+    if (r->active && !r->discarding) {
+        r->stats.dropped++;
+    }
+    r->active = false;
+    r->discarding = false;
+    r->total = 0;
+    r->received = 0;
+}
+
+static mqtt_reasm_result_t complete(mqtt_reasm_t *r, const char *payload, size_t len, bool fragmented,
+                                    const char **out, size_t *out_len)
+{
+    r->stats.messages++;
+    if (fragmented) r->stats.fragmented++;
+    if (len > r->stats.peak_len) r->stats.peak_len = (uint32_t)len;
+    *out = payload;
+    *out_len = len;
+    return MQTT_REASM_COMPLETE;
+}
+
+mqtt_reasm_result_t mqtt_reasm_feed(mqtt_reasm_t *r, const char *data, size_t data_len,
+                                    size_t offset, size_t total,
+                                    const char **out, size_t *out_len)
+{
+    *out = NULL;
+    *out_len = 0;
+
+    if (offset == 0) {
+        // Bản tin mới: bản tin trước chưa xong nghĩa là bị cắt ngang
+        mqtt_reasm_reset(r);
+
+        if (data_len >= total) {
+            return complete(r, data, data_len, false, out, out_len);  // Một fragment: không copy
+        }
+
+        r->active = true;
+        r->total = total;
+        r->received = data_len;
+        if (total > r->cap) {
+            r->discarding = true;
+            r->stats.dropped++;
+            return MQTT_REASM_OVERFLOW;
+        }
+        memcpy(r->buf, data, data_len);
+        return MQTT_REASM_PENDING;
+    }
+
+    // Fragment tiếp theo phải nối đúng vào cuối phần đã nhận
+    if (!r->active || offset != r->received || total != r->total ||
+        data_len > r->total - r->received) {
+        mqtt_reasm_reset(r);  // Đếm vào dropped nếu đang ghép dở
+        return MQTT_REASM_ERROR;
+    }
+
+    if (!r->discarding) {
+        memcpy(r->buf + r->received, data, data_len);
+    }
+    r->received += data_len;
+
+    if (r->received < r->total) {
+        return MQTT_REASM_PENDING;
+    }
+
+    bool discarded = r->discarding;
+    r->active = false;
+    r->discarding = false;
+    if (discarded) {
+        return MQTT_REASM_PENDING;  // Đã báo OVERFLOW ở fragment đầu
+    }
+    return complete(r, r->buf, r->total, true, out, out_len);
+}
@@ -0,0 +1,68 @@
+#ifndef MQTT_REASSEMBLY_H
+#define MQTT_REASSEMBLY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Ghép payload MQTT bị esp-mqtt chia thành nhiều MQTT_EVENT_DATA
+ *
+ * Payload lớn hơn buffer nhận của client đến thành nhiều event liên tiếp với
+ * current_data_offset / total_data_len; chỉ event đầu có topic. Mỗi fragment
+ * được chép nối tiếp vào buffer cố định do caller cấp (không malloc), kiểm tra
+ * offset liên tục và biên. Bản tin một fragment đi thẳng, không copy.
+ *
+ * Chủ ý KHÔNG parse từng fragment: handler chỉ được gọi khi đủ payload.
+ * - Bản tin lớn duy nhất là bảng luật (config/rules); bảng phải được kiểm tra
+ *   hết rồi mới thay cả bảng, nên kể cả parser incremental cũng phải giữ toàn
+ *   bộ kết quả đến fragment cuối.
+ * - Giới hạn MQTT_RX_REASSEMBLY_MAX (2 KB) nhỏ, buffer tĩnh dùng chung, memcpy
+ *   một fragment rẻ hơn nhiều so với giữ trạng thái parser cho từng handler.
+ * - Handler giữ API (data, len) đơn giản, dùng chung cho bản tin một fragment.
+ *
+ * Không phụ thuộc ESP-IDF (đo được trong host_bench/).
+ */
+
+typedef enum {
+    MQTT_REASM_COMPLETE = 0,   // *out / *out_len là payload đầy đủ
+    MQTT_REASM_PENDING,        // Chờ fragment tiếp theo (hoặc đang bỏ bản tin quá lớn)
+    MQTT_REASM_OVERFLOW,       // Fragment đầu của bản tin lớn hơn buffer: sẽ bị bỏ
+    MQTT_REASM_ERROR,          // Fragment không liên tục / sai độ dài: đã hủy bản tin
+} mqtt_reasm_result_t;
+
+typedef struct {
+    uint32_t messages;         // Bản tin hoàn chỉnh
+    uint32_t fragmented;       // Trong đó cần ghép từ nhiều fragment
+    uint32_t dropped;          // Quá lớn, lỗi thứ tự hoặc bị cắt ngang
+    uint32_t peak_len;         // Bản tin ghép lớn nhất (byte)
+} mqtt_reasm_stats_t;
+
+typedef struct {
+    char *buf;
+    size_t cap;
+    size_t total;              // total_data_len của bản tin đang ghép
+    size_t received;
+    bool active;
+    bool discarding;           // Bản tin quá lớn: nuốt các fragment còn lại
+    mqtt_reasm_stats_t stats;
+} mqtt_reasm_t;
+
+void mqtt_reasm_init(mqtt_reasm_t *r, char *storage, size_t cap);
+
+/** @brief Hủy bản tin đang ghép dở (ví dụ khi mất kết nối) */
+void mqtt_reasm_reset(mqtt_reasm_t *r);
+
+/**
+ * @brief Nạp một MQTT_EVENT_DATA
+ * @param offset current_data_offset (0 = fragment đầu / bản tin mới)
+ * @param total  total_data_len
+ * @param out    Trỏ tới payload đầy đủ khi trả về MQTT_REASM_COMPLETE
+ *               (data gốc nếu chỉ một fragment, ngược lại buffer ghép -
+ *               hợp lệ đến lần gọi feed/reset tiếp theo)
+ */
+mqtt_reasm_result_t mqtt_reasm_feed(mqtt_reasm_t *r, const char *data, size_t data_len,
+                                    size_t offset, size_t total,
+                                    const char **out, size_t *out_len);
+
+#endif // MQTT_REASSEMBLY_H
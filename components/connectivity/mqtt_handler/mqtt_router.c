@@ -0,0 +1,80 @@
+#include "mqtt_router.h"
+#include <string.h>
+
+// FNV-1a 32-bit
+static uint32_t topic_hash(const char *topic, size_t len)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)topic[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+void mqtt_router_init(mqtt_router_t *r)
+{
+    memset(r, 0, sizeof(*r));
+}
+
+// Slot chứa topic, hoặc slot trống đầu tiên trên đường dò
+static mqtt_route_t *probe(const mqtt_router_t *r, uint32_t hash, const char *topic, size_t len)
+{
+    uint32_t mask = MQTT_ROUTER_SLOTS - 1;
+    for (uint32_t i = 0; i < MQTT_ROUTER_SLOTS; i++) {
+        const mqtt_route_t *slot = &r->slots[(hash + i) & mask];
+        if (slot->topic_len == 0) {
+            return (mqtt_route_t *)slot;
+        }
+        if (slot->hash == hash && slot->topic_len == len && memcmp(slot->topic, topic, len) == 0) {
+            return (mqtt_route_t *)slot;
+        }
+    }
+    return NULL;  // Không xảy ra: add() luôn chừa ít nhất một slot trống
+}
+
+bool mqtt_router_add(mqtt_router_t *r, const char *topic, mqtt_route_handler_t handler, void *ctx)
+{
+    size_t len = (topic != NULL) ? strlen(topic) : 0;
+    if (len == 0 || len >= MQTT_ROUTER_TOPIC_MAX || handler == NULL) {
+        return false;
+    }
+
+    uint32_t hash = topic_hash(topic, len);
+    mqtt_route_t *slot = probe(r, hash, topic, len);
+    if (slot == NULL) {
+        return false;
+    }
+    if (slot->topic_len == 0) {
+        if (r->count + 1 >= MQTT_ROUTER_SLOTS) {
+            return false;
+        }
+        slot->hash = hash;
+        slot->topic_len = (uint16_t)len;
+        memcpy(slot->topic, topic, len + 1);
+        r->count++;
+    }
+    slot->handler = handler;
+    slot->ctx = ctx;
+    return true;
+}
+
+const mqtt_route_t *mqtt_router_find(const mqtt_router_t *r, const char *topic, size_t topic_len)
+{
+    if (topic == NULL || topic_len == 0 || topic_len >= MQTT_ROUTER_TOPIC_MAX) {
+        return NULL;
+    }
+    const mqtt_route_t *slot = probe(r, topic_hash(topic, topic_len), topic, topic_len);
+    return (slot != NULL && slot->topic_len != 0) ? slot : NULL;
+}
+
+bool mqtt_router_dispatch(const mqtt_router_t *r, const char *topic, size_t topic_len,
+                          const char *data, size_t data_len)
+{
+    const mqtt_route_t *route = mqtt_router_find(r, topic, topic_len);
+    if (route == NULL) {
+        return false;
+    }
+    route->handler(data, data_len, route->ctx);
+    return true;
+}
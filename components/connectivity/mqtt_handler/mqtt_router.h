@@ -0,0 +1,59 @@
+#ifndef MQTT_ROUTER_H
+#define MQTT_ROUTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Bảng định tuyến topic → handler cho bản tin MQTT đến
+ *
+ * So khớp CHÍNH XÁC cả topic (không wildcard, không strstr): hash FNV-1a trên
+ * (topic, topic_len) rồi dò tuyến tính trong bảng open addressing, xác nhận
+ * bằng memcmp. Chi phí O(độ dài topic), topic không cần kết thúc bằng '\0'.
+ *
+ * Không phụ thuộc ESP-IDF (đo được trong host_bench/). Không có khóa: dựng và
+ * dispatch trong cùng task (task sự kiện của esp-mqtt).
+ */
+
+#define MQTT_ROUTER_SLOTS      16     // Lũy thừa của 2, luôn > số route
+#define MQTT_ROUTER_TOPIC_MAX  96
+
+/**
+ * @brief Handler cho một topic
+ * @param data Payload (không kết thúc bằng '\0')
+ */
+typedef void (*mqtt_route_handler_t)(const char *data, size_t data_len, void *ctx);
+
+typedef struct {
+    uint32_t hash;
+    uint16_t topic_len;              // 0 = slot trống
+    char topic[MQTT_ROUTER_TOPIC_MAX];
+    mqtt_route_handler_t handler;
+    void *ctx;
+} mqtt_route_t;
+
+typedef struct {
+    mqtt_route_t slots[MQTT_ROUTER_SLOTS];
+    uint8_t count;
+} mqtt_router_t;
+
+void mqtt_router_init(mqtt_router_t *r);
+
+/**
+ * @brief Thêm route; topic đã có -> thay handler
+ * @return false nếu topic rỗng / quá dài hoặc bảng đã đầy (giữ >= 1 slot trống)
+ */
+bool mqtt_router_add(mqtt_router_t *r, const char *topic, mqtt_route_handler_t handler, void *ctx);
+
+/** @brief Tìm route cho topic, NULL nếu không có */
+const mqtt_route_t *mqtt_router_find(const mqtt_router_t *r, const char *topic, size_t topic_len);
+
+/**
+ * @brief Gọi handler của topic
+ * @return false nếu không có route
+ */
+bool mqtt_router_dispatch(const mqtt_router_t *r, const char *topic, size_t topic_len,
+                          const char *data, size_t data_len);
+
+#endif // MQTT_ROUTER_H
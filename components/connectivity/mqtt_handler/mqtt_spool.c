@@ -0,0 +1,441 @@
+#include "mqtt_spool.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "nvs_flash.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <string.h>
+#include <math.h>
+
+static const char *TAG = "SPOOL";
+
+#define NVS_NAMESPACE      "mqtt_spool"
+#define NVS_KEY_BOOT       "boot"
+
+#define SPOOL_SECTOR_SIZE  4096
+#define SPOOL_MAGIC        0xA5
+#define SPOOL_PENDING      0xFF    // Byte consumed sau khi erase
+#define SPOOL_CONSUMED     0x00    // Ghi đè 1 -> 0, không cần erase
+#define SPOOL_SCAN_CHUNK   16      // Record mỗi lần đọc khi quét lúc boot
+
+// ========== RECORD (32 byte) ==========
+// magic/consumed/crc nằm đầu record: đánh dấu đã replay chỉ cần ghi 1 byte,
+// CRC tính từ spool_seq đến hết record.
+typedef struct __attribute__((packed)) {
+    uint8_t magic;
+    uint8_t consumed;
+    uint16_t crc;
+    uint32_t spool_seq;      // Thứ tự ghi toàn cục (khôi phục head/tail khi boot)
+    uint32_t frame_seq;
+    uint32_t uptime_ms;
+    uint16_t boot;
+    int16_t temp_c100;       // °C x 100
+    uint16_t humi_c100;      // % x 100
+    uint16_t ppm;
+    uint16_t raw;
+    uint8_t air_level;
+    uint8_t valid;
+    uint8_t flags;           // SPOOL_FLAG_*
+    uint8_t fan;             // OFF = 0, ON = level + 1 (như publish policy)
+    uint8_t led;
+    uint8_t buzzer;
+} spool_record_t;
+
+_Static_assert(sizeof(spool_record_t) == 32, "spool record must stay 32 bytes");
+
+#define SPOOL_FLAG_AUTO      0x01
+#define SPOOL_FLAG_ACTUATORS 0x02
+#define SPOOL_CRC_OFFSET     4
+
+#define SLOTS_PER_SECTOR (SPOOL_SECTOR_SIZE / sizeof(spool_record_t))
+
+// ========== STATE ==========
+static SemaphoreHandle_t spool_mutex = NULL;
+static uint16_t boot_count = 0;
+static uint32_t next_seq = 0;
+
+static spool_record_t ram_ring[MQTT_SPOOL_RAM_RECORDS];
+static uint32_t ram_head = 0;      // Record cũ nhất
+static uint32_t ram_count = 0;
+
+static const esp_partition_t *part = NULL;
+static uint32_t flash_slots = 0;
+static uint32_t flash_head = 0;    // Slot ghi tiếp theo
+static uint32_t flash_tail = 0;    // Slot cũ nhất chưa replay
+static uint32_t flash_count = 0;   // Số slot trong [tail, head)
+
+static mqtt_spool_stats_t stats;
+
+// ========== ENCODE / DECODE ==========
+static uint16_t record_crc(const spool_record_t *rec)
+{
+    const uint8_t *p = (const uint8_t *)rec + SPOOL_CRC_OFFSET;
+    return esp_rom_crc16_le(0, p, sizeof(*rec) - SPOOL_CRC_OFFSET);
+}
+
+static bool record_valid(const spool_record_t *rec)
+{
+    return rec->magic == SPOOL_MAGIC && rec->crc == record_crc(rec);
+}
+
+static int32_t clamp_round(float v, int32_t lo, int32_t hi)
+{
+    if (isnan(v)) return 0;
+    float r = roundf(v);
+    if (r < (float)lo) return lo;
+    if (r > (float)hi) return hi;
+    return (int32_t)r;
+}
+
+static uint8_t encode_actuator(const mqtt_actuator_state_t *a)
+{
+    return a->on ? (uint8_t)clamp_round((float)(a->level + 1), 1, 255) : 0;
+}
+
+static void decode_actuator(uint8_t v, mqtt_actuator_state_t *a)
+{
+    a->on = (v != 0);
+    a->level = (v != 0) ? v - 1 : 0;
+}
+
+static void record_encode(const mqtt_telemetry_t *t, uint32_t seq, spool_record_t *rec)
+{
+    memset(rec, 0, sizeof(*rec));
+    rec->magic = SPOOL_MAGIC;
+    rec->consumed = SPOOL_PENDING;
+    rec->spool_seq = seq;
+    rec->frame_seq = t->seq;
+    rec->uptime_ms = (uint32_t)t->uptime_ms;
+    rec->boot = boot_count;
+    rec->temp_c100 = (int16_t)clamp_round(t->temperature * 100.0f, INT16_MIN, INT16_MAX);
+    rec->humi_c100 = (uint16_t)clamp_round(t->humidity * 100.0f, 0, UINT16_MAX);
+    rec->ppm = (uint16_t)clamp_round(t->ppm, 0, UINT16_MAX);
+    rec->raw = t->mq_raw;
+    rec->air_level = (uint8_t)clamp_round((float)t->air_level, 0, 255);
+    rec->valid = t->valid;
+    rec->flags = (t->auto_mode ? SPOOL_FLAG_AUTO : 0) | (t->has_actuators ? SPOOL_FLAG_ACTUATORS : 0);
+    rec->fan = encode_actuator(&t->fan);
+    rec->led = encode_actuator(&t->led);
+    rec->buzzer = encode_actuator(&t->buzzer);
+    rec->crc = record_crc(rec);
+}
+
+static void record_decode(const spool_record_t *rec, mqtt_telemetry_t *t)
+{
+    memset(t, 0, sizeof(*t));
+    t->seq = rec->frame_seq;
+    t->uptime_ms = rec->uptime_ms;
+    t->valid = rec->valid;
+    t->temperature = rec->temp_c100 / 100.0f;
+    t->humidity = rec->humi_c100 / 100.0f;
+    t->ppm = (float)rec->ppm;
+    t->mq_raw = rec->raw;
+    t->air_level = rec->air_level;
+    t->auto_mode = (rec->flags & SPOOL_FLAG_AUTO) != 0;
+    t->has_actuators = (rec->flags & SPOOL_FLAG_ACTUATORS) != 0;
+    decode_actuator(rec->fan, &t->fan);
+    decode_actuator(rec->led, &t->led);
+    decode_actuator(rec->buzzer, &t->buzzer);
+
+    t->replay = true;
+    t->boot = rec->boot;
+    if (rec->boot == boot_count) {
+        // uptime_ms 32-bit: phép trừ không dấu vẫn đúng khi tràn (~49 ngày)
+        uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+        t->age_ms = (int64_t)(uint32_t)(now_ms - rec->uptime_ms);
+    } else {
+        t->age_ms = -1;  // Lần boot trước: không có đồng hồ chung
+    }
+}
+
+// ========== FLASH RING ==========
+static uint32_t slot_sector(uint32_t slot)
+{
+    return slot / SLOTS_PER_SECTOR;
+}
+
+static esp_err_t flash_append(const spool_record_t *rec)
+{
+    if (flash_head % SLOTS_PER_SECTOR == 0) {
+        // Sắp xóa sector chứa tail -> bỏ các record cũ nhất trong sector đó
+        if (flash_count > 0 && slot_sector(flash_tail) == slot_sector(flash_head)) {
+            uint32_t lost = SLOTS_PER_SECTOR - (flash_tail % SLOTS_PER_SECTOR);
+            if (lost > flash_count) lost = flash_count;
+            flash_count -= lost;
+            stats.dropped += lost;
+            flash_tail = (flash_count > 0) ? (flash_tail + lost) % flash_slots : flash_head;
+            ESP_LOGW(TAG, "⚠️ Spool flash full, dropped %lu oldest records", (unsigned long)lost);
+        }
+        esp_err_t err = esp_partition_erase_range(part, (size_t)flash_head * sizeof(spool_record_t),
+                                                  SPOOL_SECTOR_SIZE);
+        if (err != ESP_OK) return err;
+    }
+
+    esp_err_t err = esp_partition_write(part, (size_t)flash_head * sizeof(spool_record_t),
+                                        rec, sizeof(*rec));
+    if (err != ESP_OK) return err;
+
+    flash_head = (flash_head + 1) % flash_slots;
+    flash_count++;
+    return ESP_OK;
+}
+
+// Bỏ qua record hỏng / đã replay ở tail; trả về record hợp lệ đầu tiên
+// ESP_ERR_NOT_FOUND: flash rỗng. Lỗi đọc: giữ nguyên tail, thử lại lần sau
+// (không nhảy sang RAM để không replay sai thứ tự)
+static esp_err_t flash_front(spool_record_t *rec)
+{
+    while (flash_count > 0) {
+        esp_err_t err = esp_partition_read(part, (size_t)flash_tail * sizeof(spool_record_t),
+                                           rec, sizeof(*rec));
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "❌ Spool flash read failed: %s", esp_err_to_name(err));
+            return err;
+        }
+        if (record_valid(rec) && rec->consumed == SPOOL_PENDING) {
+            return ESP_OK;
+        }
+        // Record đã replay nhưng tail chưa kịp tiến (mất điện giữa chừng) không tính là hỏng
+        if (rec->magic != SPOOL_MAGIC || rec->consumed == SPOOL_PENDING) {
+            stats.corrupt++;
+        }
+        flash_tail = (flash_tail + 1) % flash_slots;
+        flash_count--;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+// Record đã publish -> luôn tiến tail; đánh dấu lỗi chỉ làm record replay lại sau reboot
+static void flash_pop_front(void)
+{
+    static const uint8_t consumed = SPOOL_CONSUMED;
+    esp_err_t err = esp_partition_write(part, (size_t)flash_tail * sizeof(spool_record_t) + 1, &consumed, 1);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "⚠️ Spool mark consumed failed (slot %lu): %s, may replay again after reboot",
+                 (unsigned long)flash_tail, esp_err_to_name(err));
+    }
+    flash_tail = (flash_tail + 1) % flash_slots;
+    flash_count--;
+}
+
+// Khôi phục head/tail: head sau record có spool_seq lớn nhất, tail tại record
+// chưa replay có spool_seq nhỏ nhất
+static void flash_scan(void)
+{
+    spool_record_t chunk[SPOOL_SCAN_CHUNK];
+    bool any = false, any_pending = false;
+    uint32_t max_seq = 0, min_pending_seq = 0;
+    uint32_t max_slot = 0, min_pending_slot = 0;
+
+    for (uint32_t base = 0; base < flash_slots; base += SPOOL_SCAN_CHUNK) {
+        if (esp_partition_read(part, (size_t)base * sizeof(spool_record_t), chunk, sizeof(chunk)) != ESP_OK) {
+            continue;
+        }
+        for (uint32_t i = 0; i < SPOOL_SCAN_CHUNK; i++) {
+            const spool_record_t *rec = &chunk[i];
+            if (!record_valid(rec)) continue;
+
+            if (!any || rec->spool_seq > max_seq) {
+                max_seq = rec->spool_seq;
+                max_slot = base + i;
+                any = true;
+            }
+            if (rec->consumed == SPOOL_PENDING && (!any_pending || rec->spool_seq < min_pending_seq)) {
+                min_pending_seq = rec->spool_seq;
+                min_pending_slot = base + i;
+                any_pending = true;
+            }
+        }
+    }
+
+    flash_head = any ? (max_slot + 1) % flash_slots : 0;
+    next_seq = any ? max_seq + 1 : 0;
+    if (any_pending) {
+        flash_tail = min_pending_slot;
+        flash_count = (flash_head + flash_slots - flash_tail) % flash_slots;
+        if (flash_count == 0) flash_count = flash_slots;
+    } else {
+        flash_tail = flash_head;
+        flash_count = 0;
+    }
+}
+
+// ========== RAM RING ==========
+static void ram_drop_front(void)
+{
+    ram_head = (ram_head + 1) % MQTT_SPOOL_RAM_RECORDS;
+    ram_count--;
+}
+
+// Chuyển record đang kẹt trong RAM (flash từng ghi lỗi) xuống flash theo thứ tự.
+// Flash luôn cũ hơn RAM nên chỉ ghi thẳng xuống flash khi RAM đã rỗng.
+static esp_err_t ram_flush(void)
+{
+    uint32_t n = 0;
+    esp_err_t err = ESP_OK;
+    while (ram_count > 0) {
+        err = flash_append(&ram_ring[ram_head]);
+        if (err != ESP_OK) break;
+        ram_drop_front();
+        n++;
+    }
+    if (n > 0) {
+        ESP_LOGI(TAG, "💾 Flushed %lu RAM records to flash (flash pending=%lu)",
+                 (unsigned long)n, (unsigned long)flash_count);
+    }
+    return err;
+}
+
+static void ram_push(const spool_record_t *rec)
+{
+    if (ram_count == MQTT_SPOOL_RAM_RECORDS) {
+        // Không có flash (hoặc ghi lỗi): ghi đè record cũ nhất
+        ram_drop_front();
+        stats.dropped++;
+    }
+    ram_ring[(ram_head + ram_count) % MQTT_SPOOL_RAM_RECORDS] = *rec;
+    ram_count++;
+}
+
+// ========== PUBLIC API ==========
+esp_err_t mqtt_spool_init(void)
+{
+    if (spool_mutex != NULL) return ESP_OK;
+
+    spool_mutex = xSemaphoreCreateMutex();
+    if (spool_mutex == NULL) return ESP_ERR_NO_MEM;
+
+    // Đếm số lần boot để biết record nào có thể tính tuổi
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs) == ESP_OK) {
+        nvs_get_u16(nvs, NVS_KEY_BOOT, &boot_count);
+        boot_count++;
+        nvs_set_u16(nvs, NVS_KEY_BOOT, boot_count);
+        nvs_commit(nvs);
+        nvs_close(nvs);
+    }
+
+    part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, MQTT_SPOOL_PARTITION_SUBTYPE,
+                                    MQTT_SPOOL_PARTITION_LABEL);
+    if (part == NULL || part->size < 2 * SPOOL_SECTOR_SIZE) {
+        part = NULL;
+        ESP_LOGW(TAG, "⚠️ No '%s' partition, spooling to RAM only (%d records)",
+                 MQTT_SPOOL_PARTITION_LABEL, MQTT_SPOOL_RAM_RECORDS);
+        return ESP_OK;
+    }
+
+    flash_slots = (part->size / SPOOL_SECTOR_SIZE) * SLOTS_PER_SECTOR;
+    flash_scan();
+
+    ESP_LOGI(TAG, "✅ Spool ready: %lu slots, %lu pending from previous boot (boot #%u)",
+             (unsigned long)flash_slots, (unsigned long)flash_count, boot_count);
+    return ESP_OK;
+}
+
+esp_err_t mqtt_spool_push(const mqtt_telemetry_t *t)
+{
+    if (t == NULL) return ESP_ERR_INVALID_ARG;
+    if (spool_mutex == NULL) return ESP_ERR_INVALID_STATE;
+
+    spool_record_t rec;
+
+    xSemaphoreTake(spool_mutex, portMAX_DELAY);
+    record_encode(t, next_seq++, &rec);
+
+    // Ghi thẳng xuống flash: reboot / brownout giữa lúc offline không mất record nào
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    if (part != NULL) {
+        err = ram_flush();
+        if (err == ESP_OK) {
+            err = flash_append(&rec);
+        }
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "❌ Spool flash write failed: %s, keeping record in RAM", esp_err_to_name(err));
+        }
+    }
+    if (err != ESP_OK) {
+        ram_push(&rec);
+    }
+    stats.spooled++;
+    xSemaphoreGive(spool_mutex);
+
+    return ESP_OK;
+}
+
+esp_err_t mqtt_spool_peek(mqtt_telemetry_t *out, uint32_t *token)
+{
+    if (out == NULL || token == NULL) return ESP_ERR_INVALID_ARG;
+    if (spool_mutex == NULL) return ESP_ERR_INVALID_STATE;
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    spool_record_t rec;
+
+    xSemaphoreTake(spool_mutex, portMAX_DELAY);
+    if (part != NULL) {
+        ret = flash_front(&rec);
+    }
+    if (ret == ESP_ERR_NOT_FOUND && ram_count > 0) {
+        rec = ram_ring[ram_head];
+        ret = ESP_OK;
+    }
+    if (ret == ESP_OK) {
+        record_decode(&rec, out);
+        *token = rec.spool_seq;
+    }
+    xSemaphoreGive(spool_mutex);
+
+    return ret;
+}
+
+esp_err_t mqtt_spool_pop(uint32_t token)
+{
+    if (spool_mutex == NULL) return ESP_ERR_INVALID_STATE;
+
+    esp_err_t ret = ESP_ERR_INVALID_STATE;
+    spool_record_t rec;
+
+    xSemaphoreTake(spool_mutex, portMAX_DELAY);
+    esp_err_t front = (part != NULL) ? flash_front(&rec) : ESP_ERR_NOT_FOUND;
+    if (front == ESP_OK) {
+        if (rec.spool_seq == token) {
+            flash_pop_front();
+            ret = ESP_OK;
+        }
+    } else if (front == ESP_ERR_NOT_FOUND && ram_count > 0 && ram_ring[ram_head].spool_seq == token) {
+        ram_drop_front();
+        ret = ESP_OK;
+    }
+    if (ret == ESP_OK) {
+        stats.replayed++;
+    }
+    xSemaphoreGive(spool_mutex);
+
+    return ret;
+}
+
+uint32_t mqtt_spool_pending(void)
+{
+    if (spool_mutex == NULL) return 0;
+
+    xSemaphoreTake(spool_mutex, portMAX_DELAY);
+    uint32_t n = ram_count + flash_count;
+    xSemaphoreGive(spool_mutex);
+    return n;
+}
+
+void mqtt_spool_get_stats(mqtt_spool_stats_t *out)
+{
+    if (out == NULL) return;
+    if (spool_mutex == NULL) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+
+    xSemaphoreTake(spool_mutex, portMAX_DELAY);
+    *out = stats;
+    out->ram = ram_count;
+    out->flash = flash_count;
+    xSemaphoreGive(spool_mutex);
+}
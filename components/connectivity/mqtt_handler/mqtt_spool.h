@@ -0,0 +1,70 @@
+#ifndef MQTT_SPOOL_H
+#define MQTT_SPOOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "mqtt_payload.h"
+
+/*
+ * Offline spool cho telemetry (store-and-forward)
+ *
+ * Khi mất kết nối MQTT, mỗi bản tin telemetry được nén thành record 32 byte
+ * (có timestamp + CRC) và ghi ngay xuống partition "spool" (ring theo sector
+ * 4 KB trên flash) -> reboot / brownout giữa lúc offline không làm mất record.
+ * Ring RAM chỉ giữ record khi flash ghi lỗi (được chuyển xuống flash ở lần
+ * push kế tiếp) hoặc khi không có partition.
+ * Sau khi reconnect, mqtt_handler lấy ra theo thứ tự cũ -> mới (flash trước,
+ * RAM sau) và publish lên smarthome/{room}/telemetry/replay.
+ *
+ * Không tìm thấy partition -> chỉ dùng RAM, ghi đè record cũ nhất khi đầy.
+ * Flash đầy -> sector cũ nhất bị xóa (đếm vào dropped).
+ */
+
+#define MQTT_SPOOL_PARTITION_LABEL   "spool"
+#define MQTT_SPOOL_PARTITION_SUBTYPE 0x40    // Khớp partitions.csv
+
+#ifndef MQTT_SPOOL_RAM_RECORDS
+#define MQTT_SPOOL_RAM_RECORDS 32            // 1 KB RAM
+#endif
+
+typedef struct {
+    uint32_t ram;            // Record đang chờ trong RAM (flash lỗi / không có partition)
+    uint32_t flash;          // Record đang chờ trên flash
+    uint32_t spooled;        // Tổng số record đã nhận từ khi boot
+    uint32_t replayed;       // Tổng số record đã replay
+    uint32_t dropped;        // Bị ghi đè trước khi kịp replay
+    uint32_t corrupt;        // Record flash sai CRC bị bỏ qua
+} mqtt_spool_stats_t;
+
+/**
+ * @brief Mở partition spool, quét flash để khôi phục head/tail sau reboot
+ *
+ * Không có partition vẫn trả về ESP_OK (chế độ chỉ RAM).
+ */
+esp_err_t mqtt_spool_init(void);
+
+/** @brief Lưu một bản tin telemetry (gọi khi đang offline) */
+esp_err_t mqtt_spool_push(const mqtt_telemetry_t *t);
+
+/**
+ * @brief Đọc record cũ nhất mà không xóa
+ *
+ * out->replay = true, out->age_ms = tuổi bản tin (-1 nếu thuộc lần boot trước).
+ * @param token Truyền lại cho mqtt_spool_pop() sau khi publish thành công
+ * @return ESP_ERR_NOT_FOUND nếu spool rỗng, lỗi esp_partition_read nếu đọc flash lỗi
+ */
+esp_err_t mqtt_spool_peek(mqtt_telemetry_t *out, uint32_t *token);
+
+/**
+ * @brief Xóa record cũ nhất nếu nó vẫn là record đã peek
+ * @return ESP_ERR_INVALID_STATE nếu record đó đã bị ghi đè / bỏ qua
+ */
+esp_err_t mqtt_spool_pop(uint32_t token);
+
+/** @brief Số record đang chờ replay (RAM + flash) */
+uint32_t mqtt_spool_pending(void);
+
+void mqtt_spool_get_stats(mqtt_spool_stats_t *out);
+
+#endif // MQTT_SPOOL_H
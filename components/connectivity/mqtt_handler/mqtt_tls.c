@@ -0,0 +1,154 @@
+#include "mqtt_tls.h"
+#include "esp_transport_ssl.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "MQTT_TLS";
+
+// CA nhúng dạng DER (CMake: target_add_binary_data(... RENAME_TO mqtt_ca_der))
+extern const uint8_t mqtt_ca_der_start[] asm("_binary_mqtt_ca_der_start");
+extern const uint8_t mqtt_ca_der_end[] asm("_binary_mqtt_ca_der_end");
+
+// Chỉ dùng khi thử với broker nội bộ có chứng chỉ tự ký theo IP
+#ifndef MQTT_TLS_SKIP_CN_CHECK
+#define MQTT_TLS_SKIP_CN_CHECK 0
+#endif
+
+static esp_transport_handle_t transport = NULL;
+static bool session_saved = false;        // Có session để tái sử dụng ở lần kết nối sau
+static bool attempt_resumed = false;      // Lần thử hiện tại mang theo session
+static bool attempting = false;
+static bool heap_monitoring = false;
+static int64_t attempt_start_us = 0;
+static int64_t disconnected_us = 0;
+static size_t heap_free_before = 0;
+
+static mqtt_tls_stats_t stats;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+esp_transport_handle_t mqtt_tls_transport_create(void)
+{
+    if (transport != NULL) {
+        return transport;
+    }
+
+    transport = esp_transport_ssl_init();
+    if (transport == NULL) {
+        ESP_LOGE(TAG, "❌ esp_transport_ssl_init failed");
+        return NULL;
+    }
+    esp_transport_set_default_port(transport, 8883);
+    esp_transport_ssl_set_cert_data_der(transport, (const char *)mqtt_ca_der_start,
+                                        (int)(mqtt_ca_der_end - mqtt_ca_der_start));
+#if MQTT_TLS_SKIP_CN_CHECK
+    esp_transport_ssl_skip_common_name_check(transport);
+    ESP_LOGW(TAG, "⚠️ Server common name check disabled (test build)");
+#endif
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    esp_transport_ssl_session_ticket_operation(transport, ESP_TRANSPORT_SESSION_TICKET_INIT);
+#else
+    ESP_LOGW(TAG, "⚠️ CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS off: every reconnect is a full handshake");
+#endif
+
+    ESP_LOGI(TAG, "🔐 TLS transport ready (CA DER %d bytes)", (int)(mqtt_ca_der_end - mqtt_ca_der_start));
+    return transport;
+}
+
+const uint8_t *mqtt_tls_ca_der(size_t *len)
+{
+    if (len != NULL) {
+        *len = (size_t)(mqtt_ca_der_end - mqtt_ca_der_start);
+    }
+    return mqtt_ca_der_start;
+}
+
+static void heap_monitor_stop(void)
+{
+    if (heap_monitoring) {
+        heap_caps_monitor_local_minimum_free_size_stop();
+        heap_monitoring = false;
+    }
+}
+
+void mqtt_tls_on_before_connect(void)
+{
+    attempting = true;
+    attempt_resumed = session_saved;
+    attempt_start_us = esp_timer_get_time();
+
+    // Heap thấp nhất tính từ đây thay vì từ lúc boot
+    heap_monitor_stop();
+    heap_free_before = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+    heap_monitoring = (heap_caps_monitor_local_minimum_free_size_start() == ESP_OK);
+}
+
+void mqtt_tls_on_connected(void)
+{
+    int64_t now_us = esp_timer_get_time();
+    uint32_t connect_ms = attempting ? (uint32_t)((now_us - attempt_start_us) / 1000) : 0;
+    uint32_t outage_ms = (disconnected_us > 0) ? (uint32_t)((now_us - disconnected_us) / 1000) : 0;
+
+    size_t min_free = heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT);
+    uint32_t heap_peak = (heap_monitoring && heap_free_before > min_free) ? (uint32_t)(heap_free_before - min_free) : 0;
+    heap_monitor_stop();
+    attempting = false;
+
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    // Lưu session của kết nối này (ticket / session ID) và dùng cho lần kết nối sau
+    if (transport != NULL) {
+        esp_transport_ssl_session_ticket_operation(transport, ESP_TRANSPORT_SESSION_TICKET_SAVE);
+        esp_transport_ssl_session_ticket_operation(transport, ESP_TRANSPORT_SESSION_TICKET_USE);
+        session_saved = true;
+    }
+#endif
+
+    taskENTER_CRITICAL(&stats_lock);
+    stats.connects++;
+    stats.last_connect_ms = connect_ms;
+    stats.last_outage_ms = outage_ms;
+    if (attempt_resumed) {
+        stats.resumed++;
+        stats.last_resumed_ms = connect_ms;
+    } else {
+        stats.last_full_ms = connect_ms;
+    }
+    if (heap_peak > stats.heap_peak) {
+        stats.heap_peak = heap_peak;
+    }
+    if (stats.heap_min_free == 0 || min_free < stats.heap_min_free) {
+        stats.heap_min_free = (uint32_t)min_free;
+    }
+    taskEXIT_CRITICAL(&stats_lock);
+
+    ESP_LOGI(TAG, "🔐 Connected in %lu ms (%s handshake), offline %lu ms, heap peak %lu B, min free %lu B",
+             (unsigned long)connect_ms, attempt_resumed ? "saved session" : "full",
+             (unsigned long)outage_ms, (unsigned long)heap_peak, (unsigned long)min_free);
+}
+
+void mqtt_tls_on_disconnected(void)
+{
+    if (attempting) {
+        // Kết nối thất bại. Session đã lưu vẫn giữ: broker không nhận ticket/ID
+        // cũ thì mbedTLS tự chuyển sang handshake đầy đủ
+        attempting = false;
+        heap_monitor_stop();
+        taskENTER_CRITICAL(&stats_lock);
+        stats.failed++;
+        taskEXIT_CRITICAL(&stats_lock);
+        return;
+    }
+    disconnected_us = esp_timer_get_time();  // Lần thử thất bại sau đó không ghi đè
+}
+
+void mqtt_tls_get_stats(mqtt_tls_stats_t *out)
+{
+    if (out == NULL) return;
+
+    taskENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    taskEXIT_CRITICAL(&stats_lock);
+}
@@ -0,0 +1,52 @@
+#ifndef MQTT_TLS_H
+#define MQTT_TLS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_transport.h"
+
+/*
+ * Transport TLS cho MQTT: CA dạng DER + tái sử dụng TLS session
+ *
+ * - CA (mặc định certs/isrg_root_x1.der, ISRG Root X1 của HiveMQ Cloud) được
+ *   nhúng dạng DER qua CMake -> không parse PEM/base64 mỗi lần handshake
+ * - Sau mỗi lần kết nối, session (ticket hoặc session ID) được lưu lại và
+ *   dùng cho lần kết nối sau: reconnect sau mất Wi-Fi chỉ cần handshake rút
+ *   gọn, không xác minh lại chuỗi chứng chỉ (cần CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS)
+ * - Đo thời gian BEFORE_CONNECT -> CONNECTED và heap thấp nhất trong lúc kết nối
+ */
+
+typedef struct {
+    uint32_t connects;            // Số lần CONNECTED
+    uint32_t resumed;             // Trong đó mang theo session đã lưu
+    uint32_t failed;              // Lần thử kết nối không thành công
+    uint32_t last_connect_ms;     // BEFORE_CONNECT -> CONNECTED (TLS + MQTT CONNECT)
+    uint32_t last_full_ms;        // Lần gần nhất phải handshake đầy đủ
+    uint32_t last_resumed_ms;     // Lần gần nhất có session đã lưu
+    uint32_t last_outage_ms;      // DISCONNECTED -> CONNECTED
+    uint32_t heap_peak;           // Heap dùng nhiều nhất trong một lần kết nối (byte)
+    uint32_t heap_min_free;       // Heap trống thấp nhất khi đang kết nối (byte)
+} mqtt_tls_stats_t;
+
+/**
+ * @brief Tạo transport SSL đã nạp CA DER, truyền vào esp_mqtt_client_config_t.network.transport
+ * @return NULL nếu không tạo được (khi đó dùng transport mặc định của esp-mqtt)
+ */
+esp_transport_handle_t mqtt_tls_transport_create(void);
+
+/** @brief CA DER đã nhúng (cho esp_mqtt_client_config_t.broker.verification) */
+const uint8_t *mqtt_tls_ca_der(size_t *len);
+
+/** @brief Gọi từ MQTT_EVENT_BEFORE_CONNECT: bắt đầu đo thời gian / heap */
+void mqtt_tls_on_before_connect(void);
+
+/** @brief Gọi từ MQTT_EVENT_CONNECTED: lưu session cho lần sau, log độ trễ */
+void mqtt_tls_on_connected(void);
+
+/** @brief Gọi từ MQTT_EVENT_DISCONNECTED (cả khi lần thử kết nối thất bại) */
+void mqtt_tls_on_disconnected(void);
+
+void mqtt_tls_get_stats(mqtt_tls_stats_t *out);
+
+#endif // MQTT_TLS_H
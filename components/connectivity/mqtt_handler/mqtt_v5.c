@@ -0,0 +1,200 @@
+#include "mqtt_v5.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdio.h>
+#include <string.h>
+
+#if MQTT_USE_V5
+#include "mqtt5_client.h"
+
+static const char *TAG = "MQTT5";
+
+#define MQTT_V5_ALIAS_TOPIC_MAX 128
+
+// Alias cố định theo thứ tự dùng lần đầu (slot i <-> alias i + 1). Chỉ task
+// mqtt_pub đọc/ghi bảng; CONNECTED / DISCONNECTED chỉ tăng conn_gen (trong
+// task MQTT, dưới client lock của esp-mqtt).
+typedef struct {
+    char topic[MQTT_V5_ALIAS_TOPIC_MAX];
+    uint32_t sent_gen;            // Kết nối đã nhận topic + alias này
+} alias_slot_t;
+
+static alias_slot_t aliases[MQTT_V5_TOPIC_ALIAS_MAX];
+static int alias_count = 0;
+static uint32_t alias_disabled_gen = 0;
+
+static volatile uint32_t conn_gen = 0;
+static volatile bool v5_connected = false;
+
+static mqtt_v5_stats_t stats;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void mqtt_v5_on_connected(esp_mqtt_protocol_ver_t protocol_ver)
+{
+    conn_gen++;
+    v5_connected = (protocol_ver == MQTT_PROTOCOL_V_5);
+    ESP_LOGI(TAG, "🔗 Protocol %s", v5_connected ? "MQTT 5 (topic alias, user properties)" : "MQTT 3.1.1");
+}
+
+void mqtt_v5_on_disconnected(void)
+{
+    conn_gen++;  // Alias đã đăng ký thuộc kết nối vừa mất
+}
+
+bool mqtt_v5_active(void)
+{
+    return v5_connected;
+}
+
+static int alias_lookup(const char *topic)
+{
+    for (int i = 0; i < alias_count; i++) {
+        if (strcmp(aliases[i].topic, topic) == 0) {
+            return i;
+        }
+    }
+    if (alias_count >= MQTT_V5_TOPIC_ALIAS_MAX || strlen(topic) >= MQTT_V5_ALIAS_TOPIC_MAX) {
+        return -1;  // Hết alias: topic này luôn gửi đầy đủ
+    }
+    strcpy(aliases[alias_count].topic, topic);
+    aliases[alias_count].sent_gen = 0;
+    return alias_count++;
+}
+
+int mqtt_v5_publish(esp_mqtt_client_handle_t client, mqtt_stream_t stream, const char *topic,
+                    const char *data, int len, int qos, const mqtt_outbox_meta_t *meta)
+{
+    esp_mqtt5_publish_property_config_t prop = { 0 };
+
+    if (stream == MQTT_STREAM_TELEMETRY) {
+        prop.message_expiry_interval = MQTT_V5_TELEMETRY_EXPIRY_S;
+    }
+
+    char seq_str[12];
+    char ts_str[12];
+    if (meta != NULL) {
+        snprintf(seq_str, sizeof(seq_str), "%lu", (unsigned long)meta->seq);
+        snprintf(ts_str, sizeof(ts_str), "%lu", (unsigned long)meta->ts_ms);
+        esp_mqtt5_user_property_item_t items[] = {
+            { .key = "seq", .value = seq_str },
+            { .key = "ts", .value = ts_str },
+        };
+        esp_mqtt5_client_set_user_property(&prop.user_property, items, 2);
+    }
+
+    // Topic alias chỉ cho QoS0: bản tin không lưu outbox nên không bị gửi lại
+    // trên kết nối khác, nơi broker chưa biết alias
+    int slot = -1;
+    if (qos == 0 && alias_disabled_gen != conn_gen) {
+        slot = alias_lookup(topic);
+        if (slot >= 0) {
+            prop.topic_alias = (uint16_t)(slot + 1);
+        }
+    }
+
+    // Property chỉ áp dụng cho lần publish kế tiếp; mqtt_pub là task duy nhất publish.
+    // esp-mqtt chỉ từ chối alias ở đây (lớn hơn Topic Alias Maximum trong CONNACK)
+    esp_err_t err = esp_mqtt5_client_set_publish_property(client, &prop);
+    if (err != ESP_OK && prop.topic_alias != 0) {
+        alias_disabled_gen = conn_gen;
+        prop.topic_alias = 0;
+        slot = -1;
+        taskENTER_CRITICAL(&stats_lock);
+        stats.alias_rejected++;
+        taskEXIT_CRITICAL(&stats_lock);
+        ESP_LOGW(TAG, "⚠️ Topic alias rejected, sending full topics on this connection");
+        err = esp_mqtt5_client_set_publish_property(client, &prop);
+    }
+
+    int msg_id = -1;
+    if (err == ESP_OK) {
+        // Đọc generation SAU khi set_publish_property đã lấy client lock: reconnect
+        // xong trước đó thì CONNECTED đã tăng conn_gen -> gửi lại topic + alias.
+        // Reconnect chen vào giữa hai lời gọi phải qua DISCONNECTED + chờ reconnect
+        // (lock được nhả), khi đó publish QoS0 trả -1 vì chưa kết nối.
+        uint32_t gen = conn_gen;
+        const char *wire_topic = (slot >= 0 && aliases[slot].sent_gen == gen) ? "" : topic;
+
+        if (qos == 0) {
+            msg_id = esp_mqtt_client_publish(client, wire_topic, data, len, 0, 0);
+        } else {
+            msg_id = esp_mqtt_client_enqueue(client, wire_topic, data, len, qos, 0, true);
+        }
+
+        if (msg_id >= 0 && slot >= 0) {
+            if (wire_topic != topic) {
+                taskENTER_CRITICAL(&stats_lock);
+                stats.aliased++;
+                stats.alias_bytes_saved += (uint32_t)strlen(topic);
+                taskEXIT_CRITICAL(&stats_lock);
+            } else if (conn_gen == gen) {
+                aliases[slot].sent_gen = gen;  // Chỉ ghi nhận khi chắc chắn cùng kết nối
+            }
+        }
+    }
+
+    if (prop.user_property != NULL) {
+        esp_mqtt5_client_delete_user_property(prop.user_property);
+    }
+    return msg_id;
+}
+
+bool mqtt_v5_is_protocol_refused(const esp_mqtt_event_t *event)
+{
+    if (event == NULL || event->error_handle == NULL ||
+        event->error_handle->error_type != MQTT_ERROR_TYPE_CONNECTION_REFUSED) {
+        return false;
+    }
+    // Broker 3.1.1 trả CONNACK mã 0x01, broker v5 không nhận phiên bản trả 0x84
+    int code = (int)event->error_handle->connect_return_code;
+    return code == MQTT_CONNECTION_REFUSE_PROTOCOL || code == MQTT5_UNSUPPORTED_PROTOCOL_VER;
+}
+
+void mqtt_v5_get_stats(mqtt_v5_stats_t *out)
+{
+    if (out == NULL) return;
+
+    taskENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    taskEXIT_CRITICAL(&stats_lock);
+}
+
+#else // !MQTT_USE_V5
+
+void mqtt_v5_on_connected(esp_mqtt_protocol_ver_t protocol_ver)
+{
+    (void) protocol_ver;
+}
+
+void mqtt_v5_on_disconnected(void)
+{
+}
+
+bool mqtt_v5_active(void)
+{
+    return false;
+}
+
+int mqtt_v5_publish(esp_mqtt_client_handle_t client, mqtt_stream_t stream, const char *topic,
+                    const char *data, int len, int qos, const mqtt_outbox_meta_t *meta)
+{
+    (void) stream;
+    (void) meta;
+    return esp_mqtt_client_enqueue(client, topic, data, len, qos, 0, true);
+}
+
+bool mqtt_v5_is_protocol_refused(const esp_mqtt_event_t *event)
+{
+    (void) event;
+    return false;
+}
+
+void mqtt_v5_get_stats(mqtt_v5_stats_t *out)
+{
+    if (out != NULL) {
+        memset(out, 0, sizeof(*out));
+    }
+}
+
+#endif // MQTT_USE_V5
@@ -0,0 +1,70 @@
+#ifndef MQTT_V5_H
+#define MQTT_V5_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "mqtt_client.h"
+#include "mqtt_outbox.h"
+
+/*
+ * Chế độ MQTT v5 cho đường publish (task mqtt_pub)
+ *
+ * - Topic alias: topic QoS0 lặp lại (telemetry, sensors/{temp,humi,co2}) được gán alias cố
+ *   định; lần publish đầu của mỗi kết nối gửi topic + alias, các lần sau chỉ
+ *   gửi alias (2 byte thay cho ~30 byte topic). Bản tin QoS1 luôn mang topic
+ *   đầy đủ: esp-mqtt có thể gửi lại chúng từ outbox sau reconnect, khi broker
+ *   chưa biết alias.
+ * - User property "seq" / "ts" (ms từ lúc boot) trên telemetry
+ * - Message expiry MQTT_V5_TELEMETRY_EXPIRY_S trên telemetry live
+ *
+ * Cần CONFIG_MQTT_PROTOCOL_5. Broker từ chối v5 (CONNACK "unsupported
+ * protocol version") -> mqtt_handler chuyển client về 3.1.1, các hàm ở đây
+ * trở về publish thường.
+ */
+
+#if defined(CONFIG_MQTT_PROTOCOL_5) && !defined(MQTT_USE_V5)
+#define MQTT_USE_V5 1
+#endif
+#ifndef MQTT_USE_V5
+#define MQTT_USE_V5 0
+#endif
+
+#ifndef MQTT_V5_TOPIC_ALIAS_MAX
+#define MQTT_V5_TOPIC_ALIAS_MAX 8          // Số topic được gán alias (1..N)
+#endif
+#ifndef MQTT_V5_TELEMETRY_EXPIRY_S
+#define MQTT_V5_TELEMETRY_EXPIRY_S 60      // Telemetry cũ hơn 1 phút không còn ý nghĩa
+#endif
+
+typedef struct {
+    uint32_t aliased;          // Publish chỉ mang alias (không có topic)
+    uint32_t alias_bytes_saved;
+    uint32_t alias_rejected;   // Alias vượt Topic Alias Maximum của broker: tắt alias cho kết nối này
+} mqtt_v5_stats_t;
+
+/** @brief Gọi ở MQTT_EVENT_CONNECTED với protocol đã thương lượng */
+void mqtt_v5_on_connected(esp_mqtt_protocol_ver_t protocol_ver);
+
+/** @brief Gọi ở MQTT_EVENT_DISCONNECTED: alias của kết nối cũ hết hiệu lực */
+void mqtt_v5_on_disconnected(void);
+
+/** @brief Kết nối hiện tại có dùng MQTT v5 không */
+bool mqtt_v5_active(void);
+
+/**
+ * @brief Publish một bản tin từ task mqtt_pub với property v5
+ *
+ * QoS0 đi thẳng esp_mqtt_client_publish() (không lưu outbox, để bản tin chỉ
+ * mang alias không bao giờ bị gửi lại trên kết nối khác), QoS1 qua
+ * esp_mqtt_client_enqueue(). Trả về như esp-mqtt: msg_id >= 0, -1 lỗi, -2 outbox đầy.
+ */
+int mqtt_v5_publish(esp_mqtt_client_handle_t client, mqtt_stream_t stream, const char *topic,
+                    const char *data, int len, int qos, const mqtt_outbox_meta_t *meta);
+
+/** @brief Xác định CONNACK có phải broker không hỗ trợ v5 */
+bool mqtt_v5_is_protocol_refused(const esp_mqtt_event_t *event);
+
+void mqtt_v5_get_stats(mqtt_v5_stats_t *out);
+
+#endif // MQTT_V5_H
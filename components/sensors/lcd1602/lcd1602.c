@@ -7,12 +7,13 @@
  */
 
 #include "lcd1602.h"
-#include "driver/i2c.h"
+#include "i2c_bus.h"
 #include "app_config.h"
 #include "esp_log.h"
 #include "esp_rom_sys.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
 #include <stdio.h>
 #include <string.h>
 
@@ -22,48 +23,56 @@ static const char *TAG = "LCD";
 #define En 0x04
 #define Rs 0x01
 
-// I2C configuration for LCD (shares I2C bus with SHT31)
-#define I2C_MASTER_NUM     I2C_NUM_0
-#define I2C_MASTER_SDA_IO  PIN_SHT31_SDA
-#define I2C_MASTER_SCL_IO  PIN_SHT31_SCL
+// LCD shares the I2C bus (component i2c_bus) with SHT31 (0x44) and uses PCF8574 (0x27).
+// PCF8574 chỉ hỗ trợ Standard-mode -> thiết bị LCD chạy 100kHz,
+// SHT31 chạy 400kHz trên cùng bus (tốc độ SCL được set theo từng thiết bị)
+#define LCD_I2C_FREQ_HZ     100000
+#define LCD_I2C_TIMEOUT_MS  50
 
-// Note: I2C bus initialized by sht31_init() at 100kHz
-// LCD shares the same I2C bus with SHT31 (0x44) and uses PCF8574 (0x27)
+#define LCD_ROWS 2
+#define LCD_COLS 16
+
+// Mỗi byte LCD = 2 nibble x 3 byte PCF8574 (EN low/high/low)
+#define LCD_I2C_BYTES_PER_LCD_BYTE 6
+// Tệ nhất: mỗi hàng 1 lệnh set cursor + 16 ký tự
+#define LCD_BATCH_MAX ((LCD_COLS + 1) * LCD_ROWS * LCD_I2C_BYTES_PER_LCD_BYTE)
 
 static uint8_t lcd_address = 0x27;
+static i2c_bus_device_t lcd_dev = NULL;
 static bool lcd_initialized = false;
 
-// Forward declarations
-static void lcd_set_cursor(uint8_t row, uint8_t col);
-static void lcd_print(const char *str);
+// Shadow framebuffer: nội dung đang hiển thị trên LCD
+// lcd_render() chỉ gửi các ô khác với shadow
+static char lcd_shadow[LCD_ROWS][LCD_COLS];
+
+// Display task: mailbox 1 phần tử (xQueueOverwrite) -> luôn vẽ frame mới nhất,
+// producer không bao giờ bị block dù LCD chậm hay mất kết nối
+#define LCD_TASK_STACK     3072
+#define LCD_TASK_PRIORITY  2
+static QueueHandle_t lcd_mailbox = NULL;
+static TaskHandle_t lcd_task_handle = NULL;
+
+// Buffer gom tất cả nibble strobe của một lần render thành 1 transaction I2C
+static uint8_t lcd_batch[LCD_BATCH_MAX];
+static size_t lcd_batch_len = 0;
 
 // I2C Scanner
 static bool i2c_scan_address(uint8_t addr)
 {
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (addr << 1) | I2C_MASTER_WRITE, true);
-    i2c_master_stop(cmd);
-    esp_err_t ret = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, pdMS_TO_TICKS(50));
-    i2c_cmd_link_delete(cmd);
-    return (ret == ESP_OK);
+    return (i2c_bus_probe(addr) == ESP_OK);
 }
 
 static void lcd_write_nibble(uint8_t data)
 {
     uint8_t buf = data | LCD_BACKLIGHT;
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (lcd_address << 1) | I2C_MASTER_WRITE, true);
     
     // Pulse EN: Low -> High -> Low
-    i2c_master_write_byte(cmd, buf, true);           // EN low
-    i2c_master_write_byte(cmd, buf | En, true);      // EN high
-    i2c_master_write_byte(cmd, buf, true);           // EN low
-    
-    i2c_master_stop(cmd);
-    i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, pdMS_TO_TICKS(1000));
-    i2c_cmd_link_delete(cmd);
+    uint8_t seq[3] = {
+        buf,        // EN low
+        buf | En,   // EN high
+        buf,        // EN low
+    };
+    i2c_bus_write(lcd_dev, seq, sizeof(seq), LCD_I2C_TIMEOUT_MS);
     
     esp_rom_delay_us(50);
 }
@@ -86,23 +95,136 @@ static void lcd_cmd(uint8_t cmd)
     }
 }
 
-static void lcd_data(uint8_t data)
+// ========== BATCHED WRITES ==========
+// Ở 100kHz mỗi byte PCF8574 mất ~90us, nên 6 byte giữa 2 lần strobe (~540us)
+// đã dài hơn thời gian thực thi của HD44780 (37us) -> không cần delay giữa các ký tự.
+static void lcd_batch_byte(uint8_t data, uint8_t mode)
 {
-    lcd_send_byte(data, Rs);
-    esp_rom_delay_us(50);
+    uint8_t nibbles[2] = {
+        (uint8_t)((data & 0xF0) | mode | LCD_BACKLIGHT),
+        (uint8_t)(((data << 4) & 0xF0) | mode | LCD_BACKLIGHT),
+    };
+    for (int i = 0; i < 2; i++) {
+        lcd_batch[lcd_batch_len++] = nibbles[i];        // EN low
+        lcd_batch[lcd_batch_len++] = nibbles[i] | En;   // EN high
+        lcd_batch[lcd_batch_len++] = nibbles[i];        // EN low
+    }
 }
 
-static void lcd_set_cursor(uint8_t row, uint8_t col)
+static esp_err_t lcd_batch_flush(void)
 {
-    uint8_t pos = (row == 0) ? (0x80 + col) : (0xC0 + col);
-    lcd_cmd(pos);
+    if (lcd_batch_len == 0) {
+        return ESP_OK;
+    }
+    esp_err_t ret = i2c_bus_write(lcd_dev, lcd_batch, lcd_batch_len, LCD_I2C_TIMEOUT_MS);
+    lcd_batch_len = 0;
+    return ret;
 }
 
-static void lcd_print(const char *str)
+// Đánh dấu shadow = màn hình trống (sau lệnh clear 0x01)
+static void lcd_shadow_reset(void)
 {
-    while (*str) {
-        lcd_data(*str++);
+    memset(lcd_shadow, ' ', sizeof(lcd_shadow));
+}
+
+/**
+ * @brief Vẽ 2 hàng (mỗi hàng đúng LCD_COLS ký tự), chỉ gửi các ô thay đổi
+ *
+ * Các đoạn ô thay đổi được gom thành run; hai run chỉ cách nhau 1 ô không đổi
+ * được gộp lại (gửi lại 1 ký tự rẻ bằng 1 lệnh set cursor). Toàn bộ run của
+ * cả 2 hàng được gửi trong MỘT transaction I2C.
+ *
+ * @return Số ô đã gửi
+ */
+static int lcd_render(const char rows[LCD_ROWS][LCD_COLS])
+{
+    int cells = 0;
+
+    for (int r = 0; r < LCD_ROWS; r++) {
+        int c = 0;
+        while (c < LCD_COLS) {
+            if (rows[r][c] == lcd_shadow[r][c]) {
+                c++;
+                continue;
+            }
+
+            // Tìm cuối run, gộp khoảng trống 1 ô
+            int end = c + 1;
+            while (end < LCD_COLS) {
+                if (rows[r][end] != lcd_shadow[r][end]) {
+                    end++;
+                } else if (end + 1 < LCD_COLS && rows[r][end + 1] != lcd_shadow[r][end + 1]) {
+                    end += 2;
+                } else {
+                    break;
+                }
+            }
+
+            lcd_batch_byte((uint8_t)(((r == 0) ? 0x80 : 0xC0) + c), 0);  // set cursor
+            for (int i = c; i < end; i++) {
+                lcd_batch_byte((uint8_t)rows[r][i], Rs);
+                lcd_shadow[r][i] = rows[r][i];
+            }
+            cells += end - c;
+            c = end;
+        }
     }
+
+    if (lcd_batch_flush() != ESP_OK) {
+        // Không chắc LCD đã nhận gì -> lần sau vẽ lại toàn bộ
+        memset(lcd_shadow, 0, sizeof(lcd_shadow));
+        ESP_LOGW(TAG, "LCD write failed, full redraw next time");
+    }
+    return cells;
+}
+
+// Format một dòng vào hàng LCD, đệm space cho đủ LCD_COLS
+static void lcd_format_row(char row[LCD_COLS], const char *text)
+{
+    size_t len = strnlen(text, LCD_COLS);
+    memcpy(row, text, len);
+    memset(row + len, ' ', LCD_COLS - len);
+}
+
+// ========== DISPLAY TASK ==========
+static void lcd_display_task(void *pvParameters)
+{
+    (void) pvParameters;
+    sensor_frame_t frame;
+
+    while (1) {
+        if (xQueueReceive(lcd_mailbox, &frame, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        // mq_ppm giữ giá trị hợp lệ gần nhất; 0 nghĩa là chưa từng có
+        float ppm = (frame.mq_ppm > 0.0f) ? frame.mq_ppm : -1.0f;
+        lcd_display_all(frame.temperature, frame.humidity, frame.air_level, ppm);
+    }
+}
+
+static void lcd_start_display_task(void)
+{
+    if (lcd_task_handle != NULL) {
+        return;
+    }
+    lcd_mailbox = xQueueCreate(1, sizeof(sensor_frame_t));
+    if (lcd_mailbox == NULL) {
+        ESP_LOGE(TAG, "Failed to create LCD mailbox");
+        return;
+    }
+    if (xTaskCreate(lcd_display_task, "lcd_task", LCD_TASK_STACK, NULL,
+                    LCD_TASK_PRIORITY, &lcd_task_handle) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create LCD task");
+        lcd_task_handle = NULL;
+    }
+}
+
+void lcd_post_frame(const sensor_frame_t *frame)
+{
+    if (lcd_mailbox == NULL || frame == NULL) {
+        return;  // LCD không có -> bỏ qua, không ảnh hưởng producer
+    }
+    xQueueOverwrite(lcd_mailbox, frame);
 }
 
 void lcd_init(void)
@@ -113,6 +235,11 @@ void lcd_init(void)
         return;
     }
 
+    if (i2c_bus_init() != ESP_OK) {
+        ESP_LOGE(TAG, "I2C bus not available");
+        return;
+    }
+
     ESP_LOGI(TAG, "Scanning I2C bus for LCD...");
     
     // Scan common addresses for LCD with PCF8574
@@ -133,6 +260,11 @@ void lcd_init(void)
         return;
     }
     
+    if (i2c_bus_add_device(lcd_address, LCD_I2C_FREQ_HZ, &lcd_dev) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to add LCD device 0x%02X", lcd_address);
+        return;
+    }
+    
     ESP_LOGI(TAG, "Initializing LCD at 0x%02X...", lcd_address);
     vTaskDelay(pdMS_TO_TICKS(50));
     
@@ -154,6 +286,7 @@ void lcd_init(void)
     lcd_cmd(0x08);  // Display OFF
     lcd_cmd(0x01);  // Clear display
     vTaskDelay(pdMS_TO_TICKS(2));
+    lcd_shadow_reset();
     lcd_cmd(0x06);  // Entry mode: increment address, no shift
     lcd_cmd(0x0C);  // Display ON, cursor OFF
     
@@ -162,11 +295,13 @@ void lcd_init(void)
     
     // Test message
     lcd_clear();
-    lcd_set_cursor(0, 0);
-    lcd_print("TRINITY IoT");
-    lcd_set_cursor(1, 0);
-    lcd_print("Env Monitor V1");
+    char rows[LCD_ROWS][LCD_COLS];
+    lcd_format_row(rows[0], "TRINITY IoT");
+    lcd_format_row(rows[1], "Env Monitor V1");
+    lcd_render(rows);
     vTaskDelay(pdMS_TO_TICKS(2000));
+
+    lcd_start_display_task();
 }
 
 void lcd_clear(void)
@@ -175,8 +310,13 @@ void lcd_clear(void)
         ESP_LOGW(TAG, "LCD not initialized");
         return;
     }
+    if (i2c_bus_lock(LCD_I2C_TIMEOUT_MS * 20) != ESP_OK) {
+        return;
+    }
     lcd_cmd(0x01);
     vTaskDelay(pdMS_TO_TICKS(2));
+    lcd_shadow_reset();
+    i2c_bus_unlock();
 }
 
 /**
@@ -201,7 +341,7 @@ void lcd_display_all(float temp, float hum, int air_level, float ppm)
         return;
     }
 
-    char line1[17], line2[17];
+    char line1[LCD_COLS + 1], line2[LCD_COLS + 1];
     
     // Row 0: Temperature and Humidity
     // Format: "T:23.5C H:65.2%"
@@ -223,15 +363,20 @@ void lcd_display_all(float temp, float hum, int air_level, float ppm)
         snprintf(line2, sizeof(line2), "AQ:%-12s", aq_labels[air_level]);
     }
     
-    // Update display
-    lcd_set_cursor(0, 0);
-    lcd_print(line1);
-    
-    lcd_set_cursor(1, 0);
-    lcd_print(line2);
+    // Update display - chỉ các ô thay đổi so với frame trước
+    // Giữ bus trong lúc diff + ghi để shadow luôn khớp với màn hình
+    char rows[LCD_ROWS][LCD_COLS];
+    lcd_format_row(rows[0], line1);
+    lcd_format_row(rows[1], line2);
+    if (i2c_bus_lock(LCD_I2C_TIMEOUT_MS * 20) != ESP_OK) {
+        ESP_LOGW(TAG, "I2C bus busy, frame skipped");
+        return;
+    }
+    int cells = lcd_render(rows);
+    i2c_bus_unlock();
     
-    ESP_LOGD(TAG, "Display: T=%.1f°C H=%.1f%% AQ=%s PPM=%.0f", 
-             temp, hum, aq_labels[air_level], ppm);
+    ESP_LOGD(TAG, "Display: T=%.1f°C H=%.1f%% AQ=%s PPM=%.0f (%d cells sent)", 
+             temp, hum, aq_labels[air_level], ppm, cells);
 }
 
 /**
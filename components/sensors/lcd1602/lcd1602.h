@@ -7,12 +7,23 @@
 #ifndef LCD1602_H
 #define LCD1602_H
 
+#include "sensor_frame.h"
+
 /**
  * @brief Khởi tạo LCD1602
  * Tự động scan địa chỉ I2C (0x27, 0x3F, 0x20, 0x38)
+ * và khởi động display task (ưu tiên thấp) nếu tìm thấy LCD
  */
 void lcd_init(void);
 
+/**
+ * @brief Gửi frame cảm biến cho display task (bất đồng bộ, không block)
+ *
+ * Mailbox chỉ có 1 ô và bị ghi đè: display task luôn vẽ frame mới nhất,
+ * frame cũ chưa vẽ sẽ bị bỏ. Không làm gì nếu LCD không được tìm thấy.
+ */
+void lcd_post_frame(const sensor_frame_t *frame);
+
 /**
  * @brief Xóa màn hình LCD
  */
@@ -1,35 +1,63 @@
 #include "mq135.h"
+#include "mq135_math.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "esp_adc/adc_cali.h"
 #include "esp_adc/adc_cali_scheme.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "esp_adc/adc_continuous.h"
+#include "soc/soc_caps.h"
 #include "nvs_flash.h"
 #include "nvs.h"
+#include "moving_average.h"
+#include "burst_reduce.h"
 #include <math.h>
 
 #define MQ135_PIN ADC_CHANNEL_0
 #define MQ135_ATTEN ADC_ATTEN_DB_12
 #define MQ135_WIDTH ADC_BITWIDTH_12
 
-// ================= MQ135 CONSTANTS =================
-// Load resistance (module MQ-135 thường là 10k hoặc 1k tùy module)
-#define RL_VALUE 10.0f          // kOhm - kiểm tra trên module của bạn
+// Hằng số cảm biến (RL, VCC, PARA_A/B...) nằm trong mq135_math.h
 
-// Module MQ-135 có mạch chia áp, output 0-3.3V cho ESP32
-// Nếu module chạy 5V heater nhưng có opamp/divider -> output 3.3V max
-#define VCC_SENSOR 3.3f  // Điện áp tham chiếu cho ADC (module đã chia áp)
+// Số mẫu mỗi burst - reducer chống outlier nên 8 mẫu đủ ổn định (trước: 20 mẫu mean)
+// Oneshot: 8 lần đọc; continuous: 8 frame DMA (mỗi frame = trung bình 128 mẫu)
+#define ADC_SAMPLES 8
+#define ADC_SAMPLE_DELAY_MS 5
 
-// Datasheet: Rs/Ro ≈ 3.6 trong không khí sạch (~400ppm CO2)
-#define CLEAN_AIR_FACTOR 3.6f
+// Reducer gộp burst (xem burst_reduce.h): MEAN / TRIMMED / MEDIAN / MAD
+// Có thể đổi lúc chạy bằng mq135_set_burst_reducer()
+#ifndef MQ135_BURST_REDUCER
+#define MQ135_BURST_REDUCER BURST_REDUCER_MAD(3)
+#endif
 
-// CO2 curve (estimated, from datasheet log-log)
-#define PARA_A 116.6020682f
-#define PARA_B -2.769034857f
+// ================= CONTINUOUS (DMA) MODE =================
+// 1 = ADC chạy liên tục bằng DMA ở tần số cố định, mq135_read_raw() chỉ gom
+//     các frame đã có sẵn trong ring buffer (không block, không jitter)
+// 0 = chế độ oneshot cũ (20 lần đọc + vTaskDelay)
+#ifndef MQ135_USE_CONTINUOUS_ADC
+#define MQ135_USE_CONTINUOUS_ADC 1
+#endif
 
-// Số mẫu để lấy trung bình
-#define ADC_SAMPLES 20
-#define ADC_SAMPLE_DELAY_MS 5
+#define ADC_CONT_SAMPLE_FREQ_HZ  20000   // Tần số thấp nhất ESP32 hỗ trợ (SOC_ADC_SAMPLE_FREQ_THRES_LOW)
+#define ADC_CONT_FRAME_BYTES     256     // 128 mẫu/frame (~6.4ms @ 20kHz)
+// Pool DMA giữ tối đa ADC_SAMPLES frame (~51ms) -> reducer nhận tối đa ADC_SAMPLES
+// frame, frame cũ (chu kỳ trước) bị bỏ. Pool vừa bị flush có thể thiếu frame:
+// khi đó chờ thêm đến ADC_CONT_MIN_FRAMES, không đủ thì báo lỗi như oneshot
+#define ADC_CONT_POOL_BYTES      (ADC_SAMPLES * ADC_CONT_FRAME_BYTES)
+// Window = đúng số frame pool giữ được: một lần drain sau 5s đã đẩy hết frame cũ ra
+#define ADC_CONT_WINDOW          (ADC_CONT_POOL_BYTES / ADC_CONT_FRAME_BYTES)
+#define ADC_CONT_PRIME_TIMEOUT_MS 20     // Chỉ chờ khi pool DMA còn rỗng (lần đọc đầu)
+#define ADC_CONT_STALE_US        100000  // Frame cũ hơn 100ms (chu kỳ trước) -> bỏ window
+#define ADC_CONT_MIN_FRAMES      (ADC_SAMPLES / 2)  // Ít hơn -> window thiếu, chờ thêm frame
+
+// ================= PPM LOOKUP TABLE =================
+// 1 = raw → Vout/ppm bằng bảng 257 điểm dựng sẵn (dựng lại khi Ro đổi),
+//     không gọi adc_cali_raw_to_voltage / powf mỗi lần đọc
+// 0 = tính float đầy đủ mỗi lần đọc
+#ifndef MQ135_USE_PPM_LUT
+#define MQ135_USE_PPM_LUT 1
+#endif
 
 // ================= NVS =================
 #define NVS_NAMESPACE "mq135"
@@ -38,10 +66,52 @@
 static const char *TAG = "MQ135";
 
 static adc_oneshot_unit_handle_t adc_handle = NULL;
+#if MQ135_USE_CONTINUOUS_ADC
+static adc_continuous_handle_t adc_cont_handle = NULL;
+// Mỗi ô trong window = trung bình của 1 frame DMA (decimation 128:1)
+// Running-sum window: mean O(1) thay vì cộng lại mỗi lần đọc
+static int16_t adc_window_buf[ADC_CONT_WINDOW];
+static ma_i16_t adc_window = {
+    .buf = adc_window_buf, .size = ADC_CONT_WINDOW,
+};
+static int64_t adc_window_stamp_us = 0;  // Thời điểm drain gần nhất có frame
+#endif
+static burst_reducer_t burst_reducer = MQ135_BURST_REDUCER;
+
 static adc_cali_handle_t adc_cali_handle = NULL;  // ⭐ THÊM: ADC calibration handle
 static float calibration_Ro = 0.0f;   // kOhm
 static bool is_calibrated = false;
 
+#if MQ135_USE_PPM_LUT
+static mq135_lut_t ppm_lut;
+static bool ppm_lut_ready = false;
+#endif
+
+// Raw → Vout (V): dùng ADC calibration nếu có, nếu không thì tuyến tính
+static float mq135_raw_to_vout(uint16_t raw, void *ctx) {
+    (void) ctx;
+    if (adc_cali_handle) {
+        int voltage_mv = 0;
+        if (adc_cali_raw_to_voltage(adc_cali_handle, raw, &voltage_mv) == ESP_OK) {
+            return voltage_mv / 1000.0f;  // Convert mV to V
+        }
+        // Fallback nếu calibration thất bại
+    }
+    return mq135_math_linear_vout(raw);
+}
+
+// Gọi mỗi khi calibration_Ro hoặc ADC calibration thay đổi
+static void mq135_rebuild_lut(void) {
+#if MQ135_USE_PPM_LUT
+    int64_t t0 = esp_timer_get_time();
+    mq135_lut_build(&ppm_lut, calibration_Ro, mq135_raw_to_vout, NULL);
+    ppm_lut_ready = true;
+    ESP_LOGI(TAG, "PPM LUT built (Ro=%.2f kOhm, %d knots, %lld us)",
+             calibration_Ro > 0.0f ? calibration_Ro : DEFAULT_RO, MQ135_LUT_KNOTS,
+             (long long)(esp_timer_get_time() - t0));
+#endif
+}
+
 // ================= NVS FUNCTIONS =================
 __attribute__((unused))
 static esp_err_t save_ro_to_nvs(float ro_value) {
@@ -68,7 +138,77 @@ static esp_err_t load_ro_from_nvs(float *ro_value) {
 }
 
 // ================= ADC =================
+#if MQ135_USE_CONTINUOUS_ADC
+static esp_err_t mq135_continuous_start(void) {
+    adc_continuous_handle_cfg_t handle_cfg = {
+        .max_store_buf_size = ADC_CONT_POOL_BYTES,
+        .conv_frame_size = ADC_CONT_FRAME_BYTES,
+        .flags.flush_pool = true,  // Pool đầy -> bỏ dữ liệu cũ, luôn giữ mẫu mới nhất
+    };
+    esp_err_t ret = adc_continuous_new_handle(&handle_cfg, &adc_cont_handle);
+    if (ret != ESP_OK) return ret;
+
+    adc_digi_pattern_config_t pattern = {
+        .atten = MQ135_ATTEN,
+        .channel = MQ135_PIN & 0x7,
+        .unit = ADC_UNIT_1,
+        .bit_width = SOC_ADC_DIGI_MAX_BITWIDTH,
+    };
+    adc_continuous_config_t dig_cfg = {
+        .pattern_num = 1,
+        .adc_pattern = &pattern,
+        .sample_freq_hz = ADC_CONT_SAMPLE_FREQ_HZ,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_DIGI_OUTPUT_FORMAT_TYPE1,
+    };
+    ret = adc_continuous_config(adc_cont_handle, &dig_cfg);
+    if (ret == ESP_OK) ret = adc_continuous_start(adc_cont_handle);
+    if (ret != ESP_OK) {
+        adc_continuous_deinit(adc_cont_handle);
+        adc_cont_handle = NULL;
+    }
+    return ret;
+}
+
+// Gom tất cả frame đang có trong pool DMA vào window (timeout 0 = không block)
+// Window chỉ chứa frame của lần đọc hiện tại: nếu lần drain trước đã lâu
+// (chu kỳ 5s trước) thì xóa window trước khi nạp frame mới
+static void mq135_continuous_drain(uint32_t timeout_ms) {
+    static uint8_t frame[ADC_CONT_FRAME_BYTES];
+    uint32_t len = 0;
+
+    if (adc_window.count > 0 && esp_timer_get_time() - adc_window_stamp_us > ADC_CONT_STALE_US) {
+        ma_i16_reset(&adc_window);
+    }
+
+    while (adc_continuous_read(adc_cont_handle, frame, sizeof(frame), &len, timeout_ms) == ESP_OK) {
+        uint32_t sum = 0;
+        int n = 0;
+        for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= len; i += SOC_ADC_DIGI_RESULT_BYTES) {
+            adc_digi_output_data_t *p = (adc_digi_output_data_t *)&frame[i];
+            if (p->type1.channel == MQ135_PIN) {
+                sum += p->type1.data;
+                n++;
+            }
+        }
+        if (n > 0) {
+            ma_i16_add(&adc_window, (int16_t)(sum / n));
+            adc_window_stamp_us = esp_timer_get_time();
+        }
+        timeout_ms = 0;  // Chỉ chờ cho frame đầu tiên
+    }
+}
+#endif
+
 void mq135_init(void) {
+#if MQ135_USE_CONTINUOUS_ADC
+    esp_err_t cont_ret = mq135_continuous_start();
+    if (cont_ret == ESP_OK) {
+        ESP_LOGI(TAG, "ADC continuous mode started (%d Hz, DMA)", ADC_CONT_SAMPLE_FREQ_HZ);
+    } else {
+        ESP_LOGE(TAG, "ADC continuous init failed: %s", esp_err_to_name(cont_ret));
+    }
+#else
     adc_oneshot_unit_init_cfg_t init_cfg = {
         .unit_id = ADC_UNIT_1,
         .ulp_mode = ADC_ULP_MODE_DISABLE,
@@ -80,6 +220,7 @@ void mq135_init(void) {
         .atten = MQ135_ATTEN,
     };
     adc_oneshot_config_channel(adc_handle, MQ135_PIN, &chan_cfg);
+#endif
 
     // ⭐ THÊM: Khởi tạo ADC calibration để đọc chính xác hơn
     adc_cali_line_fitting_config_t cali_config = {
@@ -104,30 +245,52 @@ void mq135_init(void) {
     } else {
         ESP_LOGW(TAG, "No calibration found – please calibrate!");
     }
+
+    mq135_rebuild_lut();
 }
 
 uint16_t mq135_read_raw(void) {
-    uint32_t sum = 0;
+#if MQ135_USE_CONTINUOUS_ADC
+    if (adc_cont_handle == NULL) return 0;
+
+    // Pool luôn có frame sẵn -> trả về ngay; chỉ chờ tối đa 1 frame khi pool rỗng (vừa khởi động)
+    mq135_continuous_drain(ADC_CONT_PRIME_TIMEOUT_MS);
+
+    // Window ngắn (pool vừa flush / vừa khởi động): chờ thêm từng frame (~6.4ms)
+    for (int i = 0; i < ADC_CONT_MIN_FRAMES && adc_window.count < ADC_CONT_MIN_FRAMES; i++) {
+        mq135_continuous_drain(ADC_CONT_PRIME_TIMEOUT_MS);
+    }
+    if (adc_window.count < ADC_CONT_MIN_FRAMES) return 0;  // Không đủ frame
+
+    if (burst_reducer.mode == BURST_REDUCE_MEAN) {
+        return (uint16_t)ma_i16_get(&adc_window);  // Running sum, O(1)
+    }
+
+    // Window frame gần nhất là burst cho reducer
+    uint16_t burst[ADC_CONT_WINDOW];
+    uint16_t n = adc_window.count;
+    for (uint16_t i = 0; i < n; i++) {
+        burst[i] = (uint16_t)ma_i16_recent(&adc_window, i);
+    }
+    return burst_reduce(&burst_reducer, burst, n);
+#else
     int valid_samples = 0;
-    int readings[ADC_SAMPLES];
+    uint16_t readings[ADC_SAMPLES];
     
     // Đọc nhiều mẫu
     for (int i = 0; i < ADC_SAMPLES; i++) {
         int val = 0;
         if (adc_oneshot_read(adc_handle, MQ135_PIN, &val) == ESP_OK) {
-            readings[valid_samples++] = val;
+            readings[valid_samples++] = (uint16_t)val;
         }
         vTaskDelay(pdMS_TO_TICKS(ADC_SAMPLE_DELAY_MS));
     }
     
-    if (valid_samples < 5) return 0;  // Không đủ mẫu
-    
-    // Lấy trung bình đơn giản - KHÔNG loại outliers để phản hồi nhanh
-    for (int i = 0; i < valid_samples; i++) {
-        sum += readings[i];
-    }
+    if (valid_samples < ADC_SAMPLES / 2) return 0;  // Không đủ mẫu
     
-    return (uint16_t)(sum / valid_samples);
+    // Reducer loại outliers -> burst ngắn vẫn ổn định
+    return burst_reduce(&burst_reducer, readings, valid_samples);
+#endif
 }
 
 // ================= TÍNH PPM THEO CÔNG THỨC DATASHEET =================
@@ -141,8 +304,9 @@ uint16_t mq135_read_raw(void) {
 //   Vout = ADC_raw / 4095 * Vref
 //   Rs = RL * (Vcc - Vout) / Vout
 
-// Lưu giá trị PPM trước để làm mượt
-static float last_valid_ppm = 400.0f;
+// EWMA làm mượt PPM - alpha = 0.3 để ưu tiên ổn định hơn phản hồi
+#define PPM_EWMA_ALPHA 0.3f
+static ewma_f32_t ppm_ewma = { .alpha = PPM_EWMA_ALPHA, .value = 400.0f, .primed = true };
 static bool sensor_connected = false;
 
 // Kiểm tra sensor có kết nối không
@@ -152,23 +316,37 @@ bool mq135_is_connected(void) {
     int stable_count = 0;
     int invalid_count = 0;
     
+#if MQ135_USE_CONTINUOUS_ADC
+    // Dùng các frame trong window (tối đa ADC_CONT_WINDOW) thay vì đọc oneshot
+    if (adc_cont_handle != NULL) {
+        mq135_continuous_drain(ADC_CONT_PRIME_TIMEOUT_MS);
+    }
+    int n = adc_window.count;
+    for (int i = 0; i < n; i++) {
+        int val = ma_i16_recent(&adc_window, (uint16_t)i);
+#else
     for (int i = 0; i < 10; i++) {
         int val = 0;
-        if (adc_oneshot_read(adc_handle, MQ135_PIN, &val) == ESP_OK) {
-            // Giá trị hợp lệ khi sensor kết nối: 100-3800
-            if (val >= 100 && val <= 3800) {
-                stable_count++;
-            }
-            // Giá trị bất thường (floating hoặc short)
-            else if (val < 30 || val > 4050) {
-                invalid_count++;
-            }
-        }
+        esp_err_t ret = adc_oneshot_read(adc_handle, MQ135_PIN, &val);
         vTaskDelay(pdMS_TO_TICKS(10));
+        if (ret != ESP_OK) continue;
+#endif
+        // Giá trị hợp lệ khi sensor kết nối: 100-3800
+        if (val >= 100 && val <= 3800) {
+            stable_count++;
+        }
+        // Giá trị bất thường (floating hoặc short)
+        else if (val < 30 || val > 4050) {
+            invalid_count++;
+        }
     }
     
-    // Sensor kết nối nếu có ít nhất 6/10 mẫu hợp lệ
+    // Sensor kết nối nếu có ít nhất 60% mẫu hợp lệ (6/10)
+#if MQ135_USE_CONTINUOUS_ADC
+    sensor_connected = (n > 0) && (stable_count * 10 >= n * 6);
+#else
     sensor_connected = (stable_count >= 6);
+#endif
     
     if (!sensor_connected) {
         ESP_LOGW(TAG, "MQ135 sensor NOT connected! (valid=%d, invalid=%d)", 
@@ -178,8 +356,17 @@ bool mq135_is_connected(void) {
     return sensor_connected;
 }
 
-float mq135_read_ppm(void) {
+// Một lần lấy mẫu -> raw, Vout, Rs, Rs/Ro, PPM (tất cả từ cùng một giá trị raw)
+esp_err_t mq135_read_sample(mq135_sample_t *out) {
+    if (out == NULL) return ESP_ERR_INVALID_ARG;
+
     uint16_t raw = mq135_read_raw();
+    out->raw = raw;
+
+    if (raw == 0) {
+        // Chưa có dữ liệu ADC (driver chưa chạy hoặc window rỗng)
+        return ESP_ERR_INVALID_STATE;
+    }
     
     // Kiểm tra giá trị ADC hợp lệ
     // Floating pin thường cho giá trị rất thấp (<30) hoặc rất cao (>4050)
@@ -187,73 +374,48 @@ float mq135_read_ppm(void) {
     if (raw < 100 || raw > 3800) {
         ESP_LOGW(TAG, "ADC raw invalid: %u (sensor may not be connected)", raw);
         sensor_connected = false;
-        return -1.0f;  // Trả về -1 để báo lỗi
+        return ESP_ERR_INVALID_RESPONSE;
     }
     
     sensor_connected = true;
     
-    // ⭐ CẢI TIẾN: Dùng ADC calibration thay vì linear mapping
-    // Tính Vout từ ADC (12-bit = 4095, Vref = 3.3V)
-    float vout;
-    if (adc_cali_handle) {
-        // Sử dụng calibration chính xác
-        int voltage_mv = 0;
-        esp_err_t ret = adc_cali_raw_to_voltage(adc_cali_handle, raw, &voltage_mv);
-        if (ret == ESP_OK) {
-            vout = voltage_mv / 1000.0f;  // Convert mV to V
-        } else {
-            // Fallback nếu calibration thất bại
-            vout = (raw / 4095.0f) * VCC_SENSOR;
-        }
-    } else {
-        // Không có calibration, dùng linear mapping
-        vout = (raw / 4095.0f) * VCC_SENSOR;
-    }
-    
-    // Tránh chia cho 0 và giới hạn voltage range
-    if (vout < 0.05f) {
-        vout = 0.05f;
+    float vout, ppm;
+#if MQ135_USE_PPM_LUT
+    if (ppm_lut_ready) {
+        // Bảng tra: không adc_cali / powf trên đường đọc
+        mq135_lut_lookup(&ppm_lut, raw, &vout, &ppm);
+    } else
+#endif
+    {
+        // ⭐ CẢI TIẾN: Dùng ADC calibration thay vì linear mapping
+        vout = mq135_raw_to_vout(raw, NULL);
+        // Công thức PPM = A * (Rs/Ro)^B
+        ppm = mq135_math_ppm(mq135_math_ratio(mq135_math_rs(vout), calibration_Ro));
     }
-    if (vout > 3.25f) {
-        vout = 3.25f;
-    }
-    
-    // Tính Rs (kOhm) từ mạch chia áp
-    // Rs = RL * (Vcc - Vout) / Vout
-    float rs = RL_VALUE * (VCC_SENSOR - vout) / vout;
-    
-    // Sử dụng Ro từ calibration, nếu chưa có thì dùng giá trị mặc định
-    float ro = calibration_Ro;
-    if (ro <= 0.0f) {
-        // Ro mặc định = Rs_clean_air / CLEAN_AIR_FACTOR
-        // Giả sử Rs trong không khí sạch khoảng 30-50 kOhm
-        ro = 10.0f;  // kOhm - giá trị mặc định hợp lý
-    }
-    
-    // Tính tỷ lệ Rs/Ro
-    float ratio = rs / ro;
-    
-    // ⭐ CẢI TIẾN: Giới hạn ratio chặt chẽ hơn để tránh giá trị cực đoan
-    if (ratio < 0.5f) ratio = 0.5f;   // Thay vì 0.1
-    if (ratio > 8.0f) ratio = 8.0f;   // Thay vì 10.0
-    
-    // Công thức PPM = A * (Rs/Ro)^B
-    // PPM = 116.6 * ratio^(-2.769)
-    float ppm = PARA_A * powf(ratio, PARA_B);
-    
-    // Giới hạn PPM trong khoảng hợp lý
-    if (ppm < 350.0f) ppm = 350.0f;
-    if (ppm > 9999.0f) ppm = 9999.0f;
+
+    // Rs và Rs/Ro chỉ tốn 2 phép chia, tính lại từ Vout cho frame
+    float rs = mq135_math_rs(vout);
+    float ratio = mq135_math_ratio(rs, calibration_Ro);
     
     // ⭐ CẢI TIẾN: Giảm alpha để ổn định hơn (0.3 thay vì 0.6)
-    // Exponential Moving Average - alpha = 0.3 để ưu tiên ổn định hơn phản hồi
-    float smoothed_ppm = 0.3f * ppm + 0.7f * last_valid_ppm;
-    last_valid_ppm = smoothed_ppm;
+    float smoothed_ppm = ewma_f32_add(&ppm_ewma, ppm);
 
     ESP_LOGI(TAG, "ADC=%u, Vout=%.3fV, Rs=%.2fkΩ, Rs/Ro=%.2f → PPM=%.0f (smooth=%.0f)", 
              raw, vout, rs, ratio, ppm, smoothed_ppm);
 
-    return smoothed_ppm;
+    out->vout = vout;
+    out->rs = rs;
+    out->ratio = ratio;
+    out->ppm = smoothed_ppm;
+    return ESP_OK;
+}
+
+float mq135_read_ppm(void) {
+    mq135_sample_t sample = {0};
+    if (mq135_read_sample(&sample) != ESP_OK) {
+        return -1.0f;  // Trả về -1 để báo lỗi
+    }
+    return sample.ppm;
 }
 
 // ================= CALIBRATION =================
@@ -284,20 +446,8 @@ esp_err_t mq135_calibrate(void) {
             continue;
         }
         
-        // Convert to voltage using calibration if available
-        float vout;
-        if (adc_cali_handle) {
-            int voltage_mv = 0;
-            adc_cali_raw_to_voltage(adc_cali_handle, raw, &voltage_mv);
-            vout = voltage_mv / 1000.0f;
-        } else {
-            vout = (raw / 4095.0f) * VCC_SENSOR;
-        }
-        
-        if (vout < 0.05f) vout = 0.05f;
-        
-        // Calculate Rs
-        float rs = RL_VALUE * (VCC_SENSOR - vout) / vout;
+        // Convert to voltage using calibration if available, then Rs
+        float rs = mq135_math_rs(mq135_raw_to_vout(raw, NULL));
         rs_sum += rs;
         valid_samples++;
         
@@ -311,14 +461,16 @@ esp_err_t mq135_calibrate(void) {
     if (valid_samples < 30) {
         ESP_LOGE(TAG, "Calibration failed: not enough valid samples (%d)", valid_samples);
         // Fallback to default
-        calibration_Ro = 10.0f;
+        calibration_Ro = DEFAULT_RO;
         is_calibrated = true;
+        mq135_rebuild_lut();
         return ESP_FAIL;
     }
     
     // Calculate average Rs and Ro
     float rs_avg = rs_sum / valid_samples;
     calibration_Ro = rs_avg / CLEAN_AIR_FACTOR;
+    mq135_rebuild_lut();
     
     ESP_LOGI(TAG, "Calibration complete:");
     ESP_LOGI(TAG, "  Valid samples: %d", valid_samples);
@@ -339,6 +491,12 @@ esp_err_t mq135_calibrate(void) {
     return ESP_OK;
 }
 
+void mq135_set_burst_reducer(const burst_reducer_t *reducer) {
+    if (reducer == NULL) return;
+    burst_reducer = *reducer;
+    ESP_LOGI(TAG, "Burst reducer: %s", burst_reduce_mode_name(burst_reducer.mode));
+}
+
 bool mq135_has_calibration(void) {
     // ⭐ CẢI TIẾN: Kiểm tra thực sự có calibration
     return is_calibrated && (calibration_Ro > 0.0f);
@@ -347,6 +505,7 @@ bool mq135_has_calibration(void) {
 esp_err_t mq135_clear_calibration(void) {
     calibration_Ro = 0.0f;
     is_calibrated = false;
+    mq135_rebuild_lut();
 
     nvs_handle_t nvs;
     if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs) == ESP_OK) {
@@ -364,10 +523,22 @@ void mq135_deinit(void) {
         adc_cali_handle = NULL;
     }
     
+#if MQ135_USE_CONTINUOUS_ADC
+    if (adc_cont_handle) {
+        adc_continuous_stop(adc_cont_handle);
+        adc_continuous_deinit(adc_cont_handle);
+        adc_cont_handle = NULL;
+    }
+    ma_i16_reset(&adc_window);
+#endif
+
     if (adc_handle) {
         adc_oneshot_del_unit(adc_handle);
         adc_handle = NULL;
     }
     is_calibrated = false;
     calibration_Ro = 0.0f;
+#if MQ135_USE_PPM_LUT
+    ppm_lut_ready = false;
+#endif
 }
\ No newline at end of file
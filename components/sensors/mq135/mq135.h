@@ -5,6 +5,7 @@
 #include <stdbool.h>
 #include "esp_err.h"
 #include "esp_adc/adc_oneshot.h"
+#include "burst_reduce.h"
 
 /*
  * MQ-135 Air Quality Sensor Driver
@@ -16,6 +17,20 @@
  * - ppm value is ESTIMATED (CO2 equivalent), not laboratory accurate
  */
 
+/**
+ * @brief Kết quả của MỘT lần lấy mẫu MQ135
+ *
+ * Mọi trường đều được tính từ cùng một giá trị raw, để mức AQ (dựa trên raw)
+ * và PPM luôn nhất quán với nhau.
+ */
+typedef struct {
+    uint16_t raw;    // ADC raw (0-4095)
+    float vout;      // Điện áp ngõ ra sensor (V)
+    float rs;        // Điện trở sensor (kOhm)
+    float ratio;     // Rs/Ro (đã giới hạn 0.5-8.0)
+    float ppm;       // CO2 tương đương (ppm, đã làm mượt EMA)
+} mq135_sample_t;
+
 // ========== INIT / DEINIT ==========
 void mq135_init(void);
 void mq135_deinit(void);
@@ -29,10 +44,23 @@ bool mq135_is_connected(void);
 
 /**
  * @brief Read raw ADC value (0–4095)
- * @return Raw ADC value
+ *
+ * Continuous mode (MQ135_USE_CONTINUOUS_ADC=1): gộp tối đa ADC_SAMPLES frame DMA
+ * của lần đọc hiện tại bằng burst reducer (frame chu kỳ trước bị bỏ). Thường
+ * không block; chỉ chờ thêm vài frame khi pool chưa có đủ ADC_SAMPLES / 2.
+ *
+ * @return Raw ADC value (0 nếu chưa có dữ liệu hoặc không đủ frame)
  */
 uint16_t mq135_read_raw(void);
 
+/**
+ * @brief Chọn reducer gộp burst ADC cho kênh MQ135
+ *
+ * Mặc định MQ135_BURST_REDUCER (MAD, k = 3). Continuous mode: burst là các
+ * frame trong window; oneshot: ADC_SAMPLES lần đọc liên tiếp.
+ */
+void mq135_set_burst_reducer(const burst_reducer_t *reducer);
+
 // ========== GAS ESTIMATION ==========
 /**
  * @brief Read estimated CO2 equivalent concentration (ppm)
@@ -43,6 +71,17 @@ uint16_t mq135_read_raw(void);
  */
 float mq135_read_ppm(void);
 
+/**
+ * @brief Lấy mẫu một lần và tính toàn bộ chuỗi raw → Vout → Rs → Rs/Ro → ppm
+ *
+ * @param out Kết quả (out->raw luôn được ghi, các trường còn lại chỉ khi ESP_OK)
+ * @return
+ *   - ESP_OK nếu raw hợp lệ và ppm đã được tính
+ *   - ESP_ERR_INVALID_STATE nếu chưa có dữ liệu ADC
+ *   - ESP_ERR_INVALID_RESPONSE nếu raw ngoài khoảng 100-3800 (sensor có thể mất kết nối)
+ */
+esp_err_t mq135_read_sample(mq135_sample_t *out);
+
 // ========== AIR QUALITY INDEX (RELATIVE) ==========
 /**
  * @brief Get air quality level (relative index)
@@ -0,0 +1,50 @@
+#include "mq135_math.h"
+#include <math.h>
+
+// ================= FLOAT PATH =================
+float mq135_math_linear_vout(uint16_t raw) {
+    return (raw / 4095.0f) * VCC_SENSOR;
+}
+
+float mq135_math_rs(float vout) {
+    // Tránh chia cho 0 và giới hạn voltage range
+    if (vout < 0.05f) vout = 0.05f;
+    if (vout > 3.25f) vout = 3.25f;
+
+    // Rs = RL * (Vcc - Vout) / Vout
+    return RL_VALUE * (VCC_SENSOR - vout) / vout;
+}
+
+float mq135_math_ratio(float rs, float ro) {
+    if (ro <= 0.0f) ro = DEFAULT_RO;
+
+    float ratio = rs / ro;
+
+    // Giới hạn ratio chặt chẽ để tránh giá trị cực đoan
+    if (ratio < 0.5f) ratio = 0.5f;
+    if (ratio > 8.0f) ratio = 8.0f;
+    return ratio;
+}
+
+float mq135_math_ppm(float ratio) {
+    // PPM = 116.6 * ratio^(-2.769)
+    float ppm = PARA_A * powf(ratio, PARA_B);
+
+    // Giới hạn PPM trong khoảng hợp lý
+    if (ppm < 350.0f) ppm = 350.0f;
+    if (ppm > 9999.0f) ppm = 9999.0f;
+    return ppm;
+}
+
+// ================= LOOKUP TABLE =================
+void mq135_lut_build(mq135_lut_t *lut, float ro, mq135_vout_fn_t vout_fn, void *ctx) {
+    for (int i = 0; i < MQ135_LUT_KNOTS; i++) {
+        // Điểm mốc cuối (4096) nằm ngoài dải 12-bit -> dùng 4095
+        uint32_t code = (uint32_t)i << MQ135_LUT_SHIFT;
+        uint16_t raw = (code > 4095) ? 4095 : (uint16_t)code;
+
+        float vout = vout_fn ? vout_fn(raw, ctx) : mq135_math_linear_vout(raw);
+        lut->vout[i] = vout;
+        lut->ppm[i] = mq135_math_ppm(mq135_math_ratio(mq135_math_rs(vout), ro));
+    }
+}
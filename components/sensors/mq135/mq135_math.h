@@ -0,0 +1,80 @@
+#ifndef MQ135_MATH_H
+#define MQ135_MATH_H
+
+#include <stdint.h>
+
+/*
+ * MQ-135 conversion math (không phụ thuộc ESP-IDF)
+ *
+ * Tách riêng khỏi driver để:
+ * - mq135.c dùng chung cho đường float và bảng tra (LUT)
+ * - host_bench/ biên dịch và đo trực tiếp trên máy tính
+ */
+
+// ================= MQ135 CONSTANTS =================
+// Load resistance (module MQ-135 thường là 10k hoặc 1k tùy module)
+#define RL_VALUE 10.0f          // kOhm - kiểm tra trên module của bạn
+
+// Module MQ-135 có mạch chia áp, output 0-3.3V cho ESP32
+// Nếu module chạy 5V heater nhưng có opamp/divider -> output 3.3V max
+#define VCC_SENSOR 3.3f  // Điện áp tham chiếu cho ADC (module đã chia áp)
+
+// Datasheet: Rs/Ro ≈ 3.6 trong không khí sạch (~400ppm CO2)
+#define CLEAN_AIR_FACTOR 3.6f
+
+// Ro mặc định khi chưa calibrate (Rs không khí sạch ~30-50 kOhm / 3.6)
+#define DEFAULT_RO 10.0f        // kOhm
+
+// CO2 curve (estimated, from datasheet log-log)
+#define PARA_A 116.6020682f
+#define PARA_B -2.769034857f
+
+// ================= FLOAT PATH =================
+/** @brief Vout tuyến tính khi không có ADC calibration (12-bit, Vref = VCC_SENSOR) */
+float mq135_math_linear_vout(uint16_t raw);
+
+/** @brief Rs (kOhm) từ mạch chia áp, Vout được giới hạn 0.05-3.25V */
+float mq135_math_rs(float vout);
+
+/** @brief Rs/Ro, giới hạn 0.5-8.0 (Ro <= 0 -> DEFAULT_RO) */
+float mq135_math_ratio(float rs, float ro);
+
+/** @brief PPM = A * ratio^B, giới hạn 350-9999 (dùng powf) */
+float mq135_math_ppm(float ratio);
+
+// ================= LOOKUP TABLE =================
+// 257 điểm mốc cách nhau 16 mã ADC, nội suy tuyến tính ở giữa:
+// 2 KB RAM thay vì 16 KB cho bảng 4096 phần tử. Sai số lớn nhất ~10 ppm, ở vùng
+// ppm cao nơi đường cong dốc nhất (xem host_bench/bench_mq135) - nhỏ hơn nhiều
+// so với sai số của chính cảm biến.
+#define MQ135_LUT_SHIFT  4
+#define MQ135_LUT_KNOTS  ((4096 >> MQ135_LUT_SHIFT) + 1)
+
+typedef struct {
+    float vout[MQ135_LUT_KNOTS];  // V tại raw = i << MQ135_LUT_SHIFT
+    float ppm[MQ135_LUT_KNOTS];   // ppm (chưa làm mượt) tại cùng điểm
+} mq135_lut_t;
+
+/** @brief Hàm chuyển raw → Vout (V), ví dụ qua adc_cali_raw_to_voltage */
+typedef float (*mq135_vout_fn_t)(uint16_t raw, void *ctx);
+
+/**
+ * @brief Dựng lại bảng cho một giá trị Ro
+ *
+ * Phải gọi lại mỗi khi Ro thay đổi (calibrate / clear calibration).
+ * @param vout_fn NULL -> dùng mq135_math_linear_vout
+ */
+void mq135_lut_build(mq135_lut_t *lut, float ro, mq135_vout_fn_t vout_fn, void *ctx);
+
+/** @brief Tra bảng raw (0-4095) → Vout, ppm: 2 lần đọc bảng + nội suy, không powf */
+static inline void mq135_lut_lookup(const mq135_lut_t *lut, uint16_t raw,
+                                    float *vout, float *ppm)
+{
+    if (raw > 4095) raw = 4095;
+    uint16_t i = raw >> MQ135_LUT_SHIFT;
+    float t = (float)(raw & ((1u << MQ135_LUT_SHIFT) - 1)) * (1.0f / (1u << MQ135_LUT_SHIFT));
+    *vout = lut->vout[i] + (lut->vout[i + 1] - lut->vout[i]) * t;
+    *ppm = lut->ppm[i] + (lut->ppm[i + 1] - lut->ppm[i]) * t;
+}
+
+#endif // MQ135_MATH_H
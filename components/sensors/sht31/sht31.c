@@ -1,77 +1,143 @@
 #include "sht31.h"
-#include "driver/i2c.h"
+#include "i2c_bus.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "app_config.h"
 
+#ifndef SHT31_ADDR
 #define SHT31_ADDR 0x44
-#define I2C_MASTER_NUM I2C_NUM_0
-#define I2C_MASTER_SDA_IO PIN_SHT31_SDA
-#define I2C_MASTER_SCL_IO PIN_SHT31_SCL
+#endif
+#define SHT31_I2C_TIMEOUT_MS 20
+
+// Periodic mode: sensor tự đo liên tục, mỗi lần đọc chỉ là 1 transaction fetch (không sleep)
+// 0 = single-shot cũ (gửi lệnh đo + chờ 20ms + đọc)
+#ifndef SHT31_USE_PERIODIC_MODE
+#define SHT31_USE_PERIODIC_MODE 1
+#endif
 
 // Single-shot high repeatability measurement (no clock stretching)
 static const uint8_t SHT31_CMD_MEAS_HIGHREP[2] = { 0x2C, 0x06 };
+// Periodic: 1 measurement/second, high repeatability
+static const uint8_t SHT31_CMD_PERIODIC_1MPS_HIGHREP[2] = { 0x21, 0x30 };
+// Fetch data (periodic mode) - sensor NACK nếu chưa có mẫu mới
+static const uint8_t SHT31_CMD_FETCH_DATA[2] = { 0xE0, 0x00 };
 
 static const char *TAG = "SHT31";
 
+static i2c_bus_device_t sht31_dev = NULL;
+
+// CRC-8: polynomial 0x31 (x^8 + x^5 + x^4 + 1), init 0xFF (datasheet 4.12)
+static const uint8_t sht31_crc8_table[256] = {
+    0x00, 0x31, 0x62, 0x53, 0xC4, 0xF5, 0xA6, 0x97, 0xB9, 0x88, 0xDB, 0xEA, 0x7D, 0x4C, 0x1F, 0x2E,
+    0x43, 0x72, 0x21, 0x10, 0x87, 0xB6, 0xE5, 0xD4, 0xFA, 0xCB, 0x98, 0xA9, 0x3E, 0x0F, 0x5C, 0x6D,
+    0x86, 0xB7, 0xE4, 0xD5, 0x42, 0x73, 0x20, 0x11, 0x3F, 0x0E, 0x5D, 0x6C, 0xFB, 0xCA, 0x99, 0xA8,
+    0xC5, 0xF4, 0xA7, 0x96, 0x01, 0x30, 0x63, 0x52, 0x7C, 0x4D, 0x1E, 0x2F, 0xB8, 0x89, 0xDA, 0xEB,
+    0x3D, 0x0C, 0x5F, 0x6E, 0xF9, 0xC8, 0x9B, 0xAA, 0x84, 0xB5, 0xE6, 0xD7, 0x40, 0x71, 0x22, 0x13,
+    0x7E, 0x4F, 0x1C, 0x2D, 0xBA, 0x8B, 0xD8, 0xE9, 0xC7, 0xF6, 0xA5, 0x94, 0x03, 0x32, 0x61, 0x50,
+    0xBB, 0x8A, 0xD9, 0xE8, 0x7F, 0x4E, 0x1D, 0x2C, 0x02, 0x33, 0x60, 0x51, 0xC6, 0xF7, 0xA4, 0x95,
+    0xF8, 0xC9, 0x9A, 0xAB, 0x3C, 0x0D, 0x5E, 0x6F, 0x41, 0x70, 0x23, 0x12, 0x85, 0xB4, 0xE7, 0xD6,
+    0x7A, 0x4B, 0x18, 0x29, 0xBE, 0x8F, 0xDC, 0xED, 0xC3, 0xF2, 0xA1, 0x90, 0x07, 0x36, 0x65, 0x54,
+    0x39, 0x08, 0x5B, 0x6A, 0xFD, 0xCC, 0x9F, 0xAE, 0x80, 0xB1, 0xE2, 0xD3, 0x44, 0x75, 0x26, 0x17,
+    0xFC, 0xCD, 0x9E, 0xAF, 0x38, 0x09, 0x5A, 0x6B, 0x45, 0x74, 0x27, 0x16, 0x81, 0xB0, 0xE3, 0xD2,
+    0xBF, 0x8E, 0xDD, 0xEC, 0x7B, 0x4A, 0x19, 0x28, 0x06, 0x37, 0x64, 0x55, 0xC2, 0xF3, 0xA0, 0x91,
+    0x47, 0x76, 0x25, 0x14, 0x83, 0xB2, 0xE1, 0xD0, 0xFE, 0xCF, 0x9C, 0xAD, 0x3A, 0x0B, 0x58, 0x69,
+    0x04, 0x35, 0x66, 0x57, 0xC0, 0xF1, 0xA2, 0x93, 0xBD, 0x8C, 0xDF, 0xEE, 0x79, 0x48, 0x1B, 0x2A,
+    0xC1, 0xF0, 0xA3, 0x92, 0x05, 0x34, 0x67, 0x56, 0x78, 0x49, 0x1A, 0x2B, 0xBC, 0x8D, 0xDE, 0xEF,
+    0x82, 0xB3, 0xE0, 0xD1, 0x46, 0x77, 0x24, 0x15, 0x3B, 0x0A, 0x59, 0x68, 0xFF, 0xCE, 0x9D, 0xAC,
+};
+
+static uint8_t sht31_crc8(const uint8_t *data, int len) {
+    uint8_t crc = 0xFF;
+    for (int i = 0; i < len; i++) {
+        crc = sht31_crc8_table[crc ^ data[i]];
+    }
+    return crc;
+}
+
+// Kiểm tra CRC 2 word (temp, hum) và chuyển đổi sang đơn vị vật lý
+static esp_err_t sht31_decode(const uint8_t buffer[6], sht31_data_t *out) {
+    if (sht31_crc8(&buffer[0], 2) != buffer[2] || sht31_crc8(&buffer[3], 2) != buffer[5]) {
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    uint16_t temp_raw = (buffer[0] << 8) | buffer[1];
+    uint16_t hum_raw = (buffer[3] << 8) | buffer[4];
+
+    out->temperature = -45.0f + (175.0f * ((float)temp_raw / 65535.0f));
+    out->humidity = 100.0f * ((float)hum_raw / 65535.0f);
+    return ESP_OK;
+}
+
 void sht31_init(void) {
-    // Configure I2C parameters first
-    i2c_config_t conf = {
-        .mode = I2C_MODE_MASTER,
-        .sda_io_num = I2C_MASTER_SDA_IO,
-        .scl_io_num = I2C_MASTER_SCL_IO,
-        .sda_pullup_en = GPIO_PULLUP_ENABLE,
-        .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = 100000,  // 100kHz for compatibility with LCD
-    };
-    i2c_param_config(I2C_MASTER_NUM, &conf);
-    
-    // Try to install I2C driver
-    esp_err_t ret = i2c_driver_install(I2C_MASTER_NUM, I2C_MODE_MASTER, 0, 0, 0);
-    
-    if (ret == ESP_ERR_INVALID_STATE) {
-        // I2C already initialized (probably by LCD or another component)
-        ESP_LOGI(TAG, "I2C bus already initialized, reusing existing driver");
-    } else if (ret == ESP_OK) {
-        ESP_LOGI(TAG, "SHT31 I2C initialized (SDA=%d, SCL=%d, 100kHz)", 
-                 I2C_MASTER_SDA_IO, I2C_MASTER_SCL_IO);
-    } else {
+    // Bus dùng chung với LCD, do component i2c_bus quản lý
+    esp_err_t ret = i2c_bus_init();
+    if (ret == ESP_OK) {
+        // SHT31 hỗ trợ Fast-mode 400kHz (I2C_MASTER_FREQ_HZ)
+        ret = i2c_bus_add_device(SHT31_ADDR, I2C_MASTER_FREQ_HZ, &sht31_dev);
+    }
+    if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to initialize I2C: %s", esp_err_to_name(ret));
+        sht31_dev = NULL;
+        return;
+    }
+    ESP_LOGI(TAG, "SHT31 on I2C 0x%02X @ %d Hz", SHT31_ADDR, I2C_MASTER_FREQ_HZ);
+
+#if SHT31_USE_PERIODIC_MODE
+    // Bật chế độ đo định kỳ một lần duy nhất
+    ret = i2c_bus_write(sht31_dev, SHT31_CMD_PERIODIC_1MPS_HIGHREP,
+                        sizeof(SHT31_CMD_PERIODIC_1MPS_HIGHREP), SHT31_I2C_TIMEOUT_MS);
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Periodic measurement started (1 mps, high repeatability)");
+    } else {
+        ESP_LOGE(TAG, "Failed to start periodic measurement: %s", esp_err_to_name(ret));
     }
+#endif
 }
 
-sht31_data_t sht31_read(void) {
-    sht31_data_t data = {0.0f, 0.0f};
+esp_err_t sht31_read_data(sht31_data_t *out) {
     uint8_t buffer[6] = {0};
+    esp_err_t err;
 
+    if (sht31_dev == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+#if SHT31_USE_PERIODIC_MODE
+    // Fetch data: ghi lệnh + repeated START + đọc 6 byte trong cùng 1 transaction
+    err = i2c_bus_write_read(sht31_dev, SHT31_CMD_FETCH_DATA, sizeof(SHT31_CMD_FETCH_DATA),
+                             buffer, sizeof(buffer), SHT31_I2C_TIMEOUT_MS);
+#else
     // Send measurement command
-    i2c_master_write_to_device(I2C_MASTER_NUM, SHT31_ADDR, SHT31_CMD_MEAS_HIGHREP, sizeof(SHT31_CMD_MEAS_HIGHREP), pdMS_TO_TICKS(100));
+    i2c_bus_write(sht31_dev, SHT31_CMD_MEAS_HIGHREP, sizeof(SHT31_CMD_MEAS_HIGHREP), 100);
     // Wait for measurement to complete (per datasheet ~15ms)
     vTaskDelay(pdMS_TO_TICKS(20));
 
     // Read 6 bytes: temp msb, temp lsb, temp CRC, hum msb, hum lsb, hum CRC
-    esp_err_t err = i2c_master_read_from_device(I2C_MASTER_NUM, SHT31_ADDR, buffer, 6, pdMS_TO_TICKS(100));
+    err = i2c_bus_read(sht31_dev, buffer, sizeof(buffer), 100);
+#endif
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "I2C read failed: %d", err);
-        return data;
+        // Periodic mode: NACK = chưa có mẫu mới kể từ lần fetch trước
+        ESP_LOGE(TAG, "I2C read failed: %s", esp_err_to_name(err));
+        return err;
     }
 
-    uint16_t temp_raw = (buffer[0] << 8) | buffer[1];
-    uint16_t hum_raw = (buffer[3] << 8) | buffer[4];
-
-    data.temperature = -45.0f + (175.0f * ((float)temp_raw / 65535.0f));
-    data.humidity = 100.0f * ((float)hum_raw / 65535.0f);
-
-    ESP_LOGI(TAG, "Temp: %.2f°C, Humidity: %.2f%%", data.temperature, data.humidity);
-
-    return data;
-}
+    err = sht31_decode(buffer, out);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "CRC mismatch, frame rejected (%02X%02X/%02X %02X%02X/%02X)",
+                 buffer[0], buffer[1], buffer[2], buffer[3], buffer[4], buffer[5]);
+        return err;
+    }
 
-float sht31_get_temperature(void) {
-    return sht31_read().temperature;
+    ESP_LOGI(TAG, "Temp: %.2f°C, Humidity: %.2f%%", out->temperature, out->humidity);
+    return ESP_OK;
 }
 
-float sht31_get_humidity(void) {
-    return sht31_read().humidity;
+sht31_data_t sht31_read(void) {
+    sht31_data_t data = {0.0f, 0.0f};
+    if (sht31_read_data(&data) != ESP_OK) {
+        data.temperature = 0.0f;
+        data.humidity = 0.0f;
+    }
+    return data;
 }
@@ -2,6 +2,11 @@
 #define SHT31_H
 
 #include <stdint.h>
+#include "esp_err.h"
+
+// Khoảng chờ giữa các lần đọc lại khi lỗi. Ở periodic mode (1 mps) sensor
+// chỉ có mẫu mới mỗi 1000ms, nên 2 lần retry phải phủ hết một chu kỳ đo.
+#define SHT31_RETRY_DELAY_MS 550
 
 typedef struct {
     float temperature;
@@ -9,8 +14,19 @@ typedef struct {
 } sht31_data_t;
 
 void sht31_init(void);
+
+/**
+ * @brief Đọc nhiệt độ/độ ẩm (periodic mode: 1 transaction fetch, không sleep)
+ * @param out Kết quả, chỉ hợp lệ khi trả về ESP_OK
+ * @return
+ *   - ESP_OK
+ *   - ESP_ERR_INVALID_CRC nếu CRC của frame sai (frame bị loại bỏ)
+ *   - ESP_ERR_INVALID_STATE nếu chưa init được bus/thiết bị
+ *   - mã lỗi I2C khác nếu sensor NACK (chưa có mẫu mới) hoặc bus lỗi
+ */
+esp_err_t sht31_read_data(sht31_data_t *out);
+
+// Legacy: trả về 0.0/0.0 khi lỗi, dùng sht31_read_data() để biết trạng thái
 sht31_data_t sht31_read(void);
-float sht31_get_temperature(void);
-float sht31_get_humidity(void);
 
 #endif
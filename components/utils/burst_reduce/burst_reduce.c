@@ -0,0 +1,150 @@
+#include "burst_reduce.h"
+
+// ==================== SORTING NETWORKS ====================
+// Batcher odd-even merge sort: thứ tự so sánh cố định, không phụ thuộc dữ liệu
+// -> thời gian mỗi burst không đổi, compiler unroll được (19 / 63 phép so sánh).
+static const uint8_t net8[][2] = {
+    {0,1},{2,3},{4,5},{6,7},{0,2},{1,3},{4,6},{5,7},{1,2},{5,6},
+    {0,4},{1,5},{2,6},{3,7},{2,4},{3,5},{1,2},{3,4},{5,6},
+};
+
+static const uint8_t net16[][2] = {
+    {0,1},{2,3},{4,5},{6,7},{8,9},{10,11},{12,13},{14,15},
+    {0,2},{1,3},{4,6},{5,7},{8,10},{9,11},{12,14},{13,15},
+    {1,2},{5,6},{9,10},{13,14},
+    {0,4},{1,5},{2,6},{3,7},{8,12},{9,13},{10,14},{11,15},
+    {2,4},{3,5},{10,12},{11,13},
+    {1,2},{3,4},{5,6},{9,10},{11,12},{13,14},
+    {0,8},{1,9},{2,10},{3,11},{4,12},{5,13},{6,14},{7,15},
+    {4,8},{5,9},{6,10},{7,11},
+    {2,4},{3,5},{6,8},{7,9},{10,12},{11,13},
+    {1,2},{3,4},{5,6},{7,8},{9,10},{11,12},{13,14},
+};
+
+static inline void cmp_swap(uint16_t *a, uint8_t i, uint8_t j)
+{
+    uint16_t x = a[i], y = a[j];
+    a[i] = (x < y) ? x : y;
+    a[j] = (x < y) ? y : x;
+}
+
+void burst_sort(uint16_t *samples, size_t n)
+{
+    if (n == 8) {
+        for (size_t k = 0; k < sizeof(net8) / sizeof(net8[0]); k++) {
+            cmp_swap(samples, net8[k][0], net8[k][1]);
+        }
+        return;
+    }
+    if (n == 16) {
+        for (size_t k = 0; k < sizeof(net16) / sizeof(net16[0]); k++) {
+            cmp_swap(samples, net16[k][0], net16[k][1]);
+        }
+        return;
+    }
+
+    // Kích thước khác: insertion sort (burst nhỏ, gần như đã sắp)
+    for (size_t i = 1; i < n; i++) {
+        uint16_t v = samples[i];
+        size_t j = i;
+        while (j > 0 && samples[j - 1] > v) {
+            samples[j] = samples[j - 1];
+            j--;
+        }
+        samples[j] = v;
+    }
+}
+
+// ==================== REDUCERS ====================
+static uint16_t mean_of(const uint16_t *samples, size_t n)
+{
+    uint32_t sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        sum += samples[i];
+    }
+    return (uint16_t)((sum + n / 2) / n);
+}
+
+// Trung vị của mảng đã sắp; n chẵn -> trung bình 2 phần tử giữa
+static uint16_t median_sorted(const uint16_t *sorted, size_t n)
+{
+    if (n & 1) {
+        return sorted[n / 2];
+    }
+    return (uint16_t)(((uint32_t)sorted[n / 2 - 1] + sorted[n / 2] + 1) / 2);
+}
+
+static uint16_t reduce_trimmed(uint16_t *samples, size_t n, uint8_t trim)
+{
+    size_t t = trim ? trim : n / 4;
+    if (2 * t >= n) {
+        t = (n - 1) / 2;
+    }
+    burst_sort(samples, n);
+    return mean_of(samples + t, n - 2 * t);
+}
+
+static uint16_t reduce_mad(uint16_t *samples, size_t n, uint8_t k)
+{
+    uint16_t dev[BURST_REDUCE_MAX_SAMPLES];
+    uint32_t limit_k = k ? k : 3;
+
+    burst_sort(samples, n);
+    uint16_t med = median_sorted(samples, n);
+
+    for (size_t i = 0; i < n; i++) {
+        dev[i] = (samples[i] > med) ? (uint16_t)(samples[i] - med) : (uint16_t)(med - samples[i]);
+    }
+    burst_sort(dev, n);
+    uint32_t mad = median_sorted(dev, n);
+
+    // MAD = 0 (hơn nửa burst trùng nhau) -> vẫn giữ nhiễu lượng tử ±1 LSB
+    uint32_t limit = (mad > 0) ? limit_k * mad : 1;
+
+    uint32_t sum = 0;
+    size_t kept = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t d = (samples[i] > med) ? (uint32_t)(samples[i] - med) : (uint32_t)(med - samples[i]);
+        if (d <= limit) {
+            sum += samples[i];
+            kept++;
+        }
+    }
+    // kept >= 1 vì chính median luôn nằm trong ngưỡng
+    return (uint16_t)((sum + kept / 2) / kept);
+}
+
+uint16_t burst_reduce(const burst_reducer_t *r, uint16_t *samples, size_t n)
+{
+    if (samples == NULL || n == 0) {
+        return 0;
+    }
+    if (n > BURST_REDUCE_MAX_SAMPLES) {
+        n = BURST_REDUCE_MAX_SAMPLES;
+    }
+
+    burst_reduce_mode_t mode = r ? r->mode : BURST_REDUCE_MEAN;
+    switch (mode) {
+        case BURST_REDUCE_TRIMMED_MEAN:
+            return reduce_trimmed(samples, n, r->trim);
+        case BURST_REDUCE_MEDIAN:
+            burst_sort(samples, n);
+            return median_sorted(samples, n);
+        case BURST_REDUCE_MAD:
+            return reduce_mad(samples, n, r->mad_k);
+        case BURST_REDUCE_MEAN:
+        default:
+            return mean_of(samples, n);
+    }
+}
+
+const char *burst_reduce_mode_name(burst_reduce_mode_t mode)
+{
+    switch (mode) {
+        case BURST_REDUCE_MEAN:         return "mean";
+        case BURST_REDUCE_TRIMMED_MEAN: return "trimmed-mean";
+        case BURST_REDUCE_MEDIAN:       return "median";
+        case BURST_REDUCE_MAD:          return "mad";
+        default:                        return "unknown";
+    }
+}
@@ -0,0 +1,59 @@
+/**
+ * @file burst_reduce.h
+ * @brief Gộp một burst mẫu ADC thành một giá trị (reducer có thể thay đổi)
+ *
+ * - MEAN: trung bình cộng (nhanh nhất, không chống spike)
+ * - TRIMMED_MEAN: bỏ `trim` mẫu nhỏ nhất và lớn nhất rồi lấy trung bình
+ * - MEDIAN: trung vị; burst 8 và 16 mẫu dùng sorting network cố định
+ * - MAD: loại mẫu có |x - median| > k * MAD rồi lấy trung bình phần còn lại
+ *
+ * Không phụ thuộc ESP-IDF (biên dịch được trong host_bench/).
+ * Mỗi kênh ADC giữ một burst_reducer_t riêng -> chọn reducer theo từng kênh.
+ */
+
+#ifndef BURST_REDUCE_H
+#define BURST_REDUCE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define BURST_REDUCE_MAX_SAMPLES 32
+
+typedef enum {
+    BURST_REDUCE_MEAN = 0,
+    BURST_REDUCE_TRIMMED_MEAN,
+    BURST_REDUCE_MEDIAN,
+    BURST_REDUCE_MAD,
+} burst_reduce_mode_t;
+
+typedef struct {
+    burst_reduce_mode_t mode;
+    uint8_t trim;    // TRIMMED_MEAN: số mẫu bỏ mỗi đầu (0 = n/4)
+    uint8_t mad_k;   // MAD: ngưỡng loại theo bội số MAD (0 = 3)
+} burst_reducer_t;
+
+// Initializer cho từng chế độ: burst_reducer_t r = BURST_REDUCER_MAD(3);
+#define BURST_REDUCER_MEAN()          { .mode = BURST_REDUCE_MEAN }
+#define BURST_REDUCER_TRIMMED(t)      { .mode = BURST_REDUCE_TRIMMED_MEAN, .trim = (t) }
+#define BURST_REDUCER_MEDIAN()        { .mode = BURST_REDUCE_MEDIAN }
+#define BURST_REDUCER_MAD(k)          { .mode = BURST_REDUCE_MAD, .mad_k = (k) }
+
+/**
+ * @brief Gộp burst thành một giá trị
+ *
+ * @param r       Reducer (NULL = MEAN)
+ * @param samples Burst; với các chế độ khác MEAN mảng sẽ bị sắp xếp tại chỗ
+ * @param n       Số mẫu (1..BURST_REDUCE_MAX_SAMPLES, thừa sẽ bị bỏ)
+ * @return Giá trị đã gộp (0 nếu n == 0)
+ */
+uint16_t burst_reduce(const burst_reducer_t *r, uint16_t *samples, size_t n);
+
+/**
+ * @brief Sắp xếp tăng dần: network cố định cho n = 8/16, insertion sort cho n khác
+ */
+void burst_sort(uint16_t *samples, size_t n);
+
+/** @brief Tên chế độ để log */
+const char *burst_reduce_mode_name(burst_reduce_mode_t mode);
+
+#endif // BURST_REDUCE_H
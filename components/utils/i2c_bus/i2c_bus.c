@@ -0,0 +1,147 @@
+/*
+ * Shared I2C bus on the i2c_master driver.
+ * Pins: SDA=PIN_SHT31_SDA, SCL=PIN_SHT31_SCL (see app_config.h)
+ *
+ * The driver itself only serializes single transactions; the recursive mutex
+ * here lets a caller keep the bus across a sequence (e.g. LCD init) and gives
+ * every component the same lock regardless of which task it runs in.
+ */
+
+#include "i2c_bus.h"
+#include "app_config.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "I2C_BUS";
+
+#define I2C_BUS_LOCK_TIMEOUT_MS  1000
+#define I2C_BUS_MAX_MULTI_BUFS   8
+
+static i2c_master_bus_handle_t bus_handle = NULL;
+static SemaphoreHandle_t bus_mutex = NULL;
+
+esp_err_t i2c_bus_init(void)
+{
+    if (bus_handle != NULL) {
+        return ESP_OK;
+    }
+
+    bus_mutex = xSemaphoreCreateRecursiveMutex();
+    if (bus_mutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    i2c_master_bus_config_t bus_cfg = {
+        .i2c_port = I2C_MASTER_NUM,
+        .sda_io_num = PIN_SHT31_SDA,
+        .scl_io_num = PIN_SHT31_SCL,
+        .clk_source = I2C_CLK_SRC_DEFAULT,
+        .glitch_ignore_cnt = 7,
+        .flags.enable_internal_pullup = true,
+    };
+    esp_err_t ret = i2c_new_master_bus(&bus_cfg, &bus_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create I2C bus: %s", esp_err_to_name(ret));
+        bus_handle = NULL;
+        vSemaphoreDelete(bus_mutex);
+        bus_mutex = NULL;
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "I2C bus ready (SDA=%d, SCL=%d, default %d Hz)",
+             PIN_SHT31_SDA, PIN_SHT31_SCL, I2C_MASTER_FREQ_HZ);
+    return ESP_OK;
+}
+
+esp_err_t i2c_bus_lock(int timeout_ms)
+{
+    if (bus_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (xSemaphoreTakeRecursive(bus_mutex, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+}
+
+void i2c_bus_unlock(void)
+{
+    if (bus_mutex != NULL) {
+        xSemaphoreGiveRecursive(bus_mutex);
+    }
+}
+
+esp_err_t i2c_bus_probe(uint8_t addr)
+{
+    esp_err_t ret = i2c_bus_lock(I2C_BUS_LOCK_TIMEOUT_MS);
+    if (ret != ESP_OK) return ret;
+    ret = i2c_master_probe(bus_handle, addr, 50);
+    i2c_bus_unlock();
+    return ret;
+}
+
+esp_err_t i2c_bus_add_device(uint8_t addr, uint32_t scl_speed_hz, i2c_bus_device_t *out)
+{
+    if (bus_handle == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    i2c_device_config_t dev_cfg = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = addr,
+        .scl_speed_hz = scl_speed_hz ? scl_speed_hz : I2C_MASTER_FREQ_HZ,
+    };
+    esp_err_t ret = i2c_master_bus_add_device(bus_handle, &dev_cfg, out);
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Device 0x%02X added (%lu Hz)", addr, (unsigned long)dev_cfg.scl_speed_hz);
+    }
+    return ret;
+}
+
+esp_err_t i2c_bus_write(i2c_bus_device_t dev, const uint8_t *data, size_t len, int timeout_ms)
+{
+    esp_err_t ret = i2c_bus_lock(I2C_BUS_LOCK_TIMEOUT_MS);
+    if (ret != ESP_OK) return ret;
+    ret = i2c_master_transmit(dev, data, len, timeout_ms);
+    i2c_bus_unlock();
+    return ret;
+}
+
+esp_err_t i2c_bus_read(i2c_bus_device_t dev, uint8_t *data, size_t len, int timeout_ms)
+{
+    esp_err_t ret = i2c_bus_lock(I2C_BUS_LOCK_TIMEOUT_MS);
+    if (ret != ESP_OK) return ret;
+    ret = i2c_master_receive(dev, data, len, timeout_ms);
+    i2c_bus_unlock();
+    return ret;
+}
+
+esp_err_t i2c_bus_write_read(i2c_bus_device_t dev, const uint8_t *wdata, size_t wlen,
+                             uint8_t *rdata, size_t rlen, int timeout_ms)
+{
+    esp_err_t ret = i2c_bus_lock(I2C_BUS_LOCK_TIMEOUT_MS);
+    if (ret != ESP_OK) return ret;
+    ret = i2c_master_transmit_receive(dev, wdata, wlen, rdata, rlen, timeout_ms);
+    i2c_bus_unlock();
+    return ret;
+}
+
+esp_err_t i2c_bus_write_multi(i2c_bus_device_t dev, const i2c_bus_buf_t *bufs, size_t count, int timeout_ms)
+{
+    if (count == 0 || count > I2C_BUS_MAX_MULTI_BUFS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    i2c_master_transmit_multi_buffer_info_t info[I2C_BUS_MAX_MULTI_BUFS];
+    for (size_t i = 0; i < count; i++) {
+        info[i].write_buffer = (uint8_t *)bufs[i].data;
+        info[i].buffer_size = bufs[i].len;
+    }
+
+    esp_err_t ret = i2c_bus_lock(I2C_BUS_LOCK_TIMEOUT_MS);
+    if (ret != ESP_OK) return ret;
+    ret = i2c_master_multi_buffer_transmit(dev, info, count, timeout_ms);
+    i2c_bus_unlock();
+    return ret;
+}
@@ -0,0 +1,66 @@
+/**
+ * @file i2c_bus.h
+ * @brief Quản lý bus I2C dùng chung (SHT31 + LCD1602) trên driver i2c_master mới
+ *
+ * - Bus được khởi tạo một lần, mỗi thiết bị có handle riêng với tốc độ SCL riêng
+ * - Mọi transaction đi qua một mutex đệ quy, nên các task không chen ngang nhau
+ * - Chuỗi nhiều transaction có thể giữ bus bằng i2c_bus_lock()/i2c_bus_unlock()
+ * - Nhiều buffer có thể gửi trong MỘT transaction bằng i2c_bus_write_multi()
+ */
+
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "driver/i2c_master.h"
+
+typedef i2c_master_dev_handle_t i2c_bus_device_t;
+
+// Một đoạn dữ liệu trong transaction ghi nhiều buffer
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+} i2c_bus_buf_t;
+
+/**
+ * @brief Khởi tạo bus (chân và tốc độ từ app_config.h). Gọi nhiều lần không sao.
+ */
+esp_err_t i2c_bus_init(void);
+
+/**
+ * @brief Kiểm tra có thiết bị ACK tại địa chỉ 7-bit hay không
+ */
+esp_err_t i2c_bus_probe(uint8_t addr);
+
+/**
+ * @brief Thêm thiết bị vào bus
+ * @param addr Địa chỉ 7-bit
+ * @param scl_speed_hz Tốc độ SCL cho thiết bị này (0 = I2C_MASTER_FREQ_HZ)
+ * @param out Handle thiết bị
+ */
+esp_err_t i2c_bus_add_device(uint8_t addr, uint32_t scl_speed_hz, i2c_bus_device_t *out);
+
+esp_err_t i2c_bus_write(i2c_bus_device_t dev, const uint8_t *data, size_t len, int timeout_ms);
+esp_err_t i2c_bus_read(i2c_bus_device_t dev, uint8_t *data, size_t len, int timeout_ms);
+
+/**
+ * @brief Ghi rồi đọc với repeated START (một transaction)
+ */
+esp_err_t i2c_bus_write_read(i2c_bus_device_t dev, const uint8_t *wdata, size_t wlen,
+                             uint8_t *rdata, size_t rlen, int timeout_ms);
+
+/**
+ * @brief Ghi nhiều buffer liên tiếp trong MỘT transaction (1 START, 1 STOP)
+ */
+esp_err_t i2c_bus_write_multi(i2c_bus_device_t dev, const i2c_bus_buf_t *bufs, size_t count, int timeout_ms);
+
+/**
+ * @brief Giữ bus cho một chuỗi transaction (đệ quy, có thể lồng nhau)
+ * @return ESP_OK, hoặc ESP_ERR_TIMEOUT nếu không lấy được bus
+ */
+esp_err_t i2c_bus_lock(int timeout_ms);
+void i2c_bus_unlock(void);
+
+#endif // I2C_BUS_H
@@ -1,23 +1,193 @@
 #include "moving_average.h"
 #include <string.h>
 
-void ma_init(moving_average_t *ma, int size) {
-    if (size > 16) size = 16;
-    ma->size = size;
-    ma->index = 0;
-    ma->count = 0;
-    memset(ma->buffer, 0, sizeof(ma->buffer));
+// ==================== RUNNING-SUM RING BUFFER ====================
+// RESYNC = 1: cộng lại toàn bộ buffer mỗi lần index quay về 0 (chỉ cần cho
+// kiểu dấu phẩy động; chi phí O(N) mỗi N lần add -> vẫn O(1) khấu hao)
+#define MA_RING_DEFINE(SUFFIX, T, ACC_T, RESYNC)                                    \
+    void ma_##SUFFIX##_init(ma_##SUFFIX##_t *ma, T *storage, uint16_t size) {       \
+        ma->buf = storage;                                                          \
+        ma->size = (size > 0) ? size : 1;                                           \
+        ma_##SUFFIX##_reset(ma);                                                    \
+    }                                                                               \
+    void ma_##SUFFIX##_reset(ma_##SUFFIX##_t *ma) {                                 \
+        ma->sum = 0;                                                                \
+        ma->index = 0;                                                              \
+        ma->count = 0;                                                              \
+    }                                                                               \
+    void ma_##SUFFIX##_add(ma_##SUFFIX##_t *ma, T value) {                          \
+        if (ma->count == ma->size) {                                                \
+            ma->sum -= ma->buf[ma->index];                                          \
+        } else {                                                                    \
+            ma->count++;                                                            \
+        }                                                                           \
+        ma->buf[ma->index] = value;                                                 \
+        ma->sum += value;                                                           \
+        if (++ma->index == ma->size) {                                              \
+            ma->index = 0;                                                          \
+            if (RESYNC) {                                                           \
+                ACC_T s = 0;                                                        \
+                for (uint16_t i = 0; i < ma->count; i++) s += ma->buf[i];           \
+                ma->sum = s;                                                        \
+            }                                                                       \
+        }                                                                           \
+    }                                                                               \
+    float ma_##SUFFIX##_get(const ma_##SUFFIX##_t *ma) {                            \
+        if (ma->count == 0) return 0.0f;                                            \
+        return (float)ma->sum / (float)ma->count;                                   \
+    }                                                                               \
+    T ma_##SUFFIX##_recent(const ma_##SUFFIX##_t *ma, uint16_t age) {               \
+        if (age >= ma->count) return 0;                                             \
+        uint16_t i = (uint16_t)((ma->index + ma->size - 1 - age) % ma->size);       \
+        return ma->buf[i];                                                          \
+    }
+
+MA_RING_DEFINE(f32, float, float, 1)
+MA_RING_DEFINE(i16, int16_t, int32_t, 0)
+
+// ==================== SLIDING MEDIAN ====================
+// sorted[] luôn có count phần tử tăng dần. Khi đầy: xóa phần tử sắp rời window
+// rồi chèn phần tử mới, cả hai bằng binary search + memmove.
+#define MEDIAN_DEFINE(SUFFIX, T)                                                    \
+    static uint16_t median_##SUFFIX##_lower_bound(const T *a, uint16_t n, T v) {    \
+        uint16_t lo = 0, hi = n;                                                    \
+        while (lo < hi) {                                                           \
+            uint16_t mid = (uint16_t)((lo + hi) / 2);                               \
+            if (a[mid] < v) lo = (uint16_t)(mid + 1);                               \
+            else hi = mid;                                                          \
+        }                                                                           \
+        return lo;                                                                  \
+    }                                                                               \
+    void median_##SUFFIX##_init(median_##SUFFIX##_t *m, T *ring_storage,            \
+                                T *sorted_storage, uint16_t size) {                 \
+        m->ring = ring_storage;                                                     \
+        m->sorted = sorted_storage;                                                 \
+        m->size = (size > 0) ? size : 1;                                            \
+        median_##SUFFIX##_reset(m);                                                 \
+    }                                                                               \
+    void median_##SUFFIX##_reset(median_##SUFFIX##_t *m) {                          \
+        m->index = 0;                                                               \
+        m->count = 0;                                                               \
+    }                                                                               \
+    void median_##SUFFIX##_add(median_##SUFFIX##_t *m, T value) {                   \
+        if (m->count == m->size) {                                                  \
+            T old = m->ring[m->index];                                              \
+            uint16_t pos = median_##SUFFIX##_lower_bound(m->sorted, m->count, old); \
+            memmove(&m->sorted[pos], &m->sorted[pos + 1],                           \
+                    (size_t)(m->count - pos - 1) * sizeof(T));                      \
+            m->count--;                                                             \
+        }                                                                           \
+        uint16_t pos = median_##SUFFIX##_lower_bound(m->sorted, m->count, value);   \
+        memmove(&m->sorted[pos + 1], &m->sorted[pos],                               \
+                (size_t)(m->count - pos) * sizeof(T));                              \
+        m->sorted[pos] = value;                                                     \
+        m->count++;                                                                 \
+        m->ring[m->index] = value;                                                  \
+        m->index = (uint16_t)((m->index + 1) % m->size);                            \
+    }                                                                               \
+    T median_##SUFFIX##_get(const median_##SUFFIX##_t *m) {                         \
+        if (m->count == 0) return 0;                                                \
+        return m->sorted[m->count / 2];                                             \
+    }
+
+MEDIAN_DEFINE(f32, float)
+MEDIAN_DEFINE(i16, int16_t)
+
+// ==================== SLIDING MIN / MAX ====================
+// Mỗi deque là ring size phần tử (head + len). Phần tử ở front hết hạn khi
+// seq của nó đã ra khỏi window (seq_now - seq >= size).
+#define MINMAX_DEFINE(SUFFIX, T)                                                    \
+    void minmax_##SUFFIX##_init(minmax_##SUFFIX##_t *mm,                            \
+                                minmax_##SUFFIX##_entry_t *storage, uint16_t size) {\
+        mm->size = (size > 0) ? size : 1;                                           \
+        mm->max_q = storage;                                                        \
+        mm->min_q = storage + mm->size;                                             \
+        minmax_##SUFFIX##_reset(mm);                                                \
+    }                                                                               \
+    void minmax_##SUFFIX##_reset(minmax_##SUFFIX##_t *mm) {                         \
+        mm->max_head = mm->max_len = 0;                                             \
+        mm->min_head = mm->min_len = 0;                                             \
+        mm->seq = 0;                                                                \
+    }                                                                               \
+    void minmax_##SUFFIX##_add(minmax_##SUFFIX##_t *mm, T value) {                  \
+        uint32_t seq = mm->seq++;                                                   \
+        uint16_t n = mm->size;                                                      \
+        /* Max deque: bỏ phía sau các phần tử <= value */                           \
+        while (mm->max_len > 0 &&                                                   \
+               mm->max_q[(mm->max_head + mm->max_len - 1) % n].value <= value) {    \
+            mm->max_len--;                                                          \
+        }                                                                           \
+        if (mm->max_len > 0 && seq - mm->max_q[mm->max_head].seq >= n) {            \
+            mm->max_head = (uint16_t)((mm->max_head + 1) % n);                      \
+            mm->max_len--;                                                          \
+        }                                                                           \
+        mm->max_q[(mm->max_head + mm->max_len) % n] =                               \
+            (minmax_##SUFFIX##_entry_t){ .value = value, .seq = seq };              \
+        mm->max_len++;                                                              \
+        /* Min deque: bỏ phía sau các phần tử >= value */                           \
+        while (mm->min_len > 0 &&                                                   \
+               mm->min_q[(mm->min_head + mm->min_len - 1) % n].value >= value) {    \
+            mm->min_len--;                                                          \
+        }                                                                           \
+        if (mm->min_len > 0 && seq - mm->min_q[mm->min_head].seq >= n) {            \
+            mm->min_head = (uint16_t)((mm->min_head + 1) % n);                      \
+            mm->min_len--;                                                          \
+        }                                                                           \
+        mm->min_q[(mm->min_head + mm->min_len) % n] =                               \
+            (minmax_##SUFFIX##_entry_t){ .value = value, .seq = seq };              \
+        mm->min_len++;                                                              \
+    }                                                                               \
+    T minmax_##SUFFIX##_min(const minmax_##SUFFIX##_t *mm) {                        \
+        return (mm->min_len > 0) ? mm->min_q[mm->min_head].value : 0;               \
+    }                                                                               \
+    T minmax_##SUFFIX##_max(const minmax_##SUFFIX##_t *mm) {                        \
+        return (mm->max_len > 0) ? mm->max_q[mm->max_head].value : 0;               \
+    }
+
+MINMAX_DEFINE(f32, float)
+MINMAX_DEFINE(i16, int16_t)
+
+// ==================== EWMA ====================
+void ewma_f32_init(ewma_f32_t *e, float alpha) {
+    if (alpha <= 0.0f) alpha = 0.0f;
+    if (alpha > 1.0f) alpha = 1.0f;
+    e->alpha = alpha;
+    e->value = 0.0f;
+    e->primed = false;
+}
+
+void ewma_f32_seed(ewma_f32_t *e, float value) {
+    e->value = value;
+    e->primed = true;
+}
+
+float ewma_f32_add(ewma_f32_t *e, float value) {
+    if (!e->primed) {
+        ewma_f32_seed(e, value);
+    } else {
+        e->value += e->alpha * (value - e->value);
+    }
+    return e->value;
+}
+
+void ewma_i16_init(ewma_i16_t *e, uint8_t shift) {
+    e->shift = (shift > 15) ? 15 : shift;
+    e->acc_q8 = 0;
+    e->primed = false;
 }
 
-void ma_add(moving_average_t *ma, float value) {
-    ma->buffer[ma->index] = value;
-    ma->index = (ma->index + 1) % ma->size;
-    if (ma->count < ma->size) ma->count++;
+void ewma_i16_seed(ewma_i16_t *e, int16_t value) {
+    e->acc_q8 = (int32_t)value * 256;
+    e->primed = true;
 }
 
-float ma_get(moving_average_t *ma) {
-    if (ma->count == 0) return 0.0f;
-    float sum = 0.0f;
-    for (int i = 0; i < ma->count; i++) sum += ma->buffer[i];
-    return sum / ma->count;
+int16_t ewma_i16_add(ewma_i16_t *e, int16_t value) {
+    if (!e->primed) {
+        ewma_i16_seed(e, value);
+    } else {
+        e->acc_q8 += ((int32_t)value * 256 - e->acc_q8) / (1 << e->shift);
+    }
+    // Làm tròn về số nguyên gần nhất
+    int32_t q = e->acc_q8;
+    return (int16_t)((q >= 0) ? (q + 128) / 256 : (q - 128) / 256);
 }
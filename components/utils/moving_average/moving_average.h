@@ -2,16 +2,108 @@
 #define MOVING_AVERAGE_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
+// ==================== FILTER LIBRARY ====================
+// Tất cả filter đều cập nhật O(1) (median: O(log N) tìm + memmove N phần tử nhỏ)
+// và dùng bộ nhớ do caller cấp -> kích thước window tùy ý, không malloc.
+//
+// Mỗi filter được "chuyên biệt hóa" theo kiểu phần tử bằng macro *_DECLARE
+// (header) + *_DEFINE (moving_average.c). Các biến thể có sẵn:
+//   ma_f32 / ma_i16         - running-sum ring buffer (mean)
+//   median_f32 / median_i16 - sliding median
+//   minmax_f32 / minmax_i16 - sliding min/max (monotonic deque)
+//   ewma_f32 / ewma_i16     - exponential moving average (i16: fixed-point)
+
+// ==================== RUNNING-SUM RING BUFFER ====================
+// add(): trừ phần tử cũ, cộng phần tử mới -> get() không cần cộng lại buffer.
+// Với float, sum được tính lại mỗi khi index quay vòng để tránh tích lũy sai số.
+#define MA_RING_DECLARE(SUFFIX, T, ACC_T)                                           \
+    typedef struct {                                                                \
+        T *buf;                                                                     \
+        ACC_T sum;                                                                  \
+        uint16_t size;                                                              \
+        uint16_t index;                                                             \
+        uint16_t count;                                                             \
+    } ma_##SUFFIX##_t;                                                              \
+    void ma_##SUFFIX##_init(ma_##SUFFIX##_t *ma, T *storage, uint16_t size);        \
+    void ma_##SUFFIX##_reset(ma_##SUFFIX##_t *ma);                                  \
+    void ma_##SUFFIX##_add(ma_##SUFFIX##_t *ma, T value);                           \
+    float ma_##SUFFIX##_get(const ma_##SUFFIX##_t *ma);                             \
+    /* age = 0 là phần tử mới nhất; age phải < count */                             \
+    T ma_##SUFFIX##_recent(const ma_##SUFFIX##_t *ma, uint16_t age);
+
+MA_RING_DECLARE(f32, float, float)
+MA_RING_DECLARE(i16, int16_t, int32_t)
+
+// ==================== SLIDING MEDIAN ====================
+// Giữ song song ring (thứ tự thời gian) và mảng đã sắp xếp (cùng kích thước).
+// Số phần tử chẵn -> trả về median trên (bảo thủ cho mức ô nhiễm).
+#define MEDIAN_DECLARE(SUFFIX, T)                                                   \
+    typedef struct {                                                                \
+        T *ring;                                                                    \
+        T *sorted;                                                                  \
+        uint16_t size;                                                              \
+        uint16_t index;                                                             \
+        uint16_t count;                                                             \
+    } median_##SUFFIX##_t;                                                          \
+    /* ring_storage và sorted_storage: mỗi mảng >= size phần tử */                  \
+    void median_##SUFFIX##_init(median_##SUFFIX##_t *m, T *ring_storage,            \
+                                T *sorted_storage, uint16_t size);                  \
+    void median_##SUFFIX##_reset(median_##SUFFIX##_t *m);                           \
+    void median_##SUFFIX##_add(median_##SUFFIX##_t *m, T value);                    \
+    T median_##SUFFIX##_get(const median_##SUFFIX##_t *m);
+
+MEDIAN_DECLARE(f32, float)
+MEDIAN_DECLARE(i16, int16_t)
+
+// ==================== SLIDING MIN / MAX ====================
+// Hai monotonic deque (max giảm dần, min tăng dần) -> add() O(1) khấu hao,
+// min()/max() O(1). Storage: 2 * size phần tử minmax_<T>_entry_t.
+#define MINMAX_DECLARE(SUFFIX, T)                                                   \
+    typedef struct {                                                                \
+        T value;                                                                    \
+        uint32_t seq;                                                               \
+    } minmax_##SUFFIX##_entry_t;                                                    \
+    typedef struct {                                                                \
+        minmax_##SUFFIX##_entry_t *max_q;                                           \
+        minmax_##SUFFIX##_entry_t *min_q;                                           \
+        uint16_t size;                                                              \
+        uint16_t max_head, max_len;                                                 \
+        uint16_t min_head, min_len;                                                 \
+        uint32_t seq;                                                               \
+    } minmax_##SUFFIX##_t;                                                          \
+    void minmax_##SUFFIX##_init(minmax_##SUFFIX##_t *mm,                            \
+                                minmax_##SUFFIX##_entry_t *storage, uint16_t size); \
+    void minmax_##SUFFIX##_reset(minmax_##SUFFIX##_t *mm);                          \
+    void minmax_##SUFFIX##_add(minmax_##SUFFIX##_t *mm, T value);                   \
+    T minmax_##SUFFIX##_min(const minmax_##SUFFIX##_t *mm);                         \
+    T minmax_##SUFFIX##_max(const minmax_##SUFFIX##_t *mm);
+
+MINMAX_DECLARE(f32, float)
+MINMAX_DECLARE(i16, int16_t)
+
+// ==================== EWMA ====================
+// y = alpha * x + (1 - alpha) * y. Mẫu đầu tiên khởi tạo y nếu chưa seed.
 typedef struct {
-    float buffer[16];
-    int size;
-    int index;
-    int count;
-} moving_average_t;
-
-void ma_init(moving_average_t *ma, int size);
-void ma_add(moving_average_t *ma, float value);
-float ma_get(moving_average_t *ma);
+    float alpha;
+    float value;
+    bool primed;
+} ewma_f32_t;
+
+void ewma_f32_init(ewma_f32_t *e, float alpha);
+void ewma_f32_seed(ewma_f32_t *e, float value);
+float ewma_f32_add(ewma_f32_t *e, float value);
+
+// Fixed-point: alpha = 1 / 2^shift, trạng thái Q8 trong int32 (không dùng FPU)
+typedef struct {
+    int32_t acc_q8;
+    uint8_t shift;
+    bool primed;
+} ewma_i16_t;
+
+void ewma_i16_init(ewma_i16_t *e, uint8_t shift);
+void ewma_i16_seed(ewma_i16_t *e, int16_t value);
+int16_t ewma_i16_add(ewma_i16_t *e, int16_t value);
 
 #endif
@@ -0,0 +1,79 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_CYCLES 1
+#else
+#define BENCH_HAVE_CYCLES 0
+#endif
+
+// ==================== HOST BENCH HELPERS ====================
+// Đồng hồ monotonic + "sink" để compiler không loại bỏ vòng lặp đo.
+// Số lần cấp phát heap được đếm bằng cách thay malloc/calloc/realloc
+// (bench_alloc.c, chỉ trên glibc) -> báo cáo ns/op và allocs/op.
+
+/** @brief Tổng số lần malloc/calloc/realloc kể từ khi chạy, -1 nếu không đếm được */
+int64_t bench_alloc_count(void);
+
+static inline uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Bộ đếm chu kỳ CPU (TSC trên x86), 0 nếu không hỗ trợ
+static inline uint64_t bench_cycles(void)
+{
+#if BENCH_HAVE_CYCLES
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static volatile float bench_sink_f;
+static volatile uint32_t bench_sink_u;
+
+static inline void bench_consume_u(uint32_t v)
+{
+    bench_sink_u = v;
+}
+
+static inline void bench_consume_f(float v)
+{
+    bench_sink_f = v;
+}
+
+static inline void bench_report(const char *name, uint64_t elapsed_ns, uint64_t ops, int64_t allocs)
+{
+    if (allocs < 0) {
+        printf("%-30s %10.2f ns/op  %8s allocs/op  (%llu ops)\n", name,
+               (double)elapsed_ns / (double)ops, "n/a", (unsigned long long)ops);
+    } else {
+        printf("%-30s %10.2f ns/op  %8.2f allocs/op  (%llu ops)\n", name,
+               (double)elapsed_ns / (double)ops, (double)allocs / (double)ops,
+               (unsigned long long)ops);
+    }
+}
+
+// Đo `body` lặp `ops` lần; trong body dùng bench_i (0..ops-1) làm chỉ số
+#define BENCH_RUN(name, ops, ...)                                               \
+    do {                                                                        \
+        const uint64_t bench_ops = (ops);                                       \
+        int64_t bench_a0 = bench_alloc_count();                                 \
+        uint64_t bench_t0 = bench_now_ns();                                     \
+        for (uint64_t bench_i = 0; bench_i < bench_ops; bench_i++) {            \
+            __VA_ARGS__;                                                        \
+        }                                                                       \
+        uint64_t bench_ns = bench_now_ns() - bench_t0;                          \
+        int64_t bench_a1 = bench_alloc_count();                                 \
+        bench_report((name), bench_ns, bench_ops,                               \
+                     (bench_a0 < 0) ? -1 : (bench_a1 - bench_a0));              \
+    } while (0)
+
+#endif // BENCH_H
@@ -0,0 +1,49 @@
+// Đếm cấp phát heap: thay malloc/calloc/realloc của glibc bằng bản có đếm
+#include "bench.h"
+#include <stddef.h>
+
+#if defined(__GLIBC__)
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+static uint64_t alloc_count;
+
+void *malloc(size_t size)
+{
+    alloc_count++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size)
+{
+    alloc_count++;
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    alloc_count++;
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr)
+{
+    __libc_free(ptr);
+}
+
+int64_t bench_alloc_count(void)
+{
+    return (int64_t)alloc_count;
+}
+
+#else
+
+int64_t bench_alloc_count(void)
+{
+    return -1;
+}
+
+#endif
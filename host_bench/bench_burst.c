@@ -0,0 +1,98 @@
+// Benchmark: reducer gộp burst ADC - chi phí mỗi burst và độ chống nhiễu
+#include "bench.h"
+#include "burst_reduce.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BURSTS        20000
+#define TRUE_CODE     1500     // Giá trị ADC "thật"
+#define NOISE_SIGMA   8.0      // Nhiễu Gauss (LSB)
+#define SPIKE_PERCENT 5        // % mẫu bị spike (relay, WiFi TX...)
+#define SPIKE_AMPL    400
+
+static uint32_t rng_state = 12345;
+
+static uint32_t rng_next(void)
+{
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return rng_state >> 8;
+}
+
+static double rng_gauss(void)
+{
+    double u1 = ((rng_next() & 0xFFFFFF) + 1.0) / 16777217.0;
+    double u2 = (rng_next() & 0xFFFFFF) / 16777216.0;
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+static uint16_t sample(void)
+{
+    double v = TRUE_CODE + NOISE_SIGMA * rng_gauss();
+    if ((int)(rng_next() % 100) < SPIKE_PERCENT) {
+        v += (rng_next() & 1) ? SPIKE_AMPL : -SPIKE_AMPL;
+    }
+    if (v < 0) v = 0;
+    if (v > 4095) v = 4095;
+    return (uint16_t)lround(v);
+}
+
+static void run(const char *label, const burst_reducer_t *r, size_t n,
+                uint16_t (*bursts)[BURST_REDUCE_MAX_SAMPLES])
+{
+    uint16_t work[BURST_REDUCE_MAX_SAMPLES];
+    double sq_err = 0.0;
+    uint32_t acc = 0;
+
+    int64_t a0 = bench_alloc_count();
+    uint64_t c0 = bench_cycles();
+    uint64_t t0 = bench_now_ns();
+    for (int b = 0; b < BURSTS; b++) {
+        memcpy(work, bursts[b], n * sizeof(uint16_t));
+        acc += burst_reduce(r, work, n);
+    }
+    uint64_t ns = bench_now_ns() - t0;
+    uint64_t cycles = bench_cycles() - c0;
+    int64_t allocs = bench_alloc_count() - a0;
+    bench_consume_u(acc);
+
+    for (int b = 0; b < BURSTS; b++) {
+        memcpy(work, bursts[b], n * sizeof(uint16_t));
+        double e = (double)burst_reduce(r, work, n) - TRUE_CODE;
+        sq_err += e * e;
+    }
+
+    printf("%-14s n=%-2zu %8.1f ns/burst %8.0f cycles/burst %5.2f allocs/burst   RMSE %6.2f LSB\n",
+           label, n, (double)ns / BURSTS, (double)cycles / BURSTS,
+           (a0 < 0) ? 0.0 : (double)allocs / BURSTS, sqrt(sq_err / BURSTS));
+}
+
+int main(void)
+{
+    static uint16_t bursts[BURSTS][BURST_REDUCE_MAX_SAMPLES];
+    for (int b = 0; b < BURSTS; b++) {
+        for (int i = 0; i < BURST_REDUCE_MAX_SAMPLES; i++) {
+            bursts[b][i] = sample();
+        }
+    }
+
+    const burst_reducer_t mean = BURST_REDUCER_MEAN();
+    const burst_reducer_t trimmed = BURST_REDUCER_TRIMMED(0);
+    const burst_reducer_t median = BURST_REDUCER_MEDIAN();
+    const burst_reducer_t mad = BURST_REDUCER_MAD(3);
+
+    printf("== Burst reducers (sigma=%.0f LSB, %d%% spikes of +/-%d) ==\n",
+           NOISE_SIGMA, SPIKE_PERCENT, SPIKE_AMPL);
+    if (!BENCH_HAVE_CYCLES) {
+        printf("(cycle counter not available on this host)\n");
+    }
+    run("mean (old)", &mean, 20, bursts);
+    const size_t sizes[] = { 8, 16 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        run("mean", &mean, sizes[s], bursts);
+        run("trimmed-mean", &trimmed, sizes[s], bursts);
+        run("median", &median, sizes[s], bursts);
+        run("mad k=3", &mad, sizes[s], bursts);
+    }
+    return 0;
+}
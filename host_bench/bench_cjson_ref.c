@@ -0,0 +1,33 @@
+// Bản parse lệnh MQTT cũ dùng cJSON (trước khi đổi sang tokenizer trong
+// mqtt_command.c) - chỉ dùng làm mốc so sánh tốc độ / allocs và kết quả.
+#include "mqtt_payload.h"
+#include "cJSON.h"
+#include <string.h>
+
+bool mqtt_command_parse_cjson(const char *data, size_t len, mqtt_command_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (data == NULL) {
+        return false;
+    }
+
+    cJSON *root = cJSON_ParseWithLength(data, len);
+    if (root == NULL) {
+        return false;
+    }
+
+    cJSON *state_item = cJSON_GetObjectItem(root, "state");
+    if (state_item && cJSON_IsString(state_item)) {
+        strncpy(out->state, state_item->valuestring, sizeof(out->state) - 1);
+        out->has_state = true;
+    }
+
+    cJSON *level_item = cJSON_GetObjectItem(root, "level");
+    if (level_item && cJSON_IsNumber(level_item)) {
+        out->level = level_item->valueint;
+        out->has_level = true;
+    }
+
+    cJSON_Delete(root);
+    return true;
+}
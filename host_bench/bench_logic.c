@@ -0,0 +1,323 @@
+// Benchmark: logic thuần của firmware - filter, bảng luật actuator, payload MQTT, buzzer
+#include "bench.h"
+#include "moving_average.h"
+#include "control_rules.h"
+#include "mqtt_payload.h"
+#include "mqtt_policy.h"
+#include "mqtt_router.h"
+#include "mqtt_reassembly.h"
+#include "buzzer_request.h"
+#include <string.h>
+
+#if BENCH_HAVE_CJSON
+// bench_cjson_ref.c: parser cũ dùng cJSON
+bool mqtt_command_parse_cjson(const char *data, size_t len, mqtt_command_t *out);
+#endif
+
+#define OPS 1000000
+
+static void bench_filters(void)
+{
+    static float f32_buf[10];
+    static int16_t ring_buf[9], sorted_buf[9];
+    static minmax_f32_entry_t mm_buf[2 * 16];
+    ma_f32_t ma;
+    median_i16_t med;
+    minmax_f32_t mm;
+    ewma_f32_t ewma;
+    ewma_i16_t ewma_q;
+    float acc = 0.0f;
+
+    printf("-- moving_average --\n");
+    ma_f32_init(&ma, f32_buf, 10);
+    BENCH_RUN("ma_f32 add+get (N=10)", OPS, {
+        ma_f32_add(&ma, (float)(bench_i & 63) * 0.5f);
+        acc += ma_f32_get(&ma);
+    });
+
+    median_i16_init(&med, ring_buf, sorted_buf, 9);
+    BENCH_RUN("median_i16 add+get (N=9)", OPS, {
+        median_i16_add(&med, (int16_t)((bench_i * 7) % 5));
+        acc += median_i16_get(&med);
+    });
+
+    minmax_f32_init(&mm, mm_buf, 16);
+    BENCH_RUN("minmax_f32 add+min+max (N=16)", OPS, {
+        minmax_f32_add(&mm, (float)((bench_i * 37) % 101));
+        acc += minmax_f32_max(&mm) - minmax_f32_min(&mm);
+    });
+
+    ewma_f32_init(&ewma, 0.3f);
+    BENCH_RUN("ewma_f32 add", OPS, acc += ewma_f32_add(&ewma, (float)(bench_i & 1023)));
+
+    ewma_i16_init(&ewma_q, 3);
+    BENCH_RUN("ewma_i16 add (Q8)", OPS, acc += ewma_i16_add(&ewma_q, (int16_t)(bench_i & 1023)));
+    bench_consume_f(acc);
+}
+
+static void bench_control(void)
+{
+    uint32_t acc = 0;
+    control_rules_t rs;
+    uint8_t levels[CTRL_ACT_COUNT];
+
+    printf("-- control_rules --\n");
+    control_rules_load_defaults(&rs);
+    // Nhiệt độ quét 20-35°C, AQ 0-4 để đi qua mọi nhánh hysteresis
+    BENCH_RUN("eval default table (9 rules)", OPS, {
+        float in[CTRL_CH_COUNT] = {
+            [CTRL_CH_TEMP] = 20.0f + (float)(bench_i % 150) * 0.1f,
+            [CTRL_CH_AQ] = (float)(bench_i % 5),
+        };
+        control_rules_eval(&rs, in, (bench_i % 16) ? 0x1F : 0x10, levels);
+        acc += levels[CTRL_ACT_FAN] + levels[CTRL_ACT_LED] + levels[CTRL_ACT_BUZZER];
+    });
+
+    control_rules_t full = { .count = CONTROL_RULES_MAX };
+    for (int i = 0; i < CONTROL_RULES_MAX; i++) {
+        full.rules[i] = (control_rule_t){ .channel = (uint8_t)(i % CTRL_CH_COUNT), .op = (uint8_t)(i & 1),
+                                          .actuator = (uint8_t)(i % CTRL_ACT_COUNT), .level = 1,
+                                          .on = (float)i, .off = (float)i };
+    }
+    BENCH_RUN("eval full table (32 rules)", OPS, {
+        float x = (float)(bench_i % 40);
+        float in[CTRL_CH_COUNT] = { x, x, x, x, x };
+        control_rules_eval(&full, in, 0x1F, levels);
+        acc += levels[CTRL_ACT_FAN];
+    });
+
+    static const char table[] =
+        "fan=1 temp>=25/24 hold; fan=2 temp>=30/29 hold\n"
+        "led=1 aq>=1 hold; led=2 aq>=2 hold; led=3 aq>=3 hold; led=4 aq>=4 hold\n"
+        "buzzer=1 aq>=2 hold; buzzer=2 aq>=3 hold; buzzer=3 aq>=4 hold\n";
+    control_rules_error_t err;
+    BENCH_RUN("parse rule text (9 rules)", OPS / 10, {
+        acc += control_rules_parse(table, sizeof(table) - 1, &rs, &err);
+    });
+    control_rules_t defaults;
+    control_rules_load_defaults(&defaults);
+    printf("%-30s %s\n", "  text == defaults",
+           (rs.count == defaults.count && memcmp(rs.rules, defaults.rules, rs.count * sizeof(control_rule_t)) == 0)
+               ? "yes" : "NO");
+    bench_consume_u(acc);
+}
+
+static void bench_payload(void)
+{
+    char buf[MQTT_PAYLOAD_MAX];
+    uint32_t acc = 0;
+
+    printf("-- mqtt_payload --\n");
+    BENCH_RUN("format value", OPS,
+              acc += (uint32_t)mqtt_payload_value(buf, sizeof(buf), 20.0f + (float)(bench_i & 255) * 0.01f));
+    BENCH_RUN("format actuator", OPS,
+              acc += (uint32_t)mqtt_payload_actuator(buf, sizeof(buf), (bench_i & 1) ? "ON" : "OFF",
+                                                     (int)(bench_i % 5)));
+    BENCH_RUN("format reported", OPS,
+              acc += (uint32_t)mqtt_payload_reported(buf, sizeof(buf), "ON", (int)(bench_i % 5), true));
+
+    char tbuf[MQTT_TELEMETRY_MAX];
+    mqtt_telemetry_t t = {
+        .valid = 7, .temperature = 26.4f, .humidity = 61.2f, .ppm = 655.0f, .mq_raw = 870,
+        .air_level = 1, .auto_mode = true, .has_actuators = true,
+        .fan = { true, 1 }, .led = { true, 1 }, .buzzer = { false, 0 },
+    };
+    BENCH_RUN("format telemetry (1 msg/cycle)", OPS, {
+        t.seq = (uint32_t)bench_i;
+        t.uptime_ms = (int64_t)bench_i * 5000;
+        acc += (uint32_t)mqtt_payload_telemetry(tbuf, sizeof(tbuf), &t);
+    });
+    uint8_t bbuf[MQTT_TELEMETRY_BIN_MAX];
+    BENCH_RUN("encode telemetry (binary v1)", OPS, {
+        t.seq = (uint32_t)bench_i;
+        t.uptime_ms = (int64_t)bench_i * 5000;
+        acc += (uint32_t)mqtt_payload_telemetry_bin(bbuf, sizeof(bbuf), &t);
+    });
+    printf("%-30s JSON %d bytes, binary %d bytes\n", "telemetry size",
+           mqtt_payload_telemetry(tbuf, sizeof(tbuf), &t), mqtt_payload_telemetry_bin(bbuf, sizeof(bbuf), &t));
+    bench_consume_u(acc);
+
+    static const char cmd_json[] = "{\"state\":\"ON\",\"level\":2}";
+    mqtt_command_t cmd;
+    BENCH_RUN("parse command (tokenizer)", OPS, {
+        mqtt_command_parse(cmd_json, sizeof(cmd_json) - 1, &cmd);
+        acc += (uint32_t)cmd.level;
+    });
+    bench_consume_u(acc);
+
+#if BENCH_HAVE_CJSON
+    BENCH_RUN("parse command (cJSON)", OPS, {
+        mqtt_command_parse_cjson(cmd_json, sizeof(cmd_json) - 1, &cmd);
+        acc += (uint32_t)cmd.level;
+    });
+    bench_consume_u(acc);
+
+    // Hai parser phải cho cùng kết quả
+    static const char *const samples[] = {
+        "{\"state\":\"ON\",\"level\":2}", "{\"state\":\"OFF\"}", " { \"level\" : -1.9 } ",
+        "{\"state\":\"O\\u004E\",\"x\":[1,{\"y\":null}],\"level\":1e1}", "{\"state\":1,\"level\":\"2\"}",
+        "{}", "{\"state\":\"ON\"", "{\"state\":\"ON\",}", "[1,2]", "",
+    };
+    int mismatches = 0;
+    for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++) {
+        mqtt_command_t a, b;
+        bool ok_a = mqtt_command_parse(samples[i], strlen(samples[i]), &a);
+        bool ok_b = mqtt_command_parse_cjson(samples[i], strlen(samples[i]), &b);
+        if (ok_a != ok_b || (ok_a && (a.has_state != b.has_state || strcmp(a.state, b.state) != 0 ||
+                                      a.has_level != b.has_level || a.level != b.level))) {
+            printf("  mismatch: %s (tokenizer %d, cJSON %d)\n", samples[i], ok_a, ok_b);
+            mismatches++;
+        }
+    }
+    printf("%-30s %d/%zu samples differ from cJSON\n", "parse agreement", mismatches,
+           sizeof(samples) / sizeof(samples[0]));
+#else
+    printf("%-30s skipped (cJSON not found, set -DCJSON_DIR=...)\n", "parse command (cJSON)");
+#endif
+}
+
+static void bench_policy(void)
+{
+    const mqtt_policy_cfg_t cfg = { .abs_deadband = 0.1f, .heartbeat_ms = 60000 };
+    mqtt_policy_stream_t streams[9];
+    mqtt_policy_stats_t stats = { 0 };
+    float values[9] = { 0 };
+    uint32_t acc = 0;
+
+    for (int i = 0; i < 9; i++) {
+        mqtt_policy_init(&streams[i], &cfg);
+    }
+
+    printf("-- mqtt_policy --\n");
+    // Nhiệt độ trôi chậm 0.01°C/chu kỳ, chu kỳ 5 s
+    BENCH_RUN("group decision (9 channels)", OPS, {
+        values[0] = 25.0f + (float)(bench_i % 1000) * 0.01f;
+        acc += mqtt_policy_group_should_send(streams, values, 9, (int64_t)bench_i * 5000, &stats);
+    });
+    bench_consume_u(acc);
+    printf("%-30s sent=%u suppressed=%u (%.1fx fewer messages)\n", "  slow drift, 5 s cycle",
+           stats.sent, stats.suppressed,
+           (double)(stats.sent + stats.suppressed) / (double)(stats.sent ? stats.sent : 1));
+}
+
+static void route_count(const char *data, size_t data_len, void *ctx)
+{
+    (void) data;
+    *(uint32_t *)ctx += (uint32_t)data_len;
+}
+
+static void bench_router(void)
+{
+    static const char *const topics[] = {
+        "smarthome/auto",
+        "smarthome/livingroom/actuators/fan",
+        "smarthome/livingroom/actuators/led",
+        "smarthome/livingroom/actuators/buzzer",
+    };
+    const size_t n_topics = sizeof(topics) / sizeof(topics[0]);
+    size_t lens[4];
+    uint32_t hits = 0, acc = 0;
+
+    mqtt_router_t router;
+    mqtt_router_init(&router);
+    for (size_t i = 0; i < n_topics; i++) {
+        mqtt_router_add(&router, topics[i], route_count, &hits);
+        lens[i] = strlen(topics[i]);
+    }
+
+    printf("-- mqtt_router --\n");
+    BENCH_RUN("dispatch (hash, exact match)", OPS, {
+        size_t k = bench_i % n_topics;
+        acc += mqtt_router_dispatch(&router, topics[k], lens[k], "x", 1);
+    });
+    // Chuỗi strstr cũ (kèm copy topic vào buffer 256 B như trước), để so sánh
+    BENCH_RUN("dispatch (strstr chain, old)", OPS, {
+        const char *t = topics[bench_i % n_topics];
+        if (strstr(t, "smarthome/auto")) acc += 1;
+        else if (strstr(t, "/actuators/") && !strstr(t, "/reported")) {
+            char topic_str[256] = {0};
+            strncpy(topic_str, t, 255);
+            t = topic_str;
+            if (strstr(t, "/fan")) acc += 2;
+            else if (strstr(t, "/led")) acc += 3;
+            else if (strstr(t, "/buzzer")) acc += 4;
+        }
+    });
+    bench_consume_u(acc + hits);
+}
+
+static void bench_reassembly(void)
+{
+    // Bảng ngưỡng 1500 B đến thành 3 fragment 512 B (buffer nhận của client nhỏ)
+    static char storage[2048];
+    static char message[1500];
+    for (size_t i = 0; i < sizeof(message); i++) {
+        message[i] = (char)('a' + i % 26);
+    }
+    const size_t frag = 512;
+
+    mqtt_reasm_t r;
+    mqtt_reasm_init(&r, storage, sizeof(storage));
+    uint32_t acc = 0;
+    int mismatches = 0;
+
+    printf("-- mqtt_reassembly --\n");
+    BENCH_RUN("1500 B in 512 B fragments", OPS / 10, {
+        for (size_t off = 0; off < sizeof(message); off += frag) {
+            size_t n = (sizeof(message) - off < frag) ? sizeof(message) - off : frag;
+            const char *out;
+            size_t out_len;
+            if (mqtt_reasm_feed(&r, message + off, n, off, sizeof(message), &out, &out_len) ==
+                MQTT_REASM_COMPLETE) {
+                acc += (uint32_t)out_len;
+                if (out_len != sizeof(message) || memcmp(out, message, out_len) != 0) mismatches++;
+            }
+        }
+    });
+    bench_consume_u(acc);
+    printf("%-30s messages=%u fragmented=%u dropped=%u mismatches=%d\n", "  result",
+           r.stats.messages, r.stats.fragmented, r.stats.dropped, mismatches);
+}
+
+static void bench_buzzer(void)
+{
+    static const uint16_t siren_steps[] = { 200, 200 };
+    static const buzzer_pattern_t siren = { siren_steps, 2, true };
+    buzzer_request_t r = { 0 };
+    uint32_t acc = 0;
+
+    printf("-- buzzer_request --\n");
+    BENCH_RUN("set_level (0..3 cycle)", OPS, {
+        acc += buzzer_request_set_level(&r, (int)(bench_i & 3));
+    });
+    bench_consume_u(acc);
+
+    // Pattern lặp từ buzzer_play() phải dừng được bằng set_level(0):
+    // yêu cầu đổi (-> kick timer) và callback thấy gen mới với pattern NULL
+    buzzer_request_set_level(&r, 0);
+    buzzer_request_play(&r, &siren);
+    uint32_t gen = r.gen;
+    bool kicked = buzzer_request_set_level(&r, 0);
+    printf("%-30s %s\n", "  play(repeat)+level 0 stops",
+           (kicked && r.requested == NULL && r.gen != gen && r.level == 0) ? "yes" : "NO");
+
+    // Pattern một lần phát xong -> level về 0, set_level(0) không kick thừa
+    static const buzzer_pattern_t once = { siren_steps, 2, false };
+    buzzer_request_play(&r, &once);
+    buzzer_request_finish(&r, r.gen);
+    printf("%-30s %s\n", "  one-shot done -> level 0",
+           (r.requested == NULL && r.level == 0 && !buzzer_request_set_level(&r, 0)) ? "yes" : "NO");
+}
+
+int main(void)
+{
+    printf("== Firmware pure logic ==\n");
+    bench_filters();
+    bench_control();
+    bench_payload();
+    bench_policy();
+    bench_router();
+    bench_reassembly();
+    bench_buzzer();
+    return 0;
+}
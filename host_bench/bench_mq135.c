@@ -0,0 +1,64 @@
+// Benchmark: MQ135 raw → ppm, đường float (powf) so với bảng tra nội suy
+#include "bench.h"
+#include "mq135_math.h"
+#include <math.h>
+
+#define ITERATIONS  200
+#define RAW_MIN     100     // Cùng khoảng hợp lệ với mq135_read_sample()
+#define RAW_MAX     3800
+#define RO_KOHM     9.5f
+
+static float float_path(uint16_t raw)
+{
+    float vout = mq135_math_linear_vout(raw);
+    return mq135_math_ppm(mq135_math_ratio(mq135_math_rs(vout), RO_KOHM));
+}
+
+int main(void)
+{
+    static mq135_lut_t lut;
+    const uint64_t ops = (uint64_t)ITERATIONS * (RAW_MAX - RAW_MIN + 1);
+
+    uint64_t t0 = bench_now_ns();
+    mq135_lut_build(&lut, RO_KOHM, NULL, NULL);
+    uint64_t build_ns = bench_now_ns() - t0;
+
+    // Độ chính xác của bảng trong vùng dùng được
+    float max_err = 0.0f;
+    uint16_t max_err_raw = 0;
+    for (uint16_t raw = RAW_MIN; raw <= RAW_MAX; raw++) {
+        float vout, ppm;
+        mq135_lut_lookup(&lut, raw, &vout, &ppm);
+        float err = fabsf(ppm - float_path(raw));
+        if (err > max_err) {
+            max_err = err;
+            max_err_raw = raw;
+        }
+    }
+
+    printf("== MQ135 raw -> ppm (Ro = %.1f kOhm, raw %d-%d) ==\n", RO_KOHM, RAW_MIN, RAW_MAX);
+
+    const uint64_t range = RAW_MAX - RAW_MIN + 1;
+    float acc = 0.0f;
+    BENCH_RUN("float path (powf)", ops,
+              acc += float_path((uint16_t)(RAW_MIN + bench_i % range)));
+    bench_consume_f(acc);
+
+    acc = 0.0f;
+    BENCH_RUN("LUT 257 knots + lerp", ops, {
+        float vout, ppm;
+        mq135_lut_lookup(&lut, (uint16_t)(RAW_MIN + bench_i % range), &vout, &ppm);
+        acc += ppm;
+    });
+    bench_consume_f(acc);
+
+    acc = 0.0f;
+    BENCH_RUN("mq135_math_rs + ratio", ops,
+              acc += mq135_math_ratio(mq135_math_rs(mq135_math_linear_vout(
+                         (uint16_t)(RAW_MIN + bench_i % range))), RO_KOHM));
+    bench_consume_f(acc);
+
+    printf("LUT build                    %10.2f us  (%zu bytes)\n", build_ns / 1000.0, sizeof(lut));
+    printf("LUT max |error|              %10.3f ppm at raw=%u\n", max_err, max_err_raw);
+    return 0;
+}
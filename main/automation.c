@@ -0,0 +1,151 @@
+#include "automation.h"
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "nvs.h"
+#include "mqtt_handler.h"
+
+static const char *TAG = "AUTOMATION";
+
+#define NVS_NAMESPACE "ctrl_rules"
+#define NVS_KEY_TABLE "table"
+
+#define RULES_BLOB_MAGIC   0x52554C45u   // "RULE"
+#define RULES_BLOB_VERSION 1
+
+// Bảng đã biên dịch trong NVS: header + count luật
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    control_rule_t rules[CONTROL_RULES_MAX];
+} rules_blob_t;
+
+#define RULES_BLOB_HEADER offsetof(rules_blob_t, rules)
+
+// Bảng đang chạy - actuator_task đánh giá, task MQTT thay thế
+static control_rules_t active_rules;
+static portMUX_TYPE rules_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Chỉ task sự kiện MQTT dùng (handler không chạy song song)
+static control_rules_t staged_rules;
+static rules_blob_t blob;
+
+static char topic_rules[128];
+static char topic_status[128];
+
+// ========== NVS ==========
+static esp_err_t load_rules_from_nvs(control_rules_t *out)
+{
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs);
+    if (err != ESP_OK) return err;
+
+    size_t size = sizeof(blob);
+    err = nvs_get_blob(nvs, NVS_KEY_TABLE, &blob, &size);
+    nvs_close(nvs);
+    if (err != ESP_OK) return err;
+
+    if (size < RULES_BLOB_HEADER || blob.magic != RULES_BLOB_MAGIC || blob.version != RULES_BLOB_VERSION ||
+        blob.count == 0 || blob.count > CONTROL_RULES_MAX ||
+        size != RULES_BLOB_HEADER + blob.count * sizeof(control_rule_t)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memset(out, 0, sizeof(*out));
+    memcpy(out->rules, blob.rules, blob.count * sizeof(control_rule_t));
+    out->count = (uint8_t)blob.count;
+
+    control_rules_error_t verr;
+    if (!control_rules_validate(out, &verr)) {
+        ESP_LOGW(TAG, "⚠️ Stored rule %d invalid: %s", verr.rule, verr.message);
+        return ESP_ERR_INVALID_STATE;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t save_rules_to_nvs(const control_rules_t *rs)
+{
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK) return err;
+
+    blob.magic = RULES_BLOB_MAGIC;
+    blob.version = RULES_BLOB_VERSION;
+    blob.count = rs->count;
+    memcpy(blob.rules, rs->rules, rs->count * sizeof(control_rule_t));
+
+    err = nvs_set_blob(nvs, NVS_KEY_TABLE, &blob, RULES_BLOB_HEADER + rs->count * sizeof(control_rule_t));
+    if (err == ESP_OK) err = nvs_commit(nvs);
+
+    nvs_close(nvs);
+    return err;
+}
+
+// ========== MQTT: smarthome/{room}/config/rules ==========
+static void publish_status(const char *json)
+{
+    mqtt_outbox_publish(MQTT_STREAM_REPORT, topic_status, json, strlen(json));
+}
+
+static void on_rules_message(const char *data, size_t data_len, void *ctx)
+{
+    (void) ctx;
+    char status[128];
+    control_rules_error_t err = { -1, NULL };
+
+    if (!control_rules_parse(data, data_len, &staged_rules, &err)) {
+        ESP_LOGW(TAG, "❌ Rule table rejected (rule %d: %s)", err.rule, err.message);
+        snprintf(status, sizeof(status), "{\"ok\":false,\"rule\":%d,\"error\":\"%s\"}", err.rule, err.message);
+        publish_status(status);
+        return;
+    }
+
+    // Bảng mới bắt đầu với mọi luật inactive
+    taskENTER_CRITICAL(&rules_lock);
+    active_rules = staged_rules;
+    taskEXIT_CRITICAL(&rules_lock);
+
+    esp_err_t ret = save_rules_to_nvs(&staged_rules);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "⚠️ Rule table applied but not saved: %s", esp_err_to_name(ret));
+    }
+    ESP_LOGI(TAG, "✅ Rule table replaced: %d rules", staged_rules.count);
+
+    snprintf(status, sizeof(status), "{\"ok\":true,\"rules\":%d,\"saved\":%s}",
+             staged_rules.count, (ret == ESP_OK) ? "true" : "false");
+    publish_status(status);
+}
+
+// ========== PUBLIC API ==========
+esp_err_t automation_init(const char *room_id)
+{
+    esp_err_t err = load_rules_from_nvs(&active_rules);
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "📋 Loaded %d rules from NVS", active_rules.count);
+    } else {
+        control_rules_load_defaults(&active_rules);
+        ESP_LOGI(TAG, "📋 Using default rules (%d), NVS: %s", active_rules.count, esp_err_to_name(err));
+    }
+
+    snprintf(topic_rules, sizeof(topic_rules), "smarthome/%s/config/rules", room_id);
+    snprintf(topic_status, sizeof(topic_status), "smarthome/%s/config/rules/status", room_id);
+    return mqtt_register_command_handler(topic_rules, on_rules_message, NULL);
+}
+
+void automation_reset(void)
+{
+    taskENTER_CRITICAL(&rules_lock);
+    control_rules_reset(&active_rules);
+    taskEXIT_CRITICAL(&rules_lock);
+}
+
+void automation_eval(const float inputs[CTRL_CH_COUNT], uint32_t valid_mask, uint8_t levels[CTRL_ACT_COUNT])
+{
+    // Tối đa CONTROL_RULES_MAX phép so sánh, không log - giữ được trong critical section
+    taskENTER_CRITICAL(&rules_lock);
+    control_rules_eval(&active_rules, inputs, valid_mask, levels);
+    taskEXIT_CRITICAL(&rules_lock);
+}
@@ -0,0 +1,30 @@
+#ifndef AUTOMATION_H
+#define AUTOMATION_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "control_rules.h"
+
+/*
+ * Bảng luật AUTO mode (control_rules.h) gắn với NVS + MQTT
+ *
+ * - Boot: nạp bảng đã biên dịch từ NVS ("ctrl_rules"/"table"), không có hoặc
+ *   không hợp lệ -> bảng mặc định
+ * - MQTT smarthome/{room}/config/rules: payload dạng văn bản của
+ *   control_rules.h; hợp lệ -> thay bảng ngay + lưu NVS. Kết quả publish lên
+ *   smarthome/{room}/config/rules/status:
+ *     {"ok":true,"rules":9}
+ *     {"ok":false,"rule":2,"error":"level out of range"}
+ *   Bảng lỗi bị bỏ nguyên vẹn, bảng đang chạy không đổi.
+ */
+
+/** @brief Nạp bảng luật và đăng ký topic cấu hình (gọi trước mqtt_app_start) */
+esp_err_t automation_init(const char *room_id);
+
+/** @brief Xóa trạng thái hysteresis (khi vừa chuyển sang AUTO) */
+void automation_reset(void);
+
+/** @brief Đánh giá bảng luật cho một frame (xem control_rules_eval) */
+void automation_eval(const float inputs[CTRL_CH_COUNT], uint32_t valid_mask, uint8_t levels[CTRL_ACT_COUNT]);
+
+#endif // AUTOMATION_H
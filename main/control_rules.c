@@ -0,0 +1,286 @@
+#include "control_rules.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *const channel_names[CTRL_CH_COUNT] = {
+    [CTRL_CH_TEMP] = "temp",
+    [CTRL_CH_HUMI] = "humi",
+    [CTRL_CH_PPM] = "ppm",
+    [CTRL_CH_RAW] = "raw",
+    [CTRL_CH_AQ] = "aq",
+};
+
+static const char *const actuator_names[CTRL_ACT_COUNT] = {
+    [CTRL_ACT_FAN] = "fan",
+    [CTRL_ACT_LED] = "led",
+    [CTRL_ACT_BUZZER] = "buzzer",
+};
+
+static const uint8_t actuator_max_level[CTRL_ACT_COUNT] = {
+    [CTRL_ACT_FAN] = 2,
+    [CTRL_ACT_LED] = 4,
+    [CTRL_ACT_BUZZER] = 3,
+};
+
+// ========== BẢNG MẶC ĐỊNH ==========
+// Fan: OFF → 50% khi T ≥ 25°C (nhả < 24°C), 50% → 100% khi T ≥ 30°C (nhả < 29°C)
+// LED: màu theo mức AQ 0-4 (Green, Cyan, Yellow, Red, Purple)
+// Buzzer: AQ 2 → WARN, 3 → ALERT, 4 → CRITICAL
+// Mọi luật đều hold: SHT31 / MQ135 lỗi một chu kỳ thì giữ trạng thái gần nhất
+// (như bản cũ giữ nhiệt độ cuối), không tắt quạt rồi ramp lại
+static const control_rule_t default_rules[] = {
+    { .actuator = CTRL_ACT_FAN, .level = 1, .channel = CTRL_CH_TEMP, .op = CTRL_OP_GE, .on = 25.0f, .off = 24.0f, .flags = CTRL_RULE_HOLD },
+    { .actuator = CTRL_ACT_FAN, .level = 2, .channel = CTRL_CH_TEMP, .op = CTRL_OP_GE, .on = 30.0f, .off = 29.0f, .flags = CTRL_RULE_HOLD },
+    { .actuator = CTRL_ACT_LED, .level = 1, .channel = CTRL_CH_AQ, .op = CTRL_OP_GE, .on = 1, .off = 1, .flags = CTRL_RULE_HOLD },
+    { .actuator = CTRL_ACT_LED, .level = 2, .channel = CTRL_CH_AQ, .op = CTRL_OP_GE, .on = 2, .off = 2, .flags = CTRL_RULE_HOLD },
+    { .actuator = CTRL_ACT_LED, .level = 3, .channel = CTRL_CH_AQ, .op = CTRL_OP_GE, .on = 3, .off = 3, .flags = CTRL_RULE_HOLD },
+    { .actuator = CTRL_ACT_LED, .level = 4, .channel = CTRL_CH_AQ, .op = CTRL_OP_GE, .on = 4, .off = 4, .flags = CTRL_RULE_HOLD },
+    { .actuator = CTRL_ACT_BUZZER, .level = 1, .channel = CTRL_CH_AQ, .op = CTRL_OP_GE, .on = 2, .off = 2, .flags = CTRL_RULE_HOLD },
+    { .actuator = CTRL_ACT_BUZZER, .level = 2, .channel = CTRL_CH_AQ, .op = CTRL_OP_GE, .on = 3, .off = 3, .flags = CTRL_RULE_HOLD },
+    { .actuator = CTRL_ACT_BUZZER, .level = 3, .channel = CTRL_CH_AQ, .op = CTRL_OP_GE, .on = 4, .off = 4, .flags = CTRL_RULE_HOLD },
+};
+
+uint8_t control_rules_max_level(control_actuator_t actuator)
+{
+    return (actuator < CTRL_ACT_COUNT) ? actuator_max_level[actuator] : 0;
+}
+
+const char *control_rules_actuator_name(control_actuator_t actuator)
+{
+    return (actuator < CTRL_ACT_COUNT) ? actuator_names[actuator] : "?";
+}
+
+void control_rules_load_defaults(control_rules_t *rs)
+{
+    memset(rs, 0, sizeof(*rs));
+    memcpy(rs->rules, default_rules, sizeof(default_rules));
+    rs->count = sizeof(default_rules) / sizeof(default_rules[0]);
+}
+
+void control_rules_reset(control_rules_t *rs)
+{
+    rs->active_mask = 0;
+}
+
+static const char *rule_check(const control_rule_t *r)
+{
+    if (r->channel >= CTRL_CH_COUNT) return "unknown channel";
+    if (r->actuator >= CTRL_ACT_COUNT) return "unknown actuator";
+    if (r->level > actuator_max_level[r->actuator]) return "level out of range";
+    if (!isfinite(r->on) || !isfinite(r->off)) return "bad threshold";
+    if (r->op == CTRL_OP_GE) {
+        if (r->off > r->on) return "off must be <= on for >=";
+    } else if (r->op == CTRL_OP_LE) {
+        if (r->off < r->on) return "off must be >= on for <=";
+    } else {
+        return "unknown operator";
+    }
+    return NULL;
+}
+
+bool control_rules_validate(const control_rules_t *rs, control_rules_error_t *err)
+{
+    if (rs->count > CONTROL_RULES_MAX) {
+        if (err) *err = (control_rules_error_t){ -1, "too many rules" };
+        return false;
+    }
+    for (int i = 0; i < rs->count; i++) {
+        const char *msg = rule_check(&rs->rules[i]);
+        if (msg != NULL) {
+            if (err) *err = (control_rules_error_t){ i, msg };
+            return false;
+        }
+    }
+    return true;
+}
+
+// ========== ĐÁNH GIÁ: MỘT LƯỢT / FRAME ==========
+void control_rules_eval(control_rules_t *rs, const float inputs[CTRL_CH_COUNT], uint32_t valid_mask,
+                        uint8_t levels[CTRL_ACT_COUNT])
+{
+    uint8_t out[CTRL_ACT_COUNT] = { 0 };
+    uint32_t active = rs->active_mask;
+
+    for (int i = 0; i < rs->count; i++) {
+        const control_rule_t *r = &rs->rules[i];
+        uint32_t bit = 1u << i;
+
+        if (valid_mask & (1u << r->channel)) {
+            float x = inputs[r->channel];
+            bool on;
+            if (r->op == CTRL_OP_GE) {
+                on = (active & bit) ? (x >= r->off) : (x >= r->on);
+            } else {
+                on = (active & bit) ? (x <= r->off) : (x <= r->on);
+            }
+            active = on ? (active | bit) : (active & ~bit);
+        } else if (!(r->flags & CTRL_RULE_HOLD)) {
+            active &= ~bit;
+        }
+
+        if ((active & bit) && r->level > out[r->actuator]) {
+            out[r->actuator] = r->level;
+        }
+    }
+
+    rs->active_mask = active;
+    memcpy(levels, out, sizeof(out));
+}
+
+// ========== BIÊN DỊCH DẠNG VĂN BẢN ==========
+typedef struct {
+    const char *p;
+    const char *end;
+} cursor_t;
+
+static void skip_blank(cursor_t *c)
+{
+    while (c->p < c->end && (*c->p == ' ' || *c->p == '\t' || *c->p == '\r')) {
+        c->p++;
+    }
+}
+
+// Bỏ khoảng trắng, dòng trống, ';' thừa và chú thích '#'
+static void skip_separators(cursor_t *c)
+{
+    while (c->p < c->end) {
+        char ch = *c->p;
+        if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' || ch == ';') {
+            c->p++;
+        } else if (ch == '#') {
+            while (c->p < c->end && *c->p != '\n') c->p++;
+        } else {
+            break;
+        }
+    }
+}
+
+// Từ [a-z_], trả về độ dài
+static size_t read_word(cursor_t *c, const char **word)
+{
+    *word = c->p;
+    while (c->p < c->end && ((*c->p >= 'a' && *c->p <= 'z') || (*c->p >= 'A' && *c->p <= 'Z') || *c->p == '_')) {
+        c->p++;
+    }
+    return (size_t)(c->p - *word);
+}
+
+static int lookup(const char *const *names, int count, const char *word, size_t len)
+{
+    for (int i = 0; i < count; i++) {
+        if (strlen(names[i]) == len && strncmp(names[i], word, len) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool read_number(cursor_t *c, float *out)
+{
+    char buf[24];
+    size_t n = 0;
+    while (c->p < c->end && n < sizeof(buf) - 1 &&
+           ((*c->p >= '0' && *c->p <= '9') || *c->p == '.' || *c->p == '-' || *c->p == '+' ||
+            *c->p == 'e' || *c->p == 'E')) {
+        buf[n++] = *c->p++;
+    }
+    if (n == 0) {
+        return false;
+    }
+    buf[n] = '\0';
+    char *endp;
+    float v = strtof(buf, &endp);
+    if (*endp != '\0' || !isfinite(v)) {
+        return false;
+    }
+    *out = v;
+    return true;
+}
+
+static const char *parse_rule(cursor_t *c, control_rule_t *r)
+{
+    const char *word;
+    size_t len;
+
+    memset(r, 0, sizeof(*r));
+
+    // <actuator>=<level>
+    len = read_word(c, &word);
+    int act = lookup(actuator_names, CTRL_ACT_COUNT, word, len);
+    if (act < 0) return "unknown actuator";
+    skip_blank(c);
+    if (c->p >= c->end || *c->p != '=') return "expected '='";
+    c->p++;
+    skip_blank(c);
+    float level;
+    if (!read_number(c, &level) || level != (float)(int)level || level < 0 || level > 255) {
+        return "bad level";
+    }
+
+    // <channel><op><on>[/<off>]
+    skip_blank(c);
+    len = read_word(c, &word);
+    int ch = lookup(channel_names, CTRL_CH_COUNT, word, len);
+    if (ch < 0) return "unknown channel";
+    skip_blank(c);
+    if (c->end - c->p < 2 || c->p[1] != '=' || (c->p[0] != '>' && c->p[0] != '<')) {
+        return "expected >= or <=";
+    }
+    r->op = (c->p[0] == '>') ? CTRL_OP_GE : CTRL_OP_LE;
+    c->p += 2;
+    skip_blank(c);
+    if (!read_number(c, &r->on)) return "bad threshold";
+    r->off = r->on;
+    skip_blank(c);
+    if (c->p < c->end && *c->p == '/') {
+        c->p++;
+        skip_blank(c);
+        if (!read_number(c, &r->off)) return "bad threshold";
+    }
+
+    // [hold]
+    skip_blank(c);
+    if (c->p < c->end && *c->p != ';' && *c->p != '\n' && *c->p != '#') {
+        len = read_word(c, &word);
+        if (len != 4 || strncmp(word, "hold", 4) != 0) return "unexpected token";
+        r->flags |= CTRL_RULE_HOLD;
+        skip_blank(c);
+        if (c->p < c->end && *c->p != ';' && *c->p != '\n' && *c->p != '#') return "unexpected token";
+    }
+
+    r->actuator = (uint8_t)act;
+    r->channel = (uint8_t)ch;
+    r->level = (uint8_t)level;
+    return rule_check(r);
+}
+
+bool control_rules_parse(const char *text, size_t len, control_rules_t *out, control_rules_error_t *err)
+{
+    control_rules_t rs = { 0 };
+    cursor_t c = { text, text + len };
+
+    for (;;) {
+        skip_separators(&c);
+        if (c.p >= c.end || *c.p == '\0') {
+            break;
+        }
+        if (rs.count >= CONTROL_RULES_MAX) {
+            if (err) *err = (control_rules_error_t){ rs.count, "too many rules" };
+            return false;
+        }
+        const char *msg = parse_rule(&c, &rs.rules[rs.count]);
+        if (msg != NULL) {
+            if (err) *err = (control_rules_error_t){ rs.count, msg };
+            return false;
+        }
+        rs.count++;
+    }
+
+    if (rs.count == 0) {
+        if (err) *err = (control_rules_error_t){ -1, "empty rule table" };
+        return false;
+    }
+    *out = rs;
+    return true;
+}
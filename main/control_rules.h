@@ -0,0 +1,103 @@
+#ifndef CONTROL_RULES_H
+#define CONTROL_RULES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Bảng luật tự động hóa AUTO mode (thuần C, không phụ thuộc ESP-IDF)
+ *
+ * Mỗi luật: kênh cảm biến + phép so sánh + dải hysteresis -> actuator đạt
+ * level khi luật đang active. Mỗi frame cảm biến, control_rules_eval() đi một
+ * lượt qua bảng; level của actuator = level lớn nhất trong các luật active của
+ * nó (không có luật nào -> 0). Không log, không cấp phát, không format chuỗi.
+ *
+ * Dạng văn bản (MQTT smarthome/{room}/config/rules, xem automation.h):
+ *   <actuator>=<level> <channel><op><on>[/<off>] [hold]
+ * phân tách bằng ';' hoặc xuống dòng, '#' là chú thích đến hết dòng.
+ *   op ">=": active khi x >= on, giữ đến khi x < off   (off <= on)
+ *   op "<=": active khi x <= on, giữ đến khi x > off   (off >= on)
+ *   hold    : khi cảm biến không hợp lệ giữ nguyên trạng thái (mặc định: tắt luật)
+ * Ví dụ: "fan=1 temp>=25/24 hold; fan=2 temp>=30/29 hold; buzzer=3 aq>=4 hold"
+ */
+
+#define CONTROL_RULES_MAX 32            // active_mask là uint32_t
+
+typedef enum {
+    CTRL_CH_TEMP = 0,                   // °C (SHT31)
+    CTRL_CH_HUMI,                       // % (SHT31)
+    CTRL_CH_PPM,                        // ppm (MQ135)
+    CTRL_CH_RAW,                        // ADC raw (MQ135)
+    CTRL_CH_AQ,                         // Mức chất lượng không khí 0-4 (MQ135, đã lọc)
+    CTRL_CH_COUNT
+} control_channel_t;
+
+typedef enum {
+    CTRL_ACT_FAN = 0,                   // 0=OFF, 1=50%, 2=100%
+    CTRL_ACT_LED,                       // 0=Green .. 4=Purple (actuator_shadow.h)
+    CTRL_ACT_BUZZER,                    // 0=OFF .. 3=CRITICAL (buzzer.h)
+    CTRL_ACT_COUNT
+} control_actuator_t;
+
+typedef enum {
+    CTRL_OP_GE = 0,
+    CTRL_OP_LE,
+} control_op_t;
+
+#define CTRL_RULE_HOLD 0x01             // Giữ trạng thái khi kênh không hợp lệ
+
+typedef struct {
+    float on;                           // Ngưỡng kích hoạt
+    float off;                          // Ngưỡng nhả (hysteresis)
+    uint8_t channel;                    // control_channel_t
+    uint8_t op;                         // control_op_t
+    uint8_t actuator;                   // control_actuator_t
+    uint8_t level;
+    uint8_t flags;                      // CTRL_RULE_*
+} control_rule_t;
+
+typedef struct {
+    control_rule_t rules[CONTROL_RULES_MAX];
+    uint8_t count;
+    uint32_t active_mask;               // Bit i = luật i đang active
+} control_rules_t;
+
+typedef struct {
+    int rule;                           // Luật lỗi (0-based), -1 nếu lỗi chung
+    const char *message;
+} control_rules_error_t;
+
+/** @brief Level lớn nhất hợp lệ của actuator */
+uint8_t control_rules_max_level(control_actuator_t actuator);
+
+const char *control_rules_actuator_name(control_actuator_t actuator);
+
+/** @brief Nạp bảng mặc định (tương đương bậc thang fan/LED/buzzer cũ) */
+void control_rules_load_defaults(control_rules_t *rs);
+
+/** @brief Xóa trạng thái hysteresis (ví dụ khi vừa chuyển sang AUTO) */
+void control_rules_reset(control_rules_t *rs);
+
+/**
+ * @brief Kiểm tra bảng đã biên dịch (ví dụ đọc từ NVS)
+ * @return true nếu mọi luật hợp lệ
+ */
+bool control_rules_validate(const control_rules_t *rs, control_rules_error_t *err);
+
+/**
+ * @brief Biên dịch dạng văn bản thành bảng luật (không cấp phát, không cần '\0')
+ * @return true nếu thành công; *out chỉ bị ghi khi thành công
+ */
+bool control_rules_parse(const char *text, size_t len, control_rules_t *out, control_rules_error_t *err);
+
+/**
+ * @brief Đánh giá bảng luật cho một frame
+ * @param inputs     Giá trị theo control_channel_t
+ * @param valid_mask Bit (1 << channel) = kênh hợp lệ trong frame này
+ * @param levels     Kết quả: level theo control_actuator_t
+ */
+void control_rules_eval(control_rules_t *rs, const float inputs[CTRL_CH_COUNT], uint32_t valid_mask,
+                        uint8_t levels[CTRL_ACT_COUNT]);
+
+#endif // CONTROL_RULES_H
@@ -1,5 +1,5 @@
 // Main application - 4-Level Buzzer System + LCD Display
-// Buzzer: Level 0 (OFF) → Level 1 (5s) → Level 2 (2s x5) → Level 3 (1s x10)
+// Buzzer: Level 0 (OFF) → Level 1 (5s) → Level 2 (3s) → Level 3 (1s)
 
 #include <stdio.h>
 #include <string.h>
@@ -11,6 +11,7 @@
 #include "esp_timer.h"
 
 #include "app_config.h"
+#include "sensor_frame.h"
 #include "wifi_manager.h"
 #include "mqtt_handler.h"
 #include "fan.h"
@@ -20,6 +21,9 @@
 #include "mq135.h"
 #include "moving_average.h"
 #include "lcd1602.h"
+#include "actuator_shadow.h"
+#include "actuator_cmd.h"
+#include "automation.h"
 #include "driver/gpio.h"
 
 static const char *TAG = "MAIN";
@@ -32,45 +36,33 @@ static const char *TAG = "MAIN";
 char device_room_id[32] = "livingroom"; 
 
 // Các biến lưu Topic sau khi đã ghép chuỗi
-char topic_fan[128];
-char topic_led[128];
-char topic_buzzer[128];
 char topic_temp[128];
 char topic_humi[128];
 char topic_co2[128];
 
-// Moving averages
-static moving_average_t ma_temp;
-static moving_average_t ma_humi;
-static moving_average_t ma_air;
+// Bộ lọc cảm biến (storage tĩnh, cập nhật O(1))
+#define SHT_FILTER_WINDOW   10
+#define AIR_MEDIAN_WINDOW   9    // Lẻ -> median luôn là một mức AQ thực tế
+
+static float ma_temp_buf[SHT_FILTER_WINDOW];
+static float ma_humi_buf[SHT_FILTER_WINDOW];
+static int16_t air_ring_buf[AIR_MEDIAN_WINDOW];
+static int16_t air_sorted_buf[AIR_MEDIAN_WINDOW];
+static ma_f32_t ma_temp;
+static ma_f32_t ma_humi;
+static median_i16_t air_median;
 
 // Task handles
 static TaskHandle_t sensor_task_handle = NULL;
 static TaskHandle_t actuator_task_handle = NULL;
 static TaskHandle_t mqtt_task_handle = NULL;
 
-// Latest values
-static float latest_temp = 0.0f;
-static float latest_humi = 0.0f;
-static int latest_air_level = 0;
-static int latest_mq_raw = 0;
-static float latest_mq_ppm = 0.0f;
-static bool sht31_valid = false;  // Trạng thái cảm biến SHT31
-
-// ========== 4-LEVEL BUZZER SYSTEM ==========
-// Buzzer levels: 0=OFF, 1=WARN(5s), 2=ALERT(3s), 3=CRITICAL(1s)
-// Logic được quản lý trong buzzer.c với Task Notification
-typedef enum {
-    BUZZER_OFF = 0,           // Tắt
-    BUZZER_WARN = 1,          // Cảnh báo: tít ngắn, nghỉ 5 giây
-    BUZZER_ALERT = 2,         // Nguy hiểm: tít ngắn, nghỉ 3 giây
-    BUZZER_CRITICAL = 3       // Nghiêm trọng: tít ngắn, nghỉ 1 giây
-} buzzer_level_t;
-
-static buzzer_level_t current_buzzer_level = BUZZER_OFF;
-
-// Fan control with hysteresis
-static uint8_t current_fan_speed = 0;
+// Frame mới nhất - chỉ sensor_task ghi, các task khác đọc bản copy
+static sensor_frame_t latest_frame = {0};
+static portMUX_TYPE frame_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Chờ actuator_task tối đa bao lâu trước khi gửi telemetry
+#define TELEMETRY_ACTUATOR_WAIT_MS 500
 
 // Event group
 static EventGroupHandle_t sys_event_group;
@@ -79,6 +71,8 @@ enum {
     EVT_WIFI_CONNECTED = BIT1,
     EVT_MQTT_CONNECTED = BIT2,
     EVT_MODE_CHANGED = BIT3,  // Trigger khi chuyển AUTO mode
+    EVT_ACTUATORS_DONE = BIT4,  // actuator_task đã xử lý xong frame (AUTO)
+    EVT_ACTUATOR_CMD = BIT5,    // Có lệnh MANUAL chờ áp (actuator_cmd.h)
 };
 
 // ===============================================
@@ -92,13 +86,31 @@ void trigger_actuator_update(void)
     }
 }
 
-void setup_mqtt_topics(const char* room_id)
+// Gọi từ task MQTT khi có lệnh MANUAL mới: chỉ đánh thức actuator_task
+static void notify_actuator_command(void)
+{
+    xEventGroupSetBits(sys_event_group, EVT_ACTUATOR_CMD);
+}
+
+// ===============================================
+// SENSOR FRAME: publish (sensor_task) / snapshot (consumers)
+// ===============================================
+static void sensor_frame_publish(const sensor_frame_t *frame)
+{
+    taskENTER_CRITICAL(&frame_lock);
+    latest_frame = *frame;
+    taskEXIT_CRITICAL(&frame_lock);
+}
+
+static void sensor_frame_get(sensor_frame_t *out)
 {
-    // home/[ROOM_ID]/actuators/fan
-    snprintf(topic_fan, sizeof(topic_fan), "smarthome/%s/actuators/fan", room_id);
-    snprintf(topic_led, sizeof(topic_led), "smarthome/%s/actuators/led", room_id);
-    snprintf(topic_buzzer, sizeof(topic_buzzer), "smarthome/%s/actuators/buzzer", room_id);
+    taskENTER_CRITICAL(&frame_lock);
+    *out = latest_frame;
+    taskEXIT_CRITICAL(&frame_lock);
+}
 
+void setup_mqtt_topics(const char* room_id)
+{
     // home/[ROOM_ID]/sensors/temp
     snprintf(topic_temp, sizeof(topic_temp), "smarthome/%s/sensors/temp", room_id);
     snprintf(topic_humi, sizeof(topic_humi), "smarthome/%s/sensors/humi", room_id);
@@ -108,111 +120,93 @@ void setup_mqtt_topics(const char* room_id)
 static bool read_sht31_with_retry(sht31_data_t *out)
 {
     for (int i = 0; i < 3; i++) {
-        sht31_data_t d = sht31_read();
-        if (d.temperature > -40 && d.temperature < 125) {
+        sht31_data_t d;
+        if (sht31_read_data(&d) == ESP_OK && d.temperature > -40 && d.temperature < 125) {
             *out = d;
             return true;
         }
-        vTaskDelay(pdMS_TO_TICKS(100));
+        vTaskDelay(pdMS_TO_TICKS(SHT31_RETRY_DELAY_MS));
     }
     return false;
 }
 
-static bool read_mq135_with_retry(int *out_raw)
+// Trả về kết quả của mq135_read_sample(); chỉ retry khi chưa có dữ liệu ADC
+static esp_err_t read_mq135_with_retry(mq135_sample_t *out)
 {
+    esp_err_t err = ESP_ERR_INVALID_STATE;
     for (int i = 0; i < 3; i++) {
-        uint16_t raw = mq135_read_raw();
-        if (raw <= 4095) {
-            *out_raw = raw;
-            return true;
+        err = mq135_read_sample(out);
+        if (err != ESP_ERR_INVALID_STATE) {
+            return err;
         }
         vTaskDelay(pdMS_TO_TICKS(100));
     }
-    return false;
-}
-
-// ========== BUZZER LEVEL CALCULATION ==========
-// Logic buzzer pattern được quản lý trong buzzer.c với Task Notification
-static buzzer_level_t calculate_buzzer_level(void)
-{
-    // Buzzer chỉ dựa trên chất lượng không khí (Air Quality Level)
-    // Level 0-1: Good/Fair → Không kêu
-    // Level 2: Moderate → Cảnh báo nhẹ (5s)
-    // Level 3: Poor → Cảnh báo trung (3s)
-    // Level 4: Very Poor → Cảnh báo mạnh (1s)
-    
-    switch (latest_air_level) {
-        case 4:  // Very Poor
-            return BUZZER_CRITICAL;  // Tít mỗi 1 giây
-        case 3:  // Poor
-            return BUZZER_ALERT;     // Tít mỗi 3 giây
-        case 2:  // Moderate
-            return BUZZER_WARN;      // Tít mỗi 5 giây
-        default: // Good (0) hoặc Fair (1)
-            return BUZZER_OFF;
-    }
+    return err;
 }
 
 static void sensor_task(void *pvParameters)
 {
     (void) pvParameters;
 
-    ma_init(&ma_temp, 10);
-    ma_init(&ma_humi, 10);
-    ma_init(&ma_air, 10);
+    ma_f32_init(&ma_temp, ma_temp_buf, SHT_FILTER_WINDOW);
+    ma_f32_init(&ma_humi, ma_humi_buf, SHT_FILTER_WINDOW);
+    median_i16_init(&air_median, air_ring_buf, air_sorted_buf, AIR_MEDIAN_WINDOW);
+
+    sensor_frame_t frame = {0};
 
     TickType_t last_wake = xTaskGetTickCount();
     while (1) {
+        // Frame mới giữ lại giá trị hợp lệ gần nhất, chỉ xóa các cờ valid
+        frame.seq++;
+        frame.timestamp_us = esp_timer_get_time();
+        frame.flags = 0;
+
         sht31_data_t sdata = {0};
         bool sht_ok = read_sht31_with_retry(&sdata);
 
-        int mq_raw = 0;
-        bool mq_ok = read_mq135_with_retry(&mq_raw);
+        mq135_sample_t mq = {0};
+        esp_err_t mq_err = read_mq135_with_retry(&mq);
 
         if (!sht_ok) {
             ESP_LOGE(TAG, "SHT31 read failed, sensor disconnected");
-            sht31_valid = false;
         } else {
-            ma_add(&ma_temp, sdata.temperature);
-            ma_add(&ma_humi, sdata.humidity);
-            latest_temp = ma_get(&ma_temp);
-            latest_humi = ma_get(&ma_humi);
-            sht31_valid = true;
+            ma_f32_add(&ma_temp, sdata.temperature);
+            ma_f32_add(&ma_humi, sdata.humidity);
+            frame.temperature = ma_f32_get(&ma_temp);
+            frame.humidity = ma_f32_get(&ma_humi);
+            frame.flags |= SENSOR_FRAME_SHT31_VALID;
         }
 
-        if (!mq_ok) {
+        if (mq_err == ESP_ERR_INVALID_STATE) {
             ESP_LOGE(TAG, "MQ135 read failed, using last value");
+        } else if (mq_err != ESP_OK) {
+            // ADC raw không hợp lệ - sensor có thể mất kết nối
+            ESP_LOGW(TAG, "MQ135: ADC raw=%u invalid (expect 100-3800), keeping last values", mq.raw);
         } else {
-            // Chỉ xử lý nếu ADC raw hợp lệ (100-3800)
-            if (mq_raw >= 100 && mq_raw <= 3800) {
-                float ppm = mq135_read_ppm();
-                
-                // AQ level dựa trên ADC raw (ổn định hơn ppm)
-                int level;
-                if (mq_raw < 600) level = 0;          // Clean
-                else if (mq_raw < 900) level = 1;     // Fair
-                else if (mq_raw < 1300) level = 2;    // Moderate
-                else if (mq_raw < 1800) level = 3;    // Poor
-                else level = 4;                       // Very Poor
-                
-                ma_add(&ma_air, (float)level);
-                latest_air_level = (int)ma_get(&ma_air);
-
-                latest_mq_raw = mq_raw;
-                // Chỉ cập nhật PPM nếu giá trị hợp lệ (không phải -1)
-                if (ppm >= 0.0f) {
-                    latest_mq_ppm = ppm;
-                    ESP_LOGI(TAG, "MQ135: ADC raw=%d, PPM=%.2f, AQ level=%d", mq_raw, ppm, level);
-                } else {
-                    // Giữ nguyên PPM cũ, không đặt về 0
-                    ESP_LOGW(TAG, "MQ135: ADC raw=%d, PPM read failed, keeping last=%.2f", mq_raw, latest_mq_ppm);
-                }
-            } else {
-                // ADC raw không hợp lệ - sensor có thể mất kết nối
-                ESP_LOGW(TAG, "MQ135: ADC raw=%d invalid (expect 100-3800), keeping last values", mq_raw);
-            }
+            // AQ level dựa trên ADC raw (ổn định hơn ppm)
+            int level;
+            if (mq.raw < 600) level = 0;          // Clean
+            else if (mq.raw < 900) level = 1;     // Fair
+            else if (mq.raw < 1300) level = 2;    // Moderate
+            else if (mq.raw < 1800) level = 3;    // Poor
+            else level = 4;                       // Very Poor
+
+            // Median của mức nguyên: không bị kéo xuống do cắt phần thập phân
+            median_i16_add(&air_median, (int16_t)level);
+            frame.air_level = median_i16_get(&air_median);
+
+            // raw và ppm đến từ cùng một lần lấy mẫu
+            frame.mq_raw = mq.raw;
+            frame.mq_vout = mq.vout;
+            frame.mq_rs = mq.rs;
+            frame.mq_ratio = mq.ratio;
+            frame.mq_ppm = mq.ppm;
+            frame.flags |= SENSOR_FRAME_MQ135_VALID | SENSOR_FRAME_PPM_VALID;
+            ESP_LOGI(TAG, "MQ135: ADC raw=%u, PPM=%.2f, AQ level=%d", mq.raw, mq.ppm, level);
         }
 
+        sensor_frame_publish(&frame);
+        lcd_post_frame(&frame);  // Display task tự vẽ, không chặn sensor/MQTT
         xEventGroupSetBits(sys_event_group, EVT_SENSOR_READY);
         vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(SENSOR_READ_INTERVAL_MS));
     }
@@ -225,151 +219,71 @@ static void actuator_task(void *pvParameters)
     // Actuators already initialized in app_main(), no need to init again
 
     while (1) {
-        // Chờ event từ sensor hoặc mode change
+        // Chờ event từ sensor, mode change hoặc lệnh MANUAL
         EventBits_t bits = xEventGroupWaitBits(
             sys_event_group, 
-            EVT_SENSOR_READY | EVT_MODE_CHANGED,  // Lắng nghe cả 2 event
+            EVT_SENSOR_READY | EVT_MODE_CHANGED | EVT_ACTUATOR_CMD,
             pdTRUE,  // Clear bits sau khi đọc
-            pdFALSE, // Chỉ cần 1 trong 2 event
+            pdFALSE, // Chỉ cần 1 trong các event
             portMAX_DELAY
         );
         
-        if (bits & (EVT_SENSOR_READY | EVT_MODE_CHANGED)) {
+        if (bits & (EVT_SENSOR_READY | EVT_MODE_CHANGED | EVT_ACTUATOR_CMD)) {
 
             if (!mqtt_is_auto_mode()) {
-                ESP_LOGI(TAG, "👤 MANUAL mode - Skipping auto control");
-                vTaskDelay(pdMS_TO_TICKS(1000));
+                // MANUAL: chỉ áp lệnh mới nhất của mỗi thiết bị (burst đã được gộp)
+                if (bits & EVT_ACTUATOR_CMD) {
+                    actuator_cmd_apply_pending();
+                }
+                continue;
+            }
+
+            // Lệnh MANUAL đến muộn sau khi đã chuyển sang AUTO
+            actuator_cmd_discard();
+            if (!(bits & (EVT_SENSOR_READY | EVT_MODE_CHANGED))) {
                 continue;
             }
 
             // ✅ Nếu vừa chuyển sang AUTO, reset hysteresis state
             if (bits & EVT_MODE_CHANGED) {
-                current_fan_speed = 0;  // Reset để tính lại từ nhiệt độ hiện tại
-                current_buzzer_level = BUZZER_OFF;
+                automation_reset();
                 ESP_LOGI(TAG, "🔄 Mode changed - Reset hysteresis state");
             }
 
-            ESP_LOGI(TAG, "🤖 AUTO mode - Running auto control");
-            ESP_LOGI(TAG, "===== Actuator Control Start =====");
-            ESP_LOGI(TAG, "Sensors: T=%.2f°C, H=%.2f%%, AQ=%d", latest_temp, latest_humi, latest_air_level);
-
-            // ========== FAN CONTROL WITH HYSTERESIS ==========
-            uint8_t fan_speed = 0;
-
-            if (!sht31_valid) {
-                // Không có cảm biến SHT31 -> TẮT QUẠT
-                fan_speed = 0;
-                if (current_fan_speed != 0) {
-                    ESP_LOGW(TAG, "[FAN] OFF (SHT31 không hoạt động)");
-                    fan_off();
-                }
-            }
-            else {
-                // Hysteresis: Tránh bật/tắt liên tục khi nhiệt độ dao động
-                // OFF zone: T < 24°C (hysteresis thấp hơn 25°C)
-                // 50% zone: 25°C ≤ T < 29°C (hysteresis thấp hơn 30°C)
-                // 100% zone: T ≥ 30°C
-                
-                if (current_fan_speed == 0) {
-                    // Quạt đang TẮT → Bật khi T ≥ 25°C
-                    if (latest_temp >= 25.0f) {
-                        fan_speed = 50;
-                        ESP_LOGI(TAG, "[FAN] 50%% (T=%.1f°C reached 25°C)", latest_temp);
-                        fan_set_speed(fan_speed);
-                    } else {
-                        fan_speed = 0;
-                    }
-                }
-                else if (current_fan_speed == 50) {
-                    // Quạt đang 50% → Kiểm tra hysteresis
-                    if (latest_temp >= 30.0f) {
-                        // Tăng lên 100%
-                        fan_speed = 100;
-                        ESP_LOGI(TAG, "[FAN] 100%% (T=%.1f°C reached 30°C)", latest_temp);
-                        fan_on();
-                    } 
-                    else if (latest_temp < 24.0f) {
-                        // Giảm xuống OFF (hysteresis -1°C)
-                        fan_speed = 0;
-                        ESP_LOGI(TAG, "[FAN] OFF (T=%.1f°C dropped below 24°C)", latest_temp);
-                        fan_off();
-                    } 
-                    else {
-                        // Giữ nguyên 50%
-                        fan_speed = 50;
-                    }
-                }
-                else if (current_fan_speed == 100) {
-                    // Quạt đang 100% → Kiểm tra hysteresis
-                    if (latest_temp < 29.0f) {
-                        // Giảm xuống 50% (hysteresis -1°C)
-                        fan_speed = 50;
-                        ESP_LOGI(TAG, "[FAN] 50%% (T=%.1f°C dropped below 29°C)", latest_temp);
-                        fan_set_speed(fan_speed);
-                    } 
-                    else {
-                        // Giữ nguyên 100%
-                        fan_speed = 100;
-                    }
-                }
+            sensor_frame_t frame;
+            sensor_frame_get(&frame);
+
+            // ========== MỘT LƯỢT QUA BẢNG LUẬT ==========
+            float inputs[CTRL_CH_COUNT] = {
+                [CTRL_CH_TEMP] = frame.temperature,
+                [CTRL_CH_HUMI] = frame.humidity,
+                [CTRL_CH_PPM] = frame.mq_ppm,
+                [CTRL_CH_RAW] = frame.mq_raw,
+                [CTRL_CH_AQ] = frame.air_level,
+            };
+            uint32_t valid = 0;
+            if (sensor_frame_has(&frame, SENSOR_FRAME_SHT31_VALID)) {
+                valid |= (1u << CTRL_CH_TEMP) | (1u << CTRL_CH_HUMI);
             }
-            
-            current_fan_speed = fan_speed;  // Lưu trạng thái
-            // Fan level: 0=OFF, 1=50%, 2=100% (match MANUAL mode)
-            int fan_level = (fan_speed == 0) ? 0 : ((fan_speed == 50) ? 1 : 2);
-            mqtt_publish_actuator(topic_fan, (fan_speed > 0) ? "ON" : "OFF", fan_level);
-
-            // ========== LED CONTROL ==========
-            // LED Colors by Air Quality Level (match MANUAL mode):
-            // Level 0: Green      (0, 1023, 0)     - Good
-            // Level 1: Cyan       (0, 1023, 1023)  - Fair
-            // Level 2: Yellow     (1023, 1023, 0)  - Moderate
-            // Level 3: Red        (1023, 0, 0)     - Poor
-            // Level 4: Purple     (1023, 0, 1023)  - Very Poor
-            const char* aq_desc[] = {"Good", "Fair", "Moderate", "Poor", "Very Poor"};
-            ESP_LOGI(TAG, "[LED] Air Quality: %s (level %d)", aq_desc[latest_air_level], latest_air_level);
-            
-            switch (latest_air_level) {
-                case 0: // Green - Good
-                    led_set_rgb(0, 1023, 0);
-                    break;
-                    
-                case 1: // Cyan - Fair
-                    led_set_rgb(0, 1023, 1023);
-                    break;
-                    
-                case 2: // Yellow - Moderate
-                    led_set_rgb(1023, 1023, 0);
-                    break;
-                    
-                case 3: // Red - Poor
-                    led_set_rgb(1023, 0, 0);
-                    break;
-                    
-                case 4: // Purple - Very Poor
-                    led_set_rgb(1023, 0, 1023);
-                    break;
-                    
-                default:
-                    led_set_rgb(0, 0, 0);
-                    break;
+            if (sensor_frame_has(&frame, SENSOR_FRAME_MQ135_VALID)) {
+                valid |= (1u << CTRL_CH_RAW) | (1u << CTRL_CH_AQ);
             }
-            mqtt_publish_actuator(topic_led, 
-                     (latest_air_level >= 0 && latest_air_level <= 4) ? "ON" : "OFF", latest_air_level);
-
-            // ========== 🔔 BUZZER CONTROL (using buzzer.c API) ==========
-            buzzer_level_t new_level = calculate_buzzer_level();
-            
-            if (new_level != current_buzzer_level) {
-                ESP_LOGI(TAG, "[BUZZER] Level changed: %d → %d", current_buzzer_level, new_level);
-                current_buzzer_level = new_level;
-                buzzer_set_level((int)new_level);  // Sử dụng API mới với Task Notification
+            if (sensor_frame_has(&frame, SENSOR_FRAME_PPM_VALID)) {
+                valid |= (1u << CTRL_CH_PPM);
             }
-            
-            mqtt_publish_actuator(topic_buzzer, 
-                     (current_buzzer_level != BUZZER_OFF) ? "ON" : "OFF", (int)current_buzzer_level);
-            
-            ESP_LOGI(TAG, "===== Actuator Control End =====");
+
+            uint8_t levels[CTRL_ACT_COUNT];
+            automation_eval(inputs, valid, levels);
+
+            ESP_LOGD(TAG, "🤖 AUTO frame #%lu: T=%.2f°C AQ=%d -> fan=%u led=%u buzzer=%u",
+                     (unsigned long)frame.seq, frame.temperature, frame.air_level,
+                     levels[CTRL_ACT_FAN], levels[CTRL_ACT_LED], levels[CTRL_ACT_BUZZER]);
+
+            // Shadow chỉ chạm phần cứng / publish khi level đổi
+            actuator_shadow_set(ACTUATOR_FAN, levels[CTRL_ACT_FAN] > 0, levels[CTRL_ACT_FAN]);
+            actuator_shadow_set(ACTUATOR_LED, true, levels[CTRL_ACT_LED]);
+            actuator_shadow_set(ACTUATOR_BUZZER, levels[CTRL_ACT_BUZZER] > 0, levels[CTRL_ACT_BUZZER]);
+            xEventGroupSetBits(sys_event_group, EVT_ACTUATORS_DONE);
         }
     }
 }
@@ -385,24 +299,77 @@ static void mqtt_task(void *pvParameters)
         bool mqtt_connected = mqtt_is_connected();
         gpio_set_level(MQTT_STATUS_LED_GPIO, mqtt_connected ? 1 : 0);
 
-        // ========== LCD UPDATE (đồng bộ với sensor) ==========
-        lcd_display_all(
-            latest_temp, 
-            latest_humi, 
-            latest_air_level, 
-            latest_mq_ppm
-        );
+        // AUTO: đợi actuator_task quyết định xong để gửi cùng một bản tin
+        bool auto_mode = mqtt_is_auto_mode();
+        if (auto_mode) {
+            xEventGroupWaitBits(sys_event_group, EVT_ACTUATORS_DONE, pdTRUE, pdFALSE,
+                                pdMS_TO_TICKS(TELEMETRY_ACTUATOR_WAIT_MS));
+        }
 
-        // ========== MQTT PUBLISH ==========
-        char payload[128];
-        snprintf(payload, sizeof(payload), "{\"value\":%.2f,\"unit\":\"C\"}", latest_temp);
-        mqtt_send_data(topic_temp, latest_temp);
+        sensor_frame_t frame;
+        sensor_frame_get(&frame);
+        actuator_state_t fan = actuator_shadow_get(ACTUATOR_FAN);
+        actuator_state_t led = actuator_shadow_get(ACTUATOR_LED);
+        actuator_state_t buzzer = actuator_shadow_get(ACTUATOR_BUZZER);
+
+        ESP_LOGI(TAG, "MQ135 last raw=%u PPM=%.2f level=%d", frame.mq_raw, frame.mq_ppm, frame.air_level);
 
-        snprintf(payload, sizeof(payload), "{\"value\":%.2f,\"unit\":\"%%\"}", latest_humi);
-        mqtt_send_data(topic_humi, latest_humi);
+        // ========== MQTT PUBLISH ==========
+        // Một bản tin gộp: sensor + actuator + timestamp
+        mqtt_telemetry_t telemetry = {
+            .seq = frame.seq,
+            .uptime_ms = frame.timestamp_us / 1000,
+            .valid = frame.flags,
+            .temperature = frame.temperature,
+            .humidity = frame.humidity,
+            .ppm = frame.mq_ppm,
+            .mq_raw = frame.mq_raw,
+            .air_level = frame.air_level,
+            .auto_mode = auto_mode,
+            .has_actuators = auto_mode,  // MANUAL: trạng thái đi qua /reported
+            .fan = { fan.on, fan.level },
+            .led = { led.on, led.level },
+            .buzzer = { buzzer.on, buzzer.level },
+        };
+        mqtt_send_telemetry(&telemetry);
+
+        // Thống kê report-by-exception (~mỗi phút)
+        if (frame.seq % 12 == 0) {
+            mqtt_policy_stats_t stats;
+            mqtt_get_publish_stats(&stats);
+            mqtt_spool_stats_t spool;
+            mqtt_spool_get_stats(&spool);
+            ESP_LOGI(TAG, "📊 MQTT publish: sent=%lu suppressed=%lu | spool pending=%lu dropped=%lu",
+                     (unsigned long)stats.sent, (unsigned long)stats.suppressed,
+                     (unsigned long)(spool.ram + spool.flash), (unsigned long)spool.dropped);
+            mqtt_outbox_stats_t outbox;
+            mqtt_outbox_get_stats(&outbox);
+            const mqtt_outbox_stream_stats_t *tl = &outbox.streams[MQTT_STREAM_TELEMETRY];
+            const mqtt_outbox_stream_stats_t *rp = &outbox.streams[MQTT_STREAM_REPORT];
+            ESP_LOGI(TAG, "📊 MQTT queue: telemetry sent=%lu dropped=%lu | report sent=%lu dropped=%lu | outbox=%d B",
+                     (unsigned long)tl->sent, (unsigned long)(tl->dropped_ring + tl->dropped_outbox),
+                     (unsigned long)rp->sent, (unsigned long)(rp->dropped_ring + rp->dropped_outbox),
+                     outbox.outbox_bytes);
+            actuator_shadow_stats_t shadow;
+            actuator_shadow_get_stats(&shadow);
+            ESP_LOGI(TAG, "📊 Actuators: hw writes=%lu unchanged=%lu",
+                     (unsigned long)shadow.writes, (unsigned long)shadow.unchanged);
+            actuator_cmd_stats_t cmds;
+            actuator_cmd_get_stats(&cmds);
+            if (cmds.received > 0) {
+                ESP_LOGI(TAG, "📊 MANUAL cmds: recv=%lu applied=%lu coalesced=%lu | latency last=%lu avg=%lu max=%lu us",
+                         (unsigned long)cmds.received, (unsigned long)cmds.applied,
+                         (unsigned long)cmds.coalesced, (unsigned long)cmds.last_latency_us,
+                         (unsigned long)(cmds.applied ? cmds.total_latency_us / cmds.applied : 0),
+                         (unsigned long)cmds.max_latency_us);
+            }
+        }
 
-        ESP_LOGI(TAG, "MQ135 last raw=%d PPM=%.2f level=%d", latest_mq_raw, latest_mq_ppm, latest_air_level);
-        mqtt_send_data(topic_co2, latest_mq_ppm);
+#if MQTT_PER_TOPIC_COMPAT
+        mqtt_send_data(topic_temp, frame.temperature);
+        mqtt_send_data(topic_humi, frame.humidity);
+        mqtt_send_data(topic_co2, frame.mq_ppm);
+#endif
     }
 }
 
@@ -423,6 +390,8 @@ void app_main(void)
     fan_init();
     led_init();
     buzzer_init();
+    actuator_shadow_init();  // Mọi ghi fan/LED/buzzer sau đây đi qua shadow
+    actuator_cmd_set_notify(notify_actuator_command);
     sht31_init();
     mq135_init();
     lcd_init();
@@ -436,6 +405,9 @@ void app_main(void)
     // Setup MQTT topics
     setup_mqtt_topics(device_room_id);
 
+    // Bảng luật AUTO (NVS hoặc mặc định) - đăng ký topic config trước mqtt_app_start
+    automation_init(device_room_id);
+
     // MQ135 Calibration
     ESP_LOGI(TAG, "Waiting 10 seconds for MQ135 warmup...");
     